@@ -0,0 +1,71 @@
+#ifndef BENCHDEF_H
+#define BENCHDEF_H
+
+#include <stddef.h>
+
+// Number of items used by the benchmarks unless overridden on the command line
+extern size_t bench_items;
+
+// Returns a monotonic time in seconds
+double bench_now(void);
+
+// Creates num keys of the form "<prefix><index>", the caller frees with bench_free_keys
+char **bench_keys(const char *prefix, size_t num);
+
+// Shuffles the keys in to a repeatable random order, so lookups do not walk memory sequentially
+void bench_shuffle(char **keys, size_t num);
+
+// Frees keys allocated by bench_keys
+void bench_free_keys(char **keys, size_t num);
+
+// Prints a single benchmark result line
+void bench_report(const char *name, size_t ops, double secs);
+
+// == RESIZE ARRAY =============================================================
+
+void ra_bench_middle(void);
+void ra_bench_realloc(void);
+void ra_bench_values(void);
+void ra_bench_sort(void);
+void ra_bench_radix(void);
+
+// == HASH TABLE ==============================================================
+
+void ht_bench_lookup(void);
+void ht_bench_churn(void);
+void ht_bench_hash(void);
+void ht_bench_latency(void);
+void ht_bench_int_keys(void);
+void ht_bench_bulk(void);
+void ht_bench_inline(void);
+void ht_bench_upsert(void);
+void ht_bench_restore(void);
+void ht_bench_frozen(void);
+void ht_bench_prehashed(void);
+void ht_bench_sparse(void);
+
+// == BLOOM FILTER ============================================================
+
+void bf_bench_misses(void);
+
+// == DENSE TABLE =============================================================
+
+void dt_bench_iterate(void);
+
+// == LRU CACHE ===============================================================
+
+void lc_bench_access(void);
+
+// == CONCURRENT TABLE ========================================================
+
+void ct_bench_scaling(void);
+
+// == SNAPSHOT TABLE ==========================================================
+
+void st_bench_reads(void);
+
+// == MAPPED TABLE ============================================================
+
+void mt_bench_open(void);
+
+#endif
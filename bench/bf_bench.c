@@ -0,0 +1,64 @@
+/*
+ * Benchmarks for the Bloom filter. Compares rejecting missing keys with a filter against
+ * looking them up in a hash table, and testing keys one at a time against in batches.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchdef.h"
+#include "../src/collections.h"
+
+/*
+ * Looks up keys that are mostly missing in a table with and without a filter in front of it,
+ * then tests the keys against the filter alone, singly and in a batch
+ */
+void bf_bench_misses(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    char **miss = bench_keys("miss", num);
+    bench_shuffle(keys, num);
+
+    void *table = hash_table(0);
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add(table, keys[i], keys[i]);
+    }
+
+    void *value;
+    void *filter = bloom_filter(num, 0.01);
+    for (int mode = 0; mode < 2; mode++)
+    {
+        hash_table_set_filter(table, mode ? filter : 0);
+        double start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            hash_table_get(table, miss[i], &value);
+        }
+
+        bench_report(mode ? "table miss with filter" : "table miss", num, bench_now() - start);
+    }
+
+    size_t found = 0;
+    double start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        found += bloom_filter_test(filter, miss[i]) != 0;
+    }
+
+    bench_report("filter test", num, bench_now() - start);
+
+    unsigned char *results = malloc(num);
+    start = bench_now();
+    bloom_filter_test_many(filter, miss, num, results);
+    bench_report("filter test many", num, bench_now() - start);
+    printf("false positive rate %.4f\n", (double)found / num);
+
+    free(results);
+    hash_table_set_filter(table, 0);
+    clxns_free(filter, 0);
+    clxns_free(table, 0);
+    bench_free_keys(keys, num);
+    bench_free_keys(miss, num);
+}
@@ -0,0 +1,147 @@
+/*
+ * Entry point for collections benchmarks. Run with no arguments to run every benchmark, or name
+ * the benchmarks to run. An item count may be given with -n.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "benchdef.h"
+
+size_t bench_items = 1000000;
+
+// A named benchmark
+typedef struct
+{
+    const char *name;
+    void (*run)(void);
+} benchmark;
+
+static const benchmark all_benchmarks[] =
+{
+    { "ra_middle", ra_bench_middle },
+    { "ra_realloc", ra_bench_realloc },
+    { "ra_values", ra_bench_values },
+    { "ra_sort", ra_bench_sort },
+    { "ra_radix", ra_bench_radix },
+    { "ht_lookup", ht_bench_lookup },
+    { "ht_churn", ht_bench_churn },
+    { "ht_hash", ht_bench_hash },
+    { "ht_latency", ht_bench_latency },
+    { "ht_int_keys", ht_bench_int_keys },
+    { "ht_bulk", ht_bench_bulk },
+    { "ht_inline", ht_bench_inline },
+    { "ht_upsert", ht_bench_upsert },
+    { "ht_restore", ht_bench_restore },
+    { "ht_frozen", ht_bench_frozen },
+    { "ht_prehashed", ht_bench_prehashed },
+    { "ht_sparse", ht_bench_sparse },
+    { "bf_misses", bf_bench_misses },
+    { "dt_iterate", dt_bench_iterate },
+    { "lc_access", lc_bench_access },
+    { "ct_scaling", ct_bench_scaling },
+    { "st_reads", st_bench_reads },
+    { "mt_open", mt_bench_open },
+};
+
+/*
+ * Returns a monotonic time in seconds
+ */
+double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Creates num keys of the form "<prefix><index>"
+ */
+char **bench_keys(const char *prefix, size_t num)
+{
+    char **rv = malloc(num * sizeof(char*));
+    size_t len = strlen(prefix) + 21;
+    for (size_t i = 0; i < num; i++)
+    {
+        rv[i] = malloc(len);
+        snprintf(rv[i], len, "%s%zu", prefix, i);
+    }
+
+    return rv;
+}
+
+/*
+ * Shuffles the keys in to a repeatable random order
+ */
+void bench_shuffle(char **keys, size_t num)
+{
+    unsigned long long state = 88172645463325252ULL;
+    for (size_t i = num; i > 1; i--)
+    {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        size_t j = state % i;
+        char *tmp = keys[i - 1];
+        keys[i - 1] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+/*
+ * Frees keys allocated by bench_keys
+ */
+void bench_free_keys(char **keys, size_t num)
+{
+    for (size_t i = 0; i < num; i++)
+    {
+        free(keys[i]);
+    }
+
+    free(keys);
+}
+
+/*
+ * Prints a single benchmark result line
+ */
+void bench_report(const char *name, size_t ops, double secs)
+{
+    printf("%-40s %12zu ops %10.3f ms %10.2f ns/op\n", name, ops, secs * 1e3, secs * 1e9 / ops);
+}
+
+int main(int argc, char **argv)
+{
+    size_t num = sizeof(all_benchmarks) / sizeof(all_benchmarks[0]);
+    int named = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            bench_items = strtoul(argv[++i], 0, 10);
+            continue;
+        }
+
+        named = 1;
+        for (size_t j = 0; j < num; j++)
+        {
+            if (!strcmp(argv[i], all_benchmarks[j].name))
+            {
+                all_benchmarks[j].run();
+            }
+        }
+    }
+
+    if (!named)
+    {
+        for (size_t j = 0; j < num; j++)
+        {
+            all_benchmarks[j].run();
+        }
+    }
+
+    return 0;
+}
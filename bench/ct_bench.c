@@ -0,0 +1,159 @@
+/*
+ * Benchmarks for the concurrent hash table. Compares scaling across threads against a chained
+ * hash table behind a single global mutex.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "benchdef.h"
+#include "../src/collections.h"
+
+// Operations done by each thread in a run
+#define OPS_PER_THREAD 1000000
+
+// Shared state for one run of the benchmark
+typedef struct
+{
+    void *table;            // table under test
+    pthread_mutex_t *lock;  // global lock around a plain hash table, null for the concurrent table
+    char **keys;            // keys in the table
+    size_t num_keys;        // number of keys
+    int read_pct;           // percentage of operations which are reads
+} run_args;
+
+// Per thread arguments
+typedef struct
+{
+    const run_args *run;
+    unsigned long long seed;
+} thread_args;
+
+/*
+ * Does a mix of gets and adds on random keys
+ */
+static void *worker(void *arg)
+{
+    thread_args *ta = arg;
+    const run_args *run = ta->run;
+    unsigned long long state = ta->seed;
+    void *value;
+
+    for (size_t i = 0; i < OPS_PER_THREAD; i++)
+    {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        char *key = run->keys[state % run->num_keys];
+        int read = (int)((state >> 40) % 100) < run->read_pct;
+        if (run->lock)
+        {
+            pthread_mutex_lock(run->lock);
+            if (read)
+            {
+                hash_table_get(run->table, key, &value);
+            }
+            else
+            {
+                hash_table_add(run->table, key, key);
+            }
+
+            pthread_mutex_unlock(run->lock);
+        }
+        else if (read)
+        {
+            concurrent_table_get(run->table, key, &value);
+        }
+        else
+        {
+            concurrent_table_add(run->table, key, key);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Runs the workers on the given number of threads and returns the elapsed time
+ */
+static double run_threads(const run_args *run, int nthreads)
+{
+    pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+    thread_args *args = malloc(nthreads * sizeof(thread_args));
+
+    double start = bench_now();
+    for (int i = 0; i < nthreads; i++)
+    {
+        args[i].run = run;
+        args[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+        pthread_create(&threads[i], 0, worker, &args[i]);
+    }
+
+    for (int i = 0; i < nthreads; i++)
+    {
+        pthread_join(threads[i], 0);
+    }
+
+    double secs = bench_now() - start;
+    free(args);
+    free(threads);
+    return secs;
+}
+
+/*
+ * Doubles the thread count, finishing on the maximum
+ */
+static int next_count(int nthreads, int max_threads)
+{
+    if (nthreads < max_threads && nthreads * 2 > max_threads)
+    {
+        return max_threads;
+    }
+
+    return nthreads * 2;
+}
+
+/*
+ * Measures throughput from one thread up to the number of cores, at several read/write mixes
+ */
+void ct_bench_scaling(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int read_pcts[] = { 100, 90, 50 };
+
+    void *plain = hash_table_seeded(0, clxns_hash_wy, 0);
+    void *conc = concurrent_table(0);
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add(plain, keys[i], keys[i]);
+        concurrent_table_add(conc, keys[i], keys[i]);
+    }
+
+    pthread_mutex_t lock;
+    pthread_mutex_init(&lock, 0);
+
+    for (size_t r = 0; r < sizeof(read_pcts) / sizeof(read_pcts[0]); r++)
+    {
+        for (int nthreads = 1; nthreads <= max_threads; nthreads = next_count(nthreads, max_threads))
+        {
+            run_args global = { plain, &lock, keys, num, read_pcts[r] };
+            run_args striped = { conc, 0, keys, num, read_pcts[r] };
+            double gsecs = run_threads(&global, nthreads);
+            double ssecs = run_threads(&striped, nthreads);
+
+            size_t ops = (size_t)nthreads * OPS_PER_THREAD;
+            printf("%3d%% reads %3d threads: global mutex %8.2f Mops/s, striped %8.2f Mops/s\n",
+                   read_pcts[r], nthreads, ops / gsecs / 1e6, ops / ssecs / 1e6);
+        }
+    }
+
+    pthread_mutex_destroy(&lock);
+    clxns_free(plain, 0);
+    clxns_free(conc, 0);
+    bench_free_keys(keys, num);
+}
@@ -0,0 +1,98 @@
+/*
+ * Benchmarks for the dense table. Compares iterating and looking up against the chained hash
+ * table, on a full table and on one which most of the keys have been removed from.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchdef.h"
+#include "../src/collections.h"
+
+// Number of times each table is iterated
+#define ITER_ROUNDS 10
+
+// Functions to drive either table type through the same benchmark
+typedef struct _table_ops
+{
+    const char *name;
+    void *(*create)(size_t init_size);
+    void (*add)(void *table, char *key, void *value);
+    C_STATUS (*get)(const void *table, const char *key, void **value);
+    C_STATUS (*remove)(void *table, const char *key, int items);
+} table_ops;
+
+static const table_ops tables[] =
+{
+    { "chained", hash_table, hash_table_add, hash_table_get, hash_table_remove },
+    { "dense", dense_table, dense_table_add, dense_table_get, dense_table_remove },
+};
+
+/*
+ * Iterates the whole table a few times and reports the time per item
+ */
+static void time_iterate(const void *table, const char *name)
+{
+    size_t items = 0;
+    double start = bench_now();
+    for (int r = 0; r < ITER_ROUNDS; r++)
+    {
+        void *iter = clxns_iter_new(table);
+        while (clxns_iter_move_next(iter))
+        {
+            items += ((kvp*)clxns_iter_get_next(iter))->key_len > 0;
+        }
+
+        clxns_iter_free(iter);
+    }
+
+    bench_report(name, items, bench_now() - start);
+}
+
+/*
+ * Iterates and looks up keys in full tables, then removes nine keys in ten and iterates again
+ */
+void dt_bench_iterate(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    bench_shuffle(keys, num);
+
+    char name[64];
+    for (size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++)
+    {
+        const table_ops *ops = &tables[t];
+        void *table = ops->create(0);
+        for (size_t i = 0; i < num; i++)
+        {
+            ops->add(table, keys[i], keys[i]);
+        }
+
+        snprintf(name, sizeof(name), "%s iterate full", ops->name);
+        time_iterate(table, name);
+
+        void *value;
+        double start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            ops->get(table, keys[i], &value);
+        }
+
+        snprintf(name, sizeof(name), "%s lookup", ops->name);
+        bench_report(name, num, bench_now() - start);
+
+        for (size_t i = 0; i < num; i++)
+        {
+            if (i % 10)
+            {
+                ops->remove(table, keys[i], 0);
+            }
+        }
+
+        snprintf(name, sizeof(name), "%s iterate sparse", ops->name);
+        time_iterate(table, name);
+        clxns_free(table, 0);
+    }
+
+    bench_free_keys(keys, num);
+}
@@ -0,0 +1,640 @@
+/*
+ * Benchmarks for the hash table implementations
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchdef.h"
+#include "../src/collections.h"
+
+// A hash table engine under test
+typedef struct
+{
+    const char *name;
+    void *(*create)(size_t init_size);
+    void (*add)(void *table, char *key, void *value);
+    C_STATUS (*get)(const void *table, const char *key, void **value);
+} engine;
+
+/*
+ * Creates a chained table with power of two capacity
+ */
+static void *pow2_table(size_t init_size)
+{
+    void *rv = hash_table(init_size);
+    hash_table_set_flags(rv, HT_POW2);
+    return rv;
+}
+
+static const engine engines[] =
+{
+    { "chained", hash_table, hash_table_add, hash_table_get },
+    { "chained pow2", pow2_table, hash_table_add, hash_table_get },
+    { "open", open_table, open_table_add, open_table_get },
+};
+
+/*
+ * Times a lookup of every key in the table
+ */
+static void time_lookups(const engine *eng, const void *table, char **keys, size_t num, const char *what)
+{
+    char name[64];
+    void *value;
+    size_t found = 0;
+
+    double start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        found += eng->get(table, keys[i], &value) == C_OK;
+    }
+
+    double secs = bench_now() - start;
+    snprintf(name, sizeof(name), "%s %s lookup (%zu found)", eng->name, what, found);
+    bench_report(name, num, secs);
+}
+
+/*
+ * Compares hit and miss lookup latency of the chained and open addressing tables, and of the
+ * chained table with modulo and power of two indexing
+ */
+void ht_bench_lookup(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    char **miss = bench_keys("miss", num);
+    bench_shuffle(keys, num);
+    bench_shuffle(miss, num);
+
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++)
+    {
+        const engine *eng = &engines[e];
+        char name[64];
+
+        void *table = eng->create(0);
+        double start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            eng->add(table, keys[i], keys[i]);
+        }
+
+        snprintf(name, sizeof(name), "%s insert", eng->name);
+        bench_report(name, num, bench_now() - start);
+
+        time_lookups(eng, table, keys, num, "hit");
+        time_lookups(eng, table, miss, num, "miss");
+        clxns_free(table, 0);
+    }
+
+    bench_free_keys(keys, num);
+    bench_free_keys(miss, num);
+}
+
+/*
+ * Removes and re-adds keys in a full table. Measures the cost of node allocation under churn.
+ */
+void ht_bench_churn(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    bench_shuffle(keys, num);
+
+    void *table = hash_table(0);
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add(table, keys[i], keys[i]);
+    }
+
+    double start = bench_now();
+    for (int round = 0; round < 4; round++)
+    {
+        for (size_t i = 0; i < num; i += 2)
+        {
+            hash_table_remove(table, keys[i], 0);
+        }
+
+        for (size_t i = 0; i < num; i += 2)
+        {
+            hash_table_add(table, keys[i], keys[i]);
+        }
+    }
+
+    bench_report("chained remove/add churn", num * 4, bench_now() - start);
+
+    start = bench_now();
+    clxns_free(table, 0);
+    bench_report("chained free", num, bench_now() - start);
+    bench_free_keys(keys, num);
+}
+
+// A built-in hash function under test
+typedef struct
+{
+    const char *name;
+    clxns_hash hash;
+} hash_fn;
+
+// Keeps the hash results alive so the calls are not optimised away
+static volatile uint64_t hash_sink;
+
+static const hash_fn hash_fns[] =
+{
+    { "djb2", clxns_hash_djb2 },
+    { "wyhash", clxns_hash_wy },
+    { "siphash", clxns_hash_sip },
+};
+
+/*
+ * Measures the throughput of the built-in hash functions on short and long keys, then the
+ * lookup cost of a table using each of them on keys with a common prefix
+ */
+void ht_bench_hash(void)
+{
+    size_t lens[] = { 8, 16, 64, 1024 };
+    char buf[1024];
+    for (size_t i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = (char)('a' + i % 26);
+    }
+
+    for (size_t h = 0; h < sizeof(hash_fns) / sizeof(hash_fns[0]); h++)
+    {
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+        {
+            size_t num = bench_items * 16 / lens[l];
+            uint64_t acc = 0;
+            double start = bench_now();
+            for (size_t i = 0; i < num; i++)
+            {
+                buf[0] = (char)i;
+                acc += hash_fns[h].hash(buf, lens[l], 0);
+            }
+
+            double secs = bench_now() - start;
+            hash_sink = acc;
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s %zuB keys %.2f GB/s", hash_fns[h].name, lens[l],
+                     num * lens[l] / secs / 1e9);
+            bench_report(name, num, secs);
+        }
+    }
+
+    size_t num = bench_items;
+    char **keys = bench_keys("customer/account/transactions/", num);
+    bench_shuffle(keys, num);
+    for (size_t h = 0; h < sizeof(hash_fns) / sizeof(hash_fns[0]); h++)
+    {
+        void *table = hash_table_seeded(0, hash_fns[h].hash, 42);
+        for (size_t i = 0; i < num; i++)
+        {
+            hash_table_add(table, keys[i], keys[i]);
+        }
+
+        void *value;
+        double start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            hash_table_get(table, keys[i], &value);
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "chained %s prefixed key lookup", hash_fns[h].name);
+        bench_report(name, num, bench_now() - start);
+        clxns_free(table, 0);
+    }
+
+    bench_free_keys(keys, num);
+}
+
+/*
+ * Compares doubles for qsort
+ */
+static int compare_times(const void *first, const void *second)
+{
+    double a = *(const double*)first, b = *(const double*)second;
+    return (a > b) - (a < b);
+}
+
+/*
+ * Times every insert in to a growing table and reports the latency percentiles, with and
+ * without incremental resizing
+ */
+void ht_bench_latency(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    double *times = malloc(num * sizeof(double));
+    int modes[] = { HT_DEFAULT, HT_INCREMENTAL };
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+    {
+        void *table = hash_table(0);
+        hash_table_set_flags(table, modes[m]);
+
+        double total = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            double start = bench_now();
+            hash_table_add(table, keys[i], keys[i]);
+            times[i] = bench_now() - start;
+        }
+
+        total = bench_now() - total;
+        qsort(times, num, sizeof(double), compare_times);
+
+        const char *name = modes[m] == HT_INCREMENTAL ? "incremental" : "default";
+        printf("%-12s insert p50 %8.0f ns p99 %8.0f ns p99.99 %10.0f ns max %12.0f ns\n", name,
+               times[num / 2] * 1e9, times[num / 100 * 99] * 1e9, times[num / 10000 * 9999] * 1e9,
+               times[num - 1] * 1e9);
+
+        char label[64];
+        snprintf(label, sizeof(label), "chained %s insert", name);
+        bench_report(label, num, total);
+        clxns_free(table, 0);
+    }
+
+    free(times);
+    bench_free_keys(keys, num);
+}
+
+/*
+ * Compares three ways of keying a table on 64 bit ids. Formatting each id as a string, using
+ * the id bytes as a binary key and the int table.
+ */
+void ht_bench_int_keys(void)
+{
+    size_t num = bench_items;
+    uint64_t *ids = malloc(num * sizeof(uint64_t));
+    for (size_t i = 0; i < num; i++)
+    {
+        ids[i] = i * 0x9E3779B97F4A7C15ULL;
+    }
+
+    void *value;
+    char buf[24];
+    void *table = hash_table(0);
+    double start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        size_t len = snprintf(buf, sizeof(buf), "%llu", (unsigned long long)ids[i]);
+        hash_table_add(table, memcpy(malloc(len + 1), buf, len + 1), &ids[i]);
+    }
+
+    bench_report("chained stringified id insert", num, bench_now() - start);
+    start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        snprintf(buf, sizeof(buf), "%llu", (unsigned long long)ids[i]);
+        hash_table_get(table, buf, &value);
+    }
+
+    bench_report("chained stringified id lookup", num, bench_now() - start);
+
+    void *iter = clxns_iter_new(table);
+    while (clxns_iter_move_next(iter))
+    {
+        free(((kvp*)clxns_iter_get_next(iter))->key);
+    }
+
+    clxns_iter_free(iter);
+    clxns_free(table, 0);
+
+    table = hash_table_seeded(0, clxns_hash_wy, 0);
+    start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add_bin(table, &ids[i], sizeof(uint64_t), &ids[i]);
+    }
+
+    bench_report("chained binary id insert", num, bench_now() - start);
+    start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_get_bin(table, &ids[i], sizeof(uint64_t), &value);
+    }
+
+    bench_report("chained binary id lookup", num, bench_now() - start);
+    clxns_free(table, 0);
+
+    table = int_table(0);
+    start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        int_table_add(table, ids[i], &ids[i]);
+    }
+
+    bench_report("int table insert", num, bench_now() - start);
+    start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        int_table_get(table, ids[i], &value);
+    }
+
+    bench_report("int table lookup", num, bench_now() - start);
+    clxns_free(table, 0);
+    free(ids);
+}
+
+/*
+ * Compares building a table with repeated adds, with a reserve up front and with a bulk add
+ */
+void ht_bench_bulk(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    bench_shuffle(keys, num);
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        void *table = hash_table_seeded(0, clxns_hash_wy, 0);
+        double start = bench_now();
+        if (mode == 2)
+        {
+            hash_table_add_many(table, keys, (void**)keys, num);
+        }
+        else
+        {
+            if (mode == 1)
+            {
+                hash_table_reserve(table, num);
+            }
+
+            for (size_t i = 0; i < num; i++)
+            {
+                hash_table_add(table, keys[i], keys[i]);
+            }
+        }
+
+        const char *names[] = { "chained add loop", "chained reserve + add loop", "chained add_many" };
+        bench_report(names[mode], num, bench_now() - start);
+        clxns_free(table, 0);
+    }
+
+    bench_free_keys(keys, num);
+}
+
+/*
+ * Compares lookups with keys followed through the key pointer against keys copied in to the
+ * nodes. The lookups use separate copies of the keys so both sides of the compare are read.
+ */
+void ht_bench_inline(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    char **lookups = bench_keys("key", num);
+    bench_shuffle(keys, num);
+    bench_shuffle(lookups, num);
+
+    size_t lens[] = { 0, 15, 23 };
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+    {
+        void *table = hash_table_seeded(0, clxns_hash_wy, 0);
+        hash_table_set_flags(table, HT_POW2);
+        hash_table_set_inline(table, lens[l]);
+        for (size_t i = 0; i < num; i++)
+        {
+            hash_table_add(table, keys[i], keys[i]);
+        }
+
+        void *value;
+        size_t found = 0;
+        double start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            found += hash_table_get(table, lookups[i], &value) == C_OK;
+        }
+
+        double secs = bench_now() - start;
+        char name[64];
+        snprintf(name, sizeof(name), "inline %2zu (+%zu bytes/node, %zu found)", lens[l], (lens[l] + 7) & ~(size_t)7, found);
+        bench_report(name, num, secs);
+        clxns_free(table, 0);
+    }
+
+    bench_free_keys(keys, num);
+    bench_free_keys(lookups, num);
+}
+
+/*
+ * Counts occurrences of keys in a stream, with a get then add on every key against a single
+ * get_or_insert which updates the count in place
+ */
+void ht_bench_upsert(void)
+{
+    size_t num = bench_items;
+    size_t distinct = num / 10 ? num / 10 : 1;
+    char **keys = bench_keys("key", distinct);
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+        void *table = hash_table_seeded(0, clxns_hash_wy, 0);
+        unsigned long long state = 0x9E3779B97F4A7C15ULL;
+        double start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            // xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            char *key = keys[state % distinct];
+            if (mode)
+            {
+                void **count = hash_table_get_or_insert(table, key, 0);
+                *count = (char*)*count + 1;
+            }
+            else
+            {
+                void *count;
+                hash_table_get(table, key, &count);
+                hash_table_add(table, key, (char*)count + 1);
+            }
+        }
+
+        bench_report(mode ? "get_or_insert count" : "get + add count", num, bench_now() - start);
+        clxns_free(table, 0);
+    }
+
+    bench_free_keys(keys, distinct);
+}
+
+/*
+ * Compares restoring a table from a serialized stream against adding the same items one at
+ * a time to a table which grows as it goes
+ */
+void ht_bench_restore(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    void *table = hash_table_seeded(0, clxns_hash_wy, 0);
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add(table, keys[i], keys[i]);
+    }
+
+    FILE *fp = tmpfile();
+    double start = bench_now();
+    clxns_serialize(table, fp, &clxns_string_codec);
+    fflush(fp);
+    bench_report("serialize", num, bench_now() - start);
+    clxns_free(table, 0);
+
+    start = bench_now();
+    table = hash_table_seeded(0, clxns_hash_wy, 0);
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add(table, strdup(keys[i]), strdup(keys[i]));
+    }
+
+    bench_report("add loop with copies", num, bench_now() - start);
+    clxns_free(table, 1);
+
+    rewind(fp);
+    start = bench_now();
+    table = hash_table_seeded(0, clxns_hash_wy, 0);
+    clxns_deserialize(table, fp, &clxns_string_codec);
+    bench_report("deserialize", num, bench_now() - start);
+    clxns_free(table, 1);
+
+    fclose(fp);
+    bench_free_keys(keys, num);
+}
+
+/*
+ * Compares lookups in a chained table against the same table frozen in to a minimal perfect
+ * hash map, and times the freeze
+ */
+void ht_bench_frozen(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    char **miss = bench_keys("miss", num);
+    bench_shuffle(keys, num);
+
+    void *table = hash_table_seeded(0, clxns_hash_wy, 0);
+    hash_table_set_flags(table, HT_POW2);
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add(table, keys[i], keys[i]);
+    }
+
+    double start = bench_now();
+    void *frozen = hash_table_freeze(table);
+    bench_report("freeze", num, bench_now() - start);
+
+    void *value;
+    for (int mode = 0; mode < 4; mode++)
+    {
+        char **lookups = mode % 2 ? miss : keys;
+        start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            if (mode < 2)
+            {
+                hash_table_get(table, lookups[i], &value);
+            }
+            else
+            {
+                frozen_table_get(frozen, lookups[i], &value);
+            }
+        }
+
+        const char *names[] = { "chained hit", "chained miss", "frozen hit", "frozen miss" };
+        bench_report(names[mode], num, bench_now() - start);
+    }
+
+    clxns_free(frozen, 0);
+    clxns_free(table, 0);
+    bench_free_keys(keys, num);
+    bench_free_keys(miss, num);
+}
+
+// Number of tables a key is looked up in by the prehashed benchmark
+#define PREHASH_TABLES 4
+
+/*
+ * Looks long keys up in several tables, hashing the key for every table against hashing it once
+ */
+void ht_bench_prehashed(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("/var/lib/collections/objects/by-name/", num);
+    bench_shuffle(keys, num);
+
+    void *tables[PREHASH_TABLES];
+    for (int t = 0; t < PREHASH_TABLES; t++)
+    {
+        tables[t] = hash_table(0);
+        hash_table_reserve(tables[t], num);
+        for (size_t i = t; i < num; i += 2)
+        {
+            hash_table_add(tables[t], keys[i], keys[i]);
+        }
+    }
+
+    void *value;
+    for (int mode = 0; mode < 2; mode++)
+    {
+        double start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            uint64_t hash = mode ? hash_table_hash(tables[0], keys[i]) : 0;
+            for (int t = 0; t < PREHASH_TABLES; t++)
+            {
+                if (mode)
+                {
+                    hash_table_get_prehashed(tables[t], keys[i], hash, &value);
+                }
+                else
+                {
+                    hash_table_get(tables[t], keys[i], &value);
+                }
+            }
+        }
+
+        bench_report(mode ? "hash once" : "hash per table", num * PREHASH_TABLES, bench_now() - start);
+    }
+
+    for (int t = 0; t < PREHASH_TABLES; t++)
+    {
+        clxns_free(tables[t], 0);
+    }
+
+    bench_free_keys(keys, num);
+}
+
+/*
+ * Iterates a table sized for many more items than it holds, where most slots are empty
+ */
+void ht_bench_sparse(void)
+{
+    size_t num = bench_items;
+    size_t held = num / 64 ? num / 64 : 1;
+    char **keys = bench_keys("key", held);
+
+    void *table = hash_table_seeded(0, clxns_hash_wy, 0);
+    hash_table_reserve(table, num);
+    for (size_t i = 0; i < held; i++)
+    {
+        hash_table_add(table, keys[i], keys[i]);
+    }
+
+    size_t items = 0;
+    double start = bench_now();
+    for (int r = 0; r < 64; r++)
+    {
+        void *iter = clxns_iter_new(table);
+        while (clxns_iter_move_next(iter))
+        {
+            items++;
+        }
+
+        clxns_iter_free(iter);
+    }
+
+    bench_report("iterate sparse", items, bench_now() - start);
+
+    clxns_free(table, 0);
+    bench_free_keys(keys, held);
+}
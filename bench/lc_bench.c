@@ -0,0 +1,158 @@
+/*
+ * Benchmarks for the LRU cache. Compares the cache against the usual hand-built LRU of a hash
+ * table holding nodes of a separately allocated recency list.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchdef.h"
+#include "../src/collections.h"
+
+// A node of the hand-built recency list
+typedef struct _list_node
+{
+    char *key;
+    void *value;
+    struct _list_node *prev;
+    struct _list_node *next;
+} list_node;
+
+// The hand-built cache, a hash table of list nodes and the list, most recently used first
+typedef struct _list_cache
+{
+    void *table;
+    list_node head;  // sentinel, head.next is the most recent and head.prev the least
+    size_t count;
+    size_t capacity;
+} list_cache;
+
+/*
+ * Takes a node out of the list
+ */
+static void list_unlink(list_node *nn)
+{
+    nn->prev->next = nn->next;
+    nn->next->prev = nn->prev;
+}
+
+/*
+ * Puts a node at the most recently used end of the list
+ */
+static void list_push(list_cache *lc, list_node *nn)
+{
+    nn->prev = &lc->head;
+    nn->next = lc->head.next;
+    lc->head.next->prev = nn;
+    lc->head.next = nn;
+}
+
+/*
+ * Gets a key from the hand-built cache, adding it and evicting the least recently used key on
+ * a miss. Returns non-zero on a hit.
+ */
+static int list_cache_access(list_cache *lc, char *key)
+{
+    list_node *nn;
+    if (hash_table_get(lc->table, key, (void**)&nn) == C_OK)
+    {
+        list_unlink(nn);
+        list_push(lc, nn);
+        return 1;
+    }
+
+    if (lc->count == lc->capacity)
+    {
+        list_node *old = lc->head.prev;
+        list_unlink(old);
+        hash_table_remove(lc->table, old->key, 0);
+        free(old);
+        lc->count--;
+    }
+
+    nn = malloc(sizeof(list_node));
+    nn->key = key;
+    nn->value = key;
+    list_push(lc, nn);
+    hash_table_add(lc->table, key, nn);
+    lc->count++;
+    return 0;
+}
+
+/*
+ * Runs a skewed stream of keys, where a quarter of the keys get most of the accesses, through a
+ * cache holding a quarter of the keys
+ */
+void lc_bench_access(void)
+{
+    size_t num = bench_items;
+    size_t distinct = num / 4 ? num / 4 : 1;
+    size_t capacity = distinct / 4 ? distinct / 4 : 1;
+    char **keys = bench_keys("key", distinct);
+
+    size_t *stream = malloc(num * sizeof(size_t));
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < num; i++)
+    {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        // Four in five accesses go to the hot quarter of the keys
+        size_t hot = state % 5 ? capacity : distinct;
+        stream[i] = (state >> 8) % hot;
+    }
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        size_t hits = 0;
+        double start = bench_now();
+        if (mode == 0)
+        {
+            list_cache lc = { hash_table_seeded(0, clxns_hash_wy, 0), { 0, 0, 0, 0 }, 0, capacity };
+            lc.head.prev = &lc.head;
+            lc.head.next = &lc.head;
+            for (size_t i = 0; i < num; i++)
+            {
+                hits += list_cache_access(&lc, keys[stream[i]]);
+            }
+
+            for (list_node *nn = lc.head.next; nn != &lc.head; )
+            {
+                list_node *next = nn->next;
+                free(nn);
+                nn = next;
+            }
+
+            clxns_free(lc.table, 0);
+        }
+        else
+        {
+            void *lc = lru_cache(capacity, mode == 1 ? CACHE_LRU : CACHE_CLOCK);
+            for (size_t i = 0; i < num; i++)
+            {
+                void *value;
+                char *key = keys[stream[i]];
+                if (lru_cache_get(lc, key, &value) == C_OK)
+                {
+                    hits++;
+                }
+                else
+                {
+                    lru_cache_put(lc, key, key);
+                }
+            }
+
+            clxns_free(lc, 0);
+        }
+
+        const char *names[] = { "table + list", "lru_cache LRU", "lru_cache CLOCK" };
+        double secs = bench_now() - start;
+        bench_report(names[mode], num, secs);
+        printf("%-40s %.1f%% hits\n", names[mode], 100.0 * hits / num);
+    }
+
+    free(stream);
+    bench_free_keys(keys, distinct);
+}
@@ -0,0 +1,85 @@
+/*
+ * Benchmarks for the memory mapped table. Compares the cold start of rebuilding a hash table
+ * record by record against opening a mapped table file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "benchdef.h"
+#include "../src/collections.h"
+
+/*
+ * Times rebuilding a table from a text file of records against opening the same records as a
+ * mapped table, then compares lookups. The mapped lookups include the page faults.
+ */
+void mt_bench_open(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    char text_path[] = "/tmp/mt_benchXXXXXX";
+    char map_path[] = "/tmp/mt_benchXXXXXX";
+    close(mkstemp(text_path));
+    close(mkstemp(map_path));
+
+    void *table = hash_table_seeded(0, clxns_hash_wy, 0);
+    FILE *fp = fopen(text_path, "w");
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add(table, keys[i], keys[i]);
+        fprintf(fp, "%s %s\n", keys[i], keys[i]);
+    }
+
+    fclose(fp);
+    double start = bench_now();
+    mapped_table_write(table, map_path, 0);
+    bench_report("mt write", num, bench_now() - start);
+    clxns_free(table, 0);
+
+    // Rebuild by parsing the records and adding them one at a time
+    start = bench_now();
+    char key[64];
+    char value[64];
+    size_t records = 0;
+    table = hash_table_seeded(0, clxns_hash_wy, 0);
+    fp = fopen(text_path, "r");
+    while (fscanf(fp, "%63s %63s", key, value) == 2)
+    {
+        hash_table_add(table, strdup(key), strdup(value));
+        records++;
+    }
+
+    fclose(fp);
+    bench_report("rebuild from records", records, bench_now() - start);
+
+    start = bench_now();
+    void *mt = mapped_table(map_path);
+    bench_report("mt open", 1, bench_now() - start);
+
+    bench_shuffle(keys, num);
+    void *found;
+    for (int mode = 0; mode < 2; mode++)
+    {
+        start = bench_now();
+        for (size_t i = 0; i < num; i++)
+        {
+            if (mode)
+            {
+                mapped_table_get(mt, keys[i], &found);
+            }
+            else
+            {
+                hash_table_get(table, keys[i], &found);
+            }
+        }
+
+        bench_report(mode ? "mt lookup (first touch)" : "rebuilt lookup", num, bench_now() - start);
+    }
+
+    clxns_free(mt, 0);
+    clxns_free(table, 1);
+    unlink(text_path);
+    unlink(map_path);
+    bench_free_keys(keys, num);
+}
@@ -0,0 +1,321 @@
+/*
+ * Benchmarks for the resize array. Times inserting and removing in the middle of a large array
+ * one item at a time and as a range, counts the reallocations made by each growth policy, and
+ * compares the sorts with qsort and the radix sort.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "benchdef.h"
+#include "../src/collections.h"
+
+// Number of items inserted and removed in the middle of the array
+#define MIDDLE_ITEMS 1000
+
+// Number of items added and removed each time round the threshold by the realloc benchmark
+#define SWING_ITEMS 4
+
+// Number of threads used by the parallel sort
+#define SORT_THREADS 4
+
+/*
+ * Inserts and removes items in the middle of an array of bench_items items
+ */
+void ra_bench_middle(void)
+{
+    size_t num = bench_items;
+    void *array = resize_array(num + MIDDLE_ITEMS);
+    for (size_t i = 0; i < num; i++)
+    {
+        resize_array_add(array, (void*)i);
+    }
+
+    void *items[MIDDLE_ITEMS];
+    for (size_t i = 0; i < MIDDLE_ITEMS; i++)
+    {
+        items[i] = (void*)i;
+    }
+
+    double start = bench_now();
+    for (size_t i = 0; i < MIDDLE_ITEMS; i++)
+    {
+        resize_array_insert(array, num / 2, items[i]);
+    }
+
+    bench_report("insert middle", MIDDLE_ITEMS, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < MIDDLE_ITEMS; i++)
+    {
+        resize_array_remove(array, num / 2, 0);
+    }
+
+    bench_report("remove middle", MIDDLE_ITEMS, bench_now() - start);
+
+    start = bench_now();
+    resize_array_insert_range(array, num / 2, items, MIDDLE_ITEMS);
+    resize_array_remove_range(array, num / 2, MIDDLE_ITEMS, 0);
+    bench_report("insert + remove range middle", MIDDLE_ITEMS, bench_now() - start);
+
+    clxns_free(array, 0);
+}
+
+/*
+ * Fills an array, empties it to a quarter full and then adds and removes a few items at a time
+ * around the shrink threshold. Reports the time and the number of reallocations made.
+ */
+static void realloc_policy(const char *name, const ra_policy *pol)
+{
+    size_t num = bench_items;
+    void *array = resize_array(0);
+    resize_array_set_policy(array, pol);
+
+    size_t reallocs = 0;
+    size_t cap = resize_array_capacity(array);
+    double start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        resize_array_add(array, (void*)i);
+        reallocs += resize_array_capacity(array) != cap;
+        cap = resize_array_capacity(array);
+    }
+
+    size_t target = cap / 4;
+    while (clxns_count(array) > target)
+    {
+        resize_array_remove(array, clxns_count(array) - 1, 0);
+        reallocs += resize_array_capacity(array) != cap;
+        cap = resize_array_capacity(array);
+    }
+
+    for (size_t i = 0; i < num; i++)
+    {
+        if (i % (SWING_ITEMS * 2) < SWING_ITEMS)
+        {
+            resize_array_add(array, (void*)i);
+        }
+        else
+        {
+            resize_array_remove(array, clxns_count(array) - 1, 0);
+        }
+
+        reallocs += resize_array_capacity(array) != cap;
+        cap = resize_array_capacity(array);
+    }
+
+    double secs = bench_now() - start;
+    char label[64];
+    snprintf(label, sizeof(label), "%s (%zu reallocs)", name, reallocs);
+    bench_report(label, num * 2, secs);
+    clxns_free(array, 0);
+}
+
+/*
+ * Compares the reallocations made by shrinking straight to size, by shrinking at half full so
+ * that there is no gap between the grow and shrink points, by the default policy which leaves
+ * room after shrinking, and by never shrinking
+ */
+void ra_bench_realloc(void)
+{
+    ra_policy tight = { 2.0, 0.25, 1.0, 0 };
+    ra_policy thrash = { 2.0, 0.5, 1.0, 0 };
+    ra_policy def = { 2.0, 0.25, 0.5, 0 };
+    ra_policy never = { 2.0, 0.25, 0.5, 1 };
+    ra_policy slow = { 1.5, 0.25, 0.5, 0 };
+
+    realloc_policy("shrink to size", &tight);
+    realloc_policy("shrink at half", &thrash);
+    realloc_policy("default", &def);
+    realloc_policy("no shrink", &never);
+    realloc_policy("grow by 1.5", &slow);
+}
+
+/*
+ * Sums bench_items doubles held in a value array and in a pointer array of separately
+ * allocated doubles
+ */
+void ra_bench_values(void)
+{
+    size_t num = bench_items;
+    void *values = resize_array_of(sizeof(double), 0);
+    double **doubles = malloc(num * sizeof(double*));
+    for (size_t i = 0; i < num; i++)
+    {
+        double d = (double)i;
+        resize_array_add_value(values, &d);
+        doubles[i] = malloc(sizeof(double));
+        *doubles[i] = d;
+    }
+
+    // Shuffle the pointers so the doubles are not read in allocation order
+    bench_shuffle((char**)doubles, num);
+    void *pointers = resize_array(num);
+    resize_array_extend(pointers, (void**)doubles, num);
+    free(doubles);
+
+    double sum = 0;
+    double start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        sum += *(double*)resize_array_at(values, i);
+    }
+
+    bench_report("sum values", num, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < num; i++)
+    {
+        double *p;
+        resize_array_get(pointers, i, (void**)&p);
+        sum -= *p;
+    }
+
+    bench_report("sum pointers", num, bench_now() - start);
+    if (sum != 0)
+    {
+        printf("Sums differ\n");
+    }
+
+    clxns_free(pointers, 1);
+    clxns_free(values, 0);
+}
+
+/*
+ * Compares two keys for the array sorts
+ */
+static int compare_keys(const void *first, const void *second)
+{
+    return strcmp(first, second);
+}
+
+/*
+ * Compares two keys for qsort, which passes pointers to the items
+ */
+static int qsort_keys(const void *first, const void *second)
+{
+    return strcmp(*(char* const*)first, *(char* const*)second);
+}
+
+/*
+ * Sorts bench_items shuffled keys with qsort, with the introsort and with the parallel sort.
+ * The qsort copies the items out of the array and writes them back, as callers had to.
+ */
+void ra_bench_sort(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("sort", num);
+    bench_shuffle(keys, num);
+
+    void *array = resize_array(num);
+    resize_array_extend(array, (void**)keys, num);
+    double start = bench_now();
+    char **out = malloc(num * sizeof(char*));
+    for (size_t i = 0; i < num; i++)
+    {
+        resize_array_get(array, i, (void**)&out[i]);
+    }
+
+    qsort(out, num, sizeof(char*), qsort_keys);
+    for (size_t i = 0; i < num; i++)
+    {
+        resize_array_replace(array, i, out[i]);
+    }
+
+    bench_report("qsort", num, bench_now() - start);
+    free(out);
+    clxns_free(array, 0);
+
+    array = resize_array(num);
+    resize_array_extend(array, (void**)keys, num);
+    start = bench_now();
+    resize_array_sort(array, compare_keys);
+    bench_report("resize_array_sort", num, bench_now() - start);
+    clxns_free(array, 0);
+
+    array = resize_array(num);
+    resize_array_extend(array, (void**)keys, num);
+    start = bench_now();
+    resize_array_sort_parallel(array, compare_keys, SORT_THREADS);
+    bench_report("resize_array_sort_parallel", num, bench_now() - start);
+    clxns_free(array, 0);
+
+    bench_free_keys(keys, num);
+}
+
+/*
+ * Gets the integer key which an item points to
+ */
+static uint64_t item_key(const void *item)
+{
+    return *(const uint64_t*)item;
+}
+
+/*
+ * Compares the integer keys which two items point to
+ */
+static int compare_ints(const void *first, const void *second)
+{
+    uint64_t a = item_key(first);
+    uint64_t b = item_key(second);
+    return (a > b) - (a < b);
+}
+
+/*
+ * Sorts items pointing to random keys of the given number of bits with the comparison sort and
+ * the radix sorts
+ */
+static void sort_ints(const char *name, int bits)
+{
+    size_t num = bench_items;
+    uint64_t *keys = malloc(num * sizeof(uint64_t));
+    unsigned long long state = 88172645463325252ULL;
+    for (size_t i = 0; i < num; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        keys[i] = bits < 64 ? state >> (64 - bits) : state;
+    }
+
+    char label[64];
+    const char *kinds[] = { "compare", "radix", "radix parallel" };
+    for (size_t s = 0; s < sizeof(kinds) / sizeof(kinds[0]); s++)
+    {
+        void *array = resize_array(num);
+        for (size_t i = 0; i < num; i++)
+        {
+            resize_array_add(array, &keys[i]);
+        }
+
+        double start = bench_now();
+        if (s == 0)
+        {
+            resize_array_sort(array, compare_ints);
+        }
+        else if (s == 1)
+        {
+            resize_array_radix_sort(array, item_key);
+        }
+        else
+        {
+            resize_array_radix_sort_parallel(array, item_key, SORT_THREADS);
+        }
+
+        snprintf(label, sizeof(label), "%s %s", kinds[s], name);
+        bench_report(label, num, bench_now() - start);
+        clxns_free(array, 0);
+    }
+
+    free(keys);
+}
+
+/*
+ * Sorts items by 32 and 64 bit integer keys
+ */
+void ra_bench_radix(void)
+{
+    sort_ints("32 bit", 32);
+    sort_ints("64 bit", 64);
+}
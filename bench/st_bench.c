@@ -0,0 +1,210 @@
+/*
+ * Benchmarks for the snapshot table. Compares lock free reads against a chained hash table
+ * behind a reader/writer lock, while a writer keeps publishing changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "benchdef.h"
+#include "../src/collections.h"
+
+// Lookups done by each reader thread in a run
+#define READS_PER_THREAD 1000000
+
+// Keys changed by the writer between publishes
+#define KEYS_PER_PUBLISH 16
+
+// Shared state for one run of the benchmark
+typedef struct
+{
+    void *table;            // table under test
+    pthread_rwlock_t *lock; // lock around a plain hash table, null for the snapshot table
+    char **keys;            // keys in the table
+    size_t num_keys;        // number of keys
+    volatile int done;      // set once every reader has finished
+    size_t publishes;       // number of times the writer published
+} run_args;
+
+// Per thread arguments
+typedef struct
+{
+    run_args *run;
+    unsigned long long seed;
+} thread_args;
+
+/*
+ * Looks up random keys
+ */
+static void *reader(void *arg)
+{
+    thread_args *ta = arg;
+    run_args *run = ta->run;
+    unsigned long long state = ta->seed;
+    void *rd = run->lock ? 0 : snapshot_reader(run->table);
+    void *value;
+
+    for (size_t i = 0; i < READS_PER_THREAD; i++)
+    {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        char *key = run->keys[state % run->num_keys];
+        if (run->lock)
+        {
+            pthread_rwlock_rdlock(run->lock);
+            hash_table_get(run->table, key, &value);
+            pthread_rwlock_unlock(run->lock);
+        }
+        else
+        {
+            snapshot_table_get(rd, key, &value);
+        }
+    }
+
+    if (rd)
+    {
+        snapshot_reader_free(rd);
+    }
+
+    return 0;
+}
+
+/*
+ * Re-adds a few keys at a time until the readers are done, publishing after each batch
+ */
+static void *writer(void *arg)
+{
+    run_args *run = arg;
+    size_t next = 0;
+    while (!__atomic_load_n(&run->done, __ATOMIC_ACQUIRE))
+    {
+        if (run->lock)
+        {
+            pthread_rwlock_wrlock(run->lock);
+        }
+
+        for (size_t i = 0; i < KEYS_PER_PUBLISH; i++, next = (next + 1) % run->num_keys)
+        {
+            if (run->lock)
+            {
+                hash_table_add(run->table, run->keys[next], run->keys[next]);
+            }
+            else
+            {
+                snapshot_table_add(run->table, run->keys[next], run->keys[next]);
+            }
+        }
+
+        if (run->lock)
+        {
+            pthread_rwlock_unlock(run->lock);
+        }
+        else
+        {
+            snapshot_table_publish(run->table);
+        }
+
+        run->publishes++;
+    }
+
+    return 0;
+}
+
+/*
+ * Runs the readers and a writer, returns the elapsed time for the readers
+ */
+static double run_threads(run_args *run, int nthreads)
+{
+    pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+    thread_args *args = malloc(nthreads * sizeof(thread_args));
+    pthread_t wthread;
+
+    run->done = 0;
+    run->publishes = 0;
+    pthread_create(&wthread, 0, writer, run);
+
+    double start = bench_now();
+    for (int i = 0; i < nthreads; i++)
+    {
+        args[i].run = run;
+        args[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+        pthread_create(&threads[i], 0, reader, &args[i]);
+    }
+
+    for (int i = 0; i < nthreads; i++)
+    {
+        pthread_join(threads[i], 0);
+    }
+
+    double secs = bench_now() - start;
+    __atomic_store_n(&run->done, 1, __ATOMIC_RELEASE);
+    pthread_join(wthread, 0);
+
+    free(args);
+    free(threads);
+    return secs;
+}
+
+/*
+ * Doubles the thread count, finishing on the maximum
+ */
+static int next_count(int nthreads, int max_threads)
+{
+    if (nthreads < max_threads && nthreads * 2 > max_threads)
+    {
+        return max_threads;
+    }
+
+    return nthreads * 2;
+}
+
+/*
+ * Measures read throughput from one reader thread up to the number of cores, with a writer
+ * changing the table throughout. Also measures a single change and publish, which copies the table.
+ */
+void st_bench_reads(void)
+{
+    size_t num = bench_items;
+    char **keys = bench_keys("key", num);
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    void *plain = hash_table_seeded(0, clxns_hash_wy, 0);
+    void *snap = snapshot_table(0);
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add(plain, keys[i], keys[i]);
+        snapshot_table_add(snap, keys[i], keys[i]);
+    }
+
+    snapshot_table_publish(snap);
+
+    // The first change after a publish copies the table
+    double start = bench_now();
+    snapshot_table_add(snap, keys[0], keys[0]);
+    snapshot_table_publish(snap);
+    bench_report("st_publish", 1, bench_now() - start);
+
+    pthread_rwlock_t lock;
+    pthread_rwlock_init(&lock, 0);
+
+    for (int nthreads = 1; nthreads <= max_threads; nthreads = next_count(nthreads, max_threads))
+    {
+        run_args locked = { plain, &lock, keys, num, 0, 0 };
+        run_args snapshot = { snap, 0, keys, num, 0, 0 };
+        double lsecs = run_threads(&locked, nthreads);
+        double ssecs = run_threads(&snapshot, nthreads);
+
+        size_t ops = (size_t)nthreads * READS_PER_THREAD;
+        printf("%3d readers: rwlock %8.2f Mops/s, snapshot %8.2f Mops/s (%zu publishes)\n",
+               nthreads, ops / lsecs / 1e6, ops / ssecs / 1e6, snapshot.publishes);
+    }
+
+    pthread_rwlock_destroy(&lock);
+    clxns_free(plain, 0);
+    clxns_free(snap, 0);
+    bench_free_keys(keys, num);
+}
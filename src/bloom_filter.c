@@ -0,0 +1,369 @@
+/*
+ * Implementation functions for the Bloom filter. A split block Bloom filter, as used by Impala
+ * and Parquet. Each key sets one bit in each of the eight words of a single 32 byte block, so
+ * adding or testing a key touches one cache line and the eight bit tests have no branches
+ * between them for the compiler to vectorise.
+ *
+ * The filter answers "definitely not added" or "possibly added". Keys cannot be removed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+
+// Number of 32 bit words in a block, one bit is set in each for every key
+#define WORDS 8
+
+// Alignment of the blocks, so that a block never spans two cache lines
+#define CACHE_LINE 64
+
+// Number of keys hashed ahead of being added or tested by the batch functions
+#define BATCH_SIZE 32
+
+// Odd multipliers which pick a different bit in each word from the same hash
+static const uint32_t SALT[WORDS] =
+{
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+// A block of the filter
+typedef struct _block
+{
+    uint32_t words[WORDS];
+} block;
+
+// The Bloom filter
+typedef struct _bloom
+{
+    header head;
+    block *blocks;  // the filter bits
+    size_t count;   // number of blocks
+} bloom;
+
+/*
+ * Gets the false positive rate of a filter holding an average of load keys per block. The keys
+ * per block follow a Poisson distribution. Its terms are summed without the e^-load factor and
+ * normalised at the end, so no maths library is needed.
+ */
+static double false_positives(double load)
+{
+    double term = 1;
+    double total = 0;
+    double weighted = 0;
+    double clear = 1;
+    for (int i = 0; i < 1000 && (i < load || term > total * 1e-12); i++)
+    {
+        // Chance that a bit is set in a word holding i keys, for each of the words
+        double bit = 1 - clear;
+        double fp = bit * bit;
+        fp *= fp;
+        fp *= fp;
+
+        total += term;
+        weighted += term * fp;
+        term *= load / (i + 1);
+        clear *= 1 - 1.0 / 32;
+    }
+
+    return weighted / total;
+}
+
+/*
+ * Builds the bit in each word of a block that a hash sets. The low 32 bits of the hash are
+ * multiplied by each salt and the top five bits of the product pick the bit.
+ */
+static void make_mask(uint64_t hash_val, uint32_t *mask)
+{
+    uint32_t low = (uint32_t)hash_val;
+    for (int i = 0; i < WORDS; i++)
+    {
+        mask[i] = 1U << ((low * SALT[i]) >> 27);
+    }
+}
+
+/*
+ * Gets the block for a hash from its high 32 bits
+ */
+static block *block_of(const bloom *bf, uint64_t hash_val)
+{
+    return &bf->blocks[((hash_val >> 32) * bf->count) >> 32];
+}
+
+/*
+ * Sets the bits of a hash
+ */
+static void set_bits(bloom *bf, uint64_t hash_val)
+{
+    uint32_t mask[WORDS];
+    make_mask(hash_val, mask);
+
+    block *bl = block_of(bf, hash_val);
+    for (int i = 0; i < WORDS; i++)
+    {
+        bl->words[i] |= mask[i];
+    }
+
+    bf->head.size++;
+}
+
+/*
+ * Checks whether all of the bits of a hash are set
+ */
+static int test_bits(const bloom *bf, uint64_t hash_val)
+{
+    uint32_t mask[WORDS];
+    make_mask(hash_val, mask);
+
+    const block *bl = block_of(bf, hash_val);
+    uint32_t missing = 0;
+    for (int i = 0; i < WORDS; i++)
+    {
+        missing |= mask[i] & ~bl->words[i];
+    }
+
+    return !missing;
+}
+
+/*
+ * Filters have no items to iterate over
+ */
+static void *alloc_iter_state(const void *filter)
+{
+    UNUSED(filter);
+    return 0;
+}
+
+/*
+ * Filters have no items to iterate over
+ */
+static int get_next_iter(const void *filter, void *iter_state, void **next)
+{
+    UNUSED(filter);
+    UNUSED(iter_state);
+
+    *next = 0;
+    return 0;
+}
+
+/*
+ * Allocates the blocks of a filter aligned to a cache line
+ */
+static block *alloc_blocks(size_t count)
+{
+    void *rv;
+    if (posix_memalign(&rv, CACHE_LINE, count * sizeof(block)))
+    {
+        return 0;
+    }
+
+    return rv;
+}
+
+/*
+ * Copies a filter and its bits
+ */
+static void *copy_bloom_filter(const void *filter)
+{
+    const bloom *bf = filter;
+    bloom *rv = (bloom*)malloc(sizeof(bloom));
+    memcpy(rv, bf, sizeof(bloom));
+
+    rv->blocks = alloc_blocks(bf->count);
+    memcpy(rv->blocks, bf->blocks, bf->count * sizeof(block));
+    return rv;
+}
+
+/*
+ * Frees a filter. The filter does not hold the keys, so items is ignored.
+ */
+static void free_bloom_filter(void *filter, int items)
+{
+    UNUSED(items);
+
+    bloom *bf = filter;
+    free(bf->blocks);
+    free(bf);
+}
+
+/*
+ * Writes the number of blocks and then the filter bits. The filter does not hold the keys, so
+ * the codec is not used.
+ */
+static int write_bloom_filter(const void *filter, FILE *fp, const clxns_codec *codec)
+{
+    UNUSED(codec);
+
+    const bloom *bf = filter;
+    return serial_write_uint(fp, bf->count) && fwrite(bf->blocks, sizeof(block), bf->count, fp) == bf->count;
+}
+
+/*
+ * Reads the bits of a filter written with count keys and adds them to this filter, which must
+ * have the same number of blocks. The result holds the keys of both.
+ */
+static int read_bloom_filter(void *filter, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    UNUSED(codec);
+
+    bloom *bf = filter;
+    uint64_t blocks;
+    if (!serial_read_uint(fp, &blocks) || blocks != bf->count)
+    {
+        return 0;
+    }
+
+    block bl;
+    for (size_t i = 0; i < bf->count; i++)
+    {
+        if (fread(&bl, sizeof(block), 1, fp) != 1)
+        {
+            return 0;
+        }
+
+        for (int j = 0; j < WORDS; j++)
+        {
+            bf->blocks[i].words[j] |= bl.words[j];
+        }
+    }
+
+    bf->head.size += count;
+    return 1;
+}
+
+/*
+ * Creates a new Bloom filter sized so that it gives false positives for about fp_rate of the
+ * keys tested once expected keys have been added. Returns null if the blocks cannot be
+ * allocated.
+ */
+void *bloom_filter(size_t expected, double fp_rate)
+{
+    // Lower the number of keys per block until the rate is met
+    double load = 64;
+    while (load > 0.5 && false_positives(load) > fp_rate)
+    {
+        load *= 15.0 / 16;
+    }
+
+    size_t count = (size_t)(expected / load) + 1;
+    count = count > UINT32_MAX ? UINT32_MAX : count;
+
+    bloom *bf = (bloom*)malloc(sizeof(bloom));
+    bf->blocks = alloc_blocks(count);
+    if (!bf->blocks)
+    {
+        free(bf);
+        return 0;
+    }
+
+    memset(bf->blocks, 0, count * sizeof(block));
+    bf->count = count;
+
+    bf->head.size = 0;
+    bf->head.alloc_iter_state = alloc_iter_state;
+    bf->head.get_next_iter = get_next_iter;
+    bf->head.free_iter = 0;
+    bf->head.copy_collection = copy_bloom_filter;
+    bf->head.free_collection = free_bloom_filter;
+    bf->head.write_items = write_bloom_filter;
+    bf->head.read_items = read_bloom_filter;
+
+    return bf;
+}
+
+/*
+ * Adds a key to the filter
+ */
+void bloom_filter_add(void *filter, const char *key)
+{
+    bloom_filter_add_bin(filter, key, strlen(key));
+}
+
+/*
+ * Tests whether a key may have been added to the filter. Returns zero if it was not.
+ */
+int bloom_filter_test(const void *filter, const char *key)
+{
+    return bloom_filter_test_bin(filter, key, strlen(key));
+}
+
+/*
+ * Adds a binary key of len bytes to the filter
+ */
+void bloom_filter_add_bin(void *filter, const void *key, size_t len)
+{
+    set_bits(filter, clxns_hash_wy(key, len, 0));
+}
+
+/*
+ * Tests whether a binary key of len bytes may have been added to the filter
+ */
+int bloom_filter_test_bin(const void *filter, const void *key, size_t len)
+{
+    return test_bits(filter, clxns_hash_wy(key, len, 0));
+}
+
+/*
+ * Adds a key which has already been hashed with clxns_hash_wy and a zero seed
+ */
+void bloom_filter_add_hash(void *filter, uint64_t hash_val)
+{
+    set_bits(filter, hash_val);
+}
+
+/*
+ * Tests a key which has already been hashed with clxns_hash_wy and a zero seed
+ */
+int bloom_filter_test_hash(const void *filter, uint64_t hash_val)
+{
+    return test_bits(filter, hash_val);
+}
+
+/*
+ * Hashes a batch of keys and prefetches their blocks, so that the cache misses of the batch
+ * overlap rather than being taken one at a time
+ */
+static void hash_batch(const bloom *bf, char **keys, size_t n, uint64_t *hashes)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        hashes[i] = clxns_hash_wy(keys[i], strlen(keys[i]), 0);
+        __builtin_prefetch(block_of(bf, hashes[i]));
+    }
+}
+
+/*
+ * Adds n keys to the filter
+ */
+void bloom_filter_add_many(void *filter, char **keys, size_t n)
+{
+    uint64_t hashes[BATCH_SIZE];
+    for (size_t i = 0; i < n; i += BATCH_SIZE)
+    {
+        size_t batch = n - i < BATCH_SIZE ? n - i : BATCH_SIZE;
+        hash_batch(filter, &keys[i], batch, hashes);
+        for (size_t j = 0; j < batch; j++)
+        {
+            set_bits(filter, hashes[j]);
+        }
+    }
+}
+
+/*
+ * Tests n keys, setting results[i] to non-zero if keys[i] may have been added
+ */
+void bloom_filter_test_many(const void *filter, char **keys, size_t n, unsigned char *results)
+{
+    uint64_t hashes[BATCH_SIZE];
+    for (size_t i = 0; i < n; i += BATCH_SIZE)
+    {
+        size_t batch = n - i < BATCH_SIZE ? n - i : BATCH_SIZE;
+        hash_batch(filter, &keys[i], batch, hashes);
+        for (size_t j = 0; j < batch; j++)
+        {
+            results[i + j] = (unsigned char)test_bits(filter, hashes[j]);
+        }
+    }
+}
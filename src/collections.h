@@ -2,21 +2,33 @@
 #define COLLECTIONS_H
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
 
 // Key/value pair, returned by the hash table iterator
 typedef struct _kvp
 {
     char *key;
     void *value;
+    size_t key_len; // length of the key in bytes, not including the terminator of string keys
 } kvp;
 
+// Integer key/value pair, returned by the int table iterator
+typedef struct _ikvp
+{
+    uint64_t key;
+    void *value;
+} ikvp;
+
 // Function return codes
 typedef enum
 {
     C_OK         = 0,
     CE_BOUNDS    = 1,  // requested item was out of bounds of the array
     CE_NULL_ITEM = 2,  // add null item to priority queue
-    CE_MISSING   = 3   // item not found in hash table 
+    CE_MISSING   = 3,  // item not found in hash table 
+    CE_IO        = 4,  // file could not be read or written
+    CE_BY_VALUE  = 5   // item pointer function used on an array holding elements by value
 } C_STATUS;
 
 // == COMMON ==================================================================
@@ -42,29 +54,111 @@ void *clxns_copy(const void *collection);
 // Free memory held directly by the collection, optionally clear collection contents too
 void clxns_free(void *collection, int items);
 
+// Turns items in to bytes and back for clxns_serialize and clxns_deserialize
+typedef struct _clxns_codec
+{
+    const void *(*encode)(const void *item, size_t *len, void *ctx); // return the item's bytes and set len
+    void *(*decode)(const void *data, size_t len, void *ctx);        // return a new item made from len bytes
+    void *ctx;                                                       // passed to encode and decode
+} clxns_codec;
+
+// Codec for string items, decoded strings are allocated with malloc
+extern const clxns_codec clxns_string_codec;
+
+// Write the collection to a stream, values encoded by the codec
+C_STATUS clxns_serialize(const void *collection, FILE *fp, const clxns_codec *codec);
+
+// Read items written by clxns_serialize in to a collection of the same type, usually empty
+C_STATUS clxns_deserialize(void *collection, FILE *fp, const clxns_codec *codec);
+
 // == RESIZE ARRAY =============================================================
 
+// How a resize array grows and shrinks. The default doubles when full and halves when a
+// quarter full.
+typedef struct _ra_policy
+{
+    double growth;     // capacity is multiplied by this when the array is full, above 1
+    double shrink_at;  // shrink once the array is this full or less, e.g. 0.25
+    double shrink_to;  // how full the array is after shrinking, between shrink_at and 1
+    int no_shrink;     // non-zero to only shrink on resize_array_shrink_to_fit
+} ra_policy;
+
 // Create and return a new array. Specify the initial size.
 void *resize_array(size_t init_size);
 
+// Set the growth policy of the array, CE_BOUNDS if it is outside the ranges above
+C_STATUS resize_array_set_policy(void *array, const ra_policy *policy);
+
+// Make room for n items without reallocating
+void resize_array_reserve(void *array, size_t n);
+
+// Release any capacity not being used by the items in the array
+void resize_array_shrink_to_fit(void *array);
+
+// Return the number of items the array can hold before it reallocates
+size_t resize_array_capacity(const void *array);
+
+// The functions below take and return item pointers, on a value array they return CE_BY_VALUE.
+// resize_array_exchange works on both.
+
 // Add an item to the array
-void resize_array_add(void *array, void *item);
+C_STATUS resize_array_add(void *array, void *item);
 
 // Insert an item in to the middle of an array
 C_STATUS resize_array_insert(void *array, size_t index, void *item);
 
 // Replace an item in the array with a different item
-void resize_array_replace(void *array, size_t index, void *item);
+C_STATUS resize_array_replace(void *array, size_t index, void *item);
 
 // Access an item at the given position in the array
 C_STATUS resize_array_get(const void *array, size_t index, void **item);
 
-// Swap two items in the array
+// Swap two items, or two elements of a value array
 C_STATUS resize_array_exchange(void *array, size_t first, size_t second);
 
 // Remove an item from the array, set item to the value if non-zero is passed in
 C_STATUS resize_array_remove(void *array, size_t index, void **item);
 
+// Insert n items from a C array at the given position, moving the later items once
+C_STATUS resize_array_insert_range(void *array, size_t index, void **items, size_t n);
+
+// Remove n items starting at index, copy them to items if non-zero is passed in
+C_STATUS resize_array_remove_range(void *array, size_t index, size_t n, void **items);
+
+// Add n items from a C array, or the items of another collection, to the end of the array
+C_STATUS resize_array_extend(void *array, void **items, size_t n);
+C_STATUS resize_array_extend_collection(void *array, const void *collection);
+
+// Create and return a new array holding elements of elem_size bytes by value. Use the functions
+// below to access them; the count, iterator, copy, free, policy, capacity, exchange, serialize
+// and sort functions also work.
+void *resize_array_of(size_t elem_size, size_t init_size);
+
+// Get a pointer to an element of a value array, null if out of bounds
+void *resize_array_at(const void *array, size_t index);
+
+// Copy an element to the end of, or in to the middle of, a value array
+void resize_array_add_value(void *array, const void *elem);
+C_STATUS resize_array_insert_value(void *array, size_t index, const void *elem);
+
+// Copy an element out of, or over an element in, a value array
+C_STATUS resize_array_get_value(const void *array, size_t index, void *elem);
+C_STATUS resize_array_put_value(void *array, size_t index, const void *elem);
+
+// Remove an element from a value array, copy it to elem if non-zero is passed in
+C_STATUS resize_array_remove_value(void *array, size_t index, void *elem);
+
+// Sort the array in place, or with up to nthreads threads, one if nthreads is less than one.
+// Neither sort is stable. Value arrays pass pointers to their elements to the compare function.
+void resize_array_sort(void *array, int (*compare)(const void *first, const void *second));
+void resize_array_sort_parallel(void *array, int (*compare)(const void *first, const void *second), int nthreads);
+
+// Sort the array by an integer key got once from each item, or from a pointer to each element
+// of a value array. The sort is stable. The parallel version gets the keys on nthreads threads,
+// one if nthreads is less than one.
+void resize_array_radix_sort(void *array, uint64_t (*key_fn)(const void *item));
+void resize_array_radix_sort_parallel(void *array, uint64_t (*key_fn)(const void *item), int nthreads);
+
 // == PRIORITY QUEUE ===========================================================
 
 /*
@@ -86,9 +180,31 @@ C_STATUS priority_queue_pop(void *pqueue, void **item);
 
 // == HASH TABLE ==============================================================
 
+// Hash function, hashes len bytes of key. The seed allows tables to be hashed independently.
+typedef uint64_t (*clxns_hash)(const void *key, size_t len, uint64_t seed);
+
+// Built-in hash functions
+uint64_t clxns_hash_djb2(const void *key, size_t len, uint64_t seed); // byte at a time, the default
+uint64_t clxns_hash_wy(const void *key, size_t len, uint64_t seed);   // fast, word at a time
+uint64_t clxns_hash_sip(const void *key, size_t len, uint64_t seed);  // flood resistant, use a secret seed
+
+// Hash table options, combine with |
+typedef enum
+{
+    HT_DEFAULT     = 0,
+    HT_INCREMENTAL = 1,  // resize a few slots at a time on each add / remove rather than all at once
+    HT_POW2        = 2   // power of two capacity, slots found by multiply and shift rather than modulo
+} HT_FLAGS;
+
 // Create and return a new hash table. Specify the initial size.
 void *hash_table(size_t init_size);
 
+// Create and return a new hash table which uses the given hash function and seed
+void *hash_table_seeded(size_t init_size, clxns_hash hash, uint64_t seed);
+
+// Set the HT_FLAGS options for the table
+void hash_table_set_flags(void *table, int flags);
+
 // Associate a key with a value
 void hash_table_add(void *table, char *key, void *value);
 
@@ -98,4 +214,249 @@ C_STATUS hash_table_get(const void *table, const char *key, void **value);
 // Remove the key/value pair
 C_STATUS hash_table_remove(void *table, const char *key, int items);
 
+// Copy keys of up to max_len bytes in to the table, saving a pointer dereference on lookup
+void hash_table_set_inline(void *table, size_t max_len);
+
+// Called by hash_table_upsert to update a value in place, inserted is non-zero for a new key
+typedef void (*clxns_update)(void **value, int inserted, void *ctx);
+
+// Return a pointer to the value for the key, adding the key with a null value if missing.
+// Sets inserted to non-zero if the key was added, inserted may be null.
+void **hash_table_get_or_insert(void *table, char *key, int *inserted);
+
+// Find or add the key and pass a pointer to its value to update
+void hash_table_upsert(void *table, char *key, clxns_update update, void *ctx);
+
+// Add n key/value pairs in one go, values may be null
+void hash_table_add_many(void *table, char **keys, void **values, size_t n);
+
+// Size the table to hold n items without growing
+void hash_table_reserve(void *table, size_t n);
+
+// Variants of add / get / remove for binary keys of len bytes
+void hash_table_add_bin(void *table, void *key, size_t len, void *value);
+C_STATUS hash_table_get_bin(const void *table, const void *key, size_t len, void **value);
+C_STATUS hash_table_remove_bin(void *table, const void *key, size_t len, int items);
+
+// Hash a key once for the _prehashed variants, which take the hash instead of hashing the key.
+// Tables with the same hash function and seed share hashes, a hash is only valid for those.
+uint64_t hash_table_hash(const void *table, const char *key);
+void hash_table_add_prehashed(void *table, char *key, uint64_t hash, void *value);
+C_STATUS hash_table_get_prehashed(const void *table, const char *key, uint64_t hash, void **value);
+C_STATUS hash_table_remove_prehashed(void *table, const char *key, uint64_t hash, int items);
+
+// Check the keys against a filter from bloom_filter before looking them up, so most missing keys
+// are rejected without a lookup. The table's keys are added to the filter and new keys are
+// added as they arrive. The filter is not freed with the table, pass null to detach it. Tables
+// made by hash_table_seeded with clxns_hash_wy and a zero seed give the filter the hash they
+// already have, including the one passed to the _prehashed functions, others hash keys again.
+void hash_table_set_filter(void *table, void *filter);
+
+// Number of chain lengths counted by hash_table_stats, the last counts that length or longer
+#define HT_STATS_CHAINS 8
+
+// Occupancy and probe statistics for a hash table
+typedef struct _ht_stats
+{
+    size_t count;                    // number of items
+    size_t capacity;                 // number of slots, including those still being migrated
+    size_t filled;                   // number of slots with at least one item
+    double load_factor;              // count / capacity
+    size_t chains[HT_STATS_CHAINS];  // number of slots with a chain of each length
+    size_t max_chain;                // length of the longest chain
+    size_t resizes;                  // number of resizes
+    double resize_secs;              // time spent resizing, incremental steps timed only with CLXNS_PROBE_STATS
+    size_t bytes;                    // memory used by the table, not counting keys and values
+    uint64_t lookups;                // key lookups, only counted when built with CLXNS_PROBE_STATS
+    uint64_t probes;                 // nodes looked at by lookups, as above
+} ht_stats;
+
+// Fill in statistics on the table's occupancy, chain lengths and resizing
+void hash_table_stats(const void *table, ht_stats *stats);
+
+// == FROZEN TABLE ============================================================
+
+/*
+ * Create and return a read-only copy of a hash table backed by a minimal perfect hash. There is
+ * one entry per key and a lookup looks at one entry. The keys and values are shared with the
+ * hash table, free them with only one of the two. Returns null if the keys are not unique.
+ */
+void *hash_table_freeze(const void *table);
+
+// Return the value associated with the key
+C_STATUS frozen_table_get(const void *table, const char *key, void **value);
+C_STATUS frozen_table_get_bin(const void *table, const void *key, size_t len, void **value);
+
+// == BLOOM FILTER ============================================================
+
+/*
+ * Create and return a blocked Bloom filter for about expected keys, giving false positives for
+ * about fp_rate of the missing keys tested. The filter's count is the number of keys added.
+ */
+void *bloom_filter(size_t expected, double fp_rate);
+
+// Add a key to the filter. Keys cannot be removed.
+void bloom_filter_add(void *filter, const char *key);
+
+// Return zero if the key was definitely not added, non-zero if it may have been
+int bloom_filter_test(const void *filter, const char *key);
+
+// Variants of add / test for binary keys of len bytes
+void bloom_filter_add_bin(void *filter, const void *key, size_t len);
+int bloom_filter_test_bin(const void *filter, const void *key, size_t len);
+
+// Variants of add / test for keys already hashed with clxns_hash_wy and a zero seed
+void bloom_filter_add_hash(void *filter, uint64_t hash);
+int bloom_filter_test_hash(const void *filter, uint64_t hash);
+
+// Add or test n keys in one go, test sets results[i] to the result for keys[i]
+void bloom_filter_add_many(void *filter, char **keys, size_t n);
+void bloom_filter_test_many(const void *filter, char **keys, size_t n, unsigned char *results);
+
+// == OPEN TABLE ==============================================================
+
+// Create and return a new open addressing hash table. Specify the initial size.
+void *open_table(size_t init_size);
+
+// Create and return a new open table which uses the given hash function and seed
+void *open_table_seeded(size_t init_size, clxns_hash hash, uint64_t seed);
+
+// Associate a key with a value
+void open_table_add(void *table, char *key, void *value);
+
+// Return the value associated with the key
+C_STATUS open_table_get(const void *table, const char *key, void **value);
+
+// Remove the key/value pair
+C_STATUS open_table_remove(void *table, const char *key, int items);
+
+// == DENSE TABLE =============================================================
+
+// Create and return a new compact hash table which iterates in insertion order. Specify the
+// initial size.
+void *dense_table(size_t init_size);
+
+// Associate a key with a value, a new key goes after all the others
+void dense_table_add(void *table, char *key, void *value);
+
+// Return the value associated with the key
+C_STATUS dense_table_get(const void *table, const char *key, void **value);
+
+// Remove the key/value pair
+C_STATUS dense_table_remove(void *table, const char *key, int items);
+
+// == LRU CACHE ===============================================================
+
+// Cache eviction policies
+typedef enum
+{
+    CACHE_LRU   = 0,  // evict the least recently used entry, a get moves the entry
+    CACHE_CLOCK = 1   // second chance, a get only sets a bit so reads do not write to the ring
+} CACHE_POLICY;
+
+// Called with the key and value of an entry evicted from a cache
+typedef void (*clxns_evict)(char *key, void *value, void *ctx);
+
+/*
+ * Create and return a new cache holding entries whose sizes add up to at most capacity.
+ * Specify a CACHE_POLICY. Iterates from the next entry to be evicted.
+ */
+void *lru_cache(size_t capacity, int policy);
+
+// Set the function called with each evicted entry
+void lru_cache_set_evict(void *cache, clxns_evict evict, void *ctx);
+
+// Associate a key with a value, with a size of one so the capacity counts entries
+void lru_cache_put(void *cache, char *key, void *value);
+
+// Associate a key with a value of the given size, for a capacity in bytes
+void lru_cache_put_sized(void *cache, char *key, void *value, size_t size);
+
+// Return the value associated with the key and mark it as used
+C_STATUS lru_cache_get(void *cache, const char *key, void **value);
+
+// Remove the key/value pair, the eviction function is not called
+C_STATUS lru_cache_remove(void *cache, const char *key, int items);
+
+// == CONCURRENT TABLE ========================================================
+
+/*
+ * Create and return a new hash table which may be shared between threads. Specify the
+ * initial size. The table is locked for reading while a copy is made. Iterators copy the
+ * items a stripe at a time, so the table may be changed while iterating.
+ */
+void *concurrent_table(size_t init_size);
+
+// Create and return a new concurrent table which uses the given hash function and seed
+void *concurrent_table_seeded(size_t init_size, clxns_hash hash, uint64_t seed);
+
+// Associate a key with a value
+void concurrent_table_add(void *table, char *key, void *value);
+
+// Return the value associated with the key
+C_STATUS concurrent_table_get(const void *table, const char *key, void **value);
+
+// Remove the key/value pair
+C_STATUS concurrent_table_remove(void *table, const char *key, int items);
+
+// == SNAPSHOT TABLE ==========================================================
+
+/*
+ * Create and return a new hash table for data which is read far more often than it is changed.
+ * One writer thread adds and removes keys, which readers do not see until it publishes them.
+ * Reader threads look keys up without locks. Count, iterate, copy and free from the writer only.
+ */
+void *snapshot_table(size_t init_size);
+
+// Associate a key with a value, seen by readers once published
+void snapshot_table_add(void *table, char *key, void *value);
+
+// Remove the key/value pair, seen by readers once published. Never frees the key or value.
+C_STATUS snapshot_table_remove(void *table, const char *key);
+
+// Make the changes since the last publish visible to readers
+void snapshot_table_publish(void *table);
+
+// Create and return a reader of the table, one per reading thread
+void *snapshot_reader(void *table);
+
+// Free a reader
+void snapshot_reader_free(void *reader);
+
+// Return the value associated with the key in the latest published version
+C_STATUS snapshot_table_get(void *reader, const char *key, void **value);
+
+// == MAPPED TABLE ============================================================
+
+/*
+ * Write the key/value pairs of a hash table, or any collection iterating kvp items, to a file
+ * which can be opened with mapped_table. If value_size is zero the values are strings,
+ * otherwise each value points to value_size bytes.
+ */
+C_STATUS mapped_table_write(const void *collection, const char *path, size_t value_size);
+
+/*
+ * Open a file written by mapped_table_write as a read-only hash table. The file is memory
+ * mapped and queried in place. Returns null if the file cannot be opened.
+ */
+void *mapped_table(const char *path);
+
+// Return the value associated with the key, the value points in to the file
+C_STATUS mapped_table_get(const void *table, const char *key, void **value);
+C_STATUS mapped_table_get_bin(const void *table, const void *key, size_t len, void **value);
+
+// == INT TABLE ===============================================================
+
+// Create and return a new hash table with integer keys. Specify the initial size.
+void *int_table(size_t init_size);
+
+// Associate a key with a value
+void int_table_add(void *table, uint64_t key, void *value);
+
+// Return the value associated with the key
+C_STATUS int_table_get(const void *table, uint64_t key, void **value);
+
+// Remove the key/value pair, optionally free the value
+C_STATUS int_table_remove(void *table, uint64_t key, int items);
+
 #endif
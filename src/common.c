@@ -3,8 +3,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "common.h"
 #include "collections.h"
+#include "serial.h"
 
 // A collection iterator
 typedef struct {
@@ -14,12 +16,13 @@ typedef struct {
 } iterator_t;
 
 /*
- * Returns the number of items in the collection
+ * Returns the number of items in the collection. The size is loaded atomically as the
+ * concurrent tables update it from several threads.
  */
 size_t clxns_count(const void *collection)
 {
     const header *head = collection;
-    return head->size;
+    return __atomic_load_n(&head->size, __ATOMIC_RELAXED);
 }
 
 /*
@@ -90,3 +93,74 @@ void clxns_free(void *collection, int items)
     const header *hdr = collection;
     hdr->free_collection(collection, items);
 }
+
+/*
+ * Returns the bytes of a string item, not including the terminator
+ */
+static const void *encode_string(const void *item, size_t *len, void *ctx)
+{
+    UNUSED(ctx);
+
+    *len = strlen(item);
+    return item;
+}
+
+/*
+ * Makes a new string from len bytes
+ */
+static void *decode_string(const void *data, size_t len, void *ctx)
+{
+    UNUSED(ctx);
+
+    char *rv = malloc(len + 1);
+    memcpy(rv, data, len);
+    rv[len] = 0;
+    return rv;
+}
+
+const clxns_codec clxns_string_codec = { encode_string, decode_string, 0 };
+
+// Identifies a serialized collection and its format version
+static const char magic[4] = { 'C', 'L', 'X', '1' };
+
+/*
+ * Writes the collection to a stream. Writes a short header and the number of items, then
+ * hands over to the collection to write the items.
+ */
+C_STATUS clxns_serialize(const void *collection, FILE *fp, const clxns_codec *codec)
+{
+    const header *hdr = collection;
+    if (!hdr->write_items)
+    {
+        return CE_IO;
+    }
+
+    flockfile(fp);
+    int ok = fwrite(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+             serial_write_uint(fp, hdr->size) &&
+             hdr->write_items(collection, fp, codec);
+    funlockfile(fp);
+    return ok ? C_OK : CE_IO;
+}
+
+/*
+ * Reads a collection written by clxns_serialize. The number of items is read first so that
+ * the collection can be sized once before the items are added.
+ */
+C_STATUS clxns_deserialize(void *collection, FILE *fp, const clxns_codec *codec)
+{
+    const header *hdr = collection;
+    char check[sizeof(magic)];
+    uint64_t count;
+    if (!hdr->read_items)
+    {
+        return CE_IO;
+    }
+
+    flockfile(fp);
+    int ok = fread(check, 1, sizeof(check), fp) == sizeof(check) &&
+             !memcmp(check, magic, sizeof(magic)) && serial_read_uint(fp, &count) &&
+             hdr->read_items(collection, fp, count, codec);
+    funlockfile(fp);
+    return ok ? C_OK : CE_IO;
+}
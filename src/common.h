@@ -1,6 +1,9 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <stdio.h>
+#include "collections.h"
+
 // Useful macro to repress unused warnings from the compiler
 #define UNUSED(...) (void)(__VA_ARGS__)
 
@@ -19,6 +22,10 @@ typedef struct header
     void *(*copy_collection)(const void *collection);
     // Frees the collection
     void (*free_collection)(void *collection, int items);
+    // Writes the items to a stream, null if the collection cannot be written
+    int (*write_items)(const void *collection, FILE *fp, const clxns_codec *codec);
+    // Reads count items from a stream in to the collection, null if it cannot be read in to
+    int (*read_items)(void *collection, FILE *fp, size_t count, const clxns_codec *codec);
 } header;
 
 #endif
@@ -0,0 +1,478 @@
+/*
+ * Implementation functions for the concurrent hash table. A chained hash table which may be
+ * shared between threads. The slots are split in to stripes, each guarded by its own lock, so
+ * threads working on different stripes do not contend.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+#include "pool.h"
+
+// Number of lock stripes, a power of two. The capacity is always a multiple of this.
+#define STRIPES 64
+
+// Size of a cache line, stripes are padded to this to stop neighbouring locks sharing a line
+#define CACHE_LINE 64
+
+// Default size of a concurrent table if none is supplied by the user
+#define DEF_SIZE STRIPES
+
+// An item in the table
+typedef struct _node
+{
+    kvp key_value;      // key and value pair
+    uint64_t hash;      // the hash of the key
+    struct _node *next; // next item in the linked list of nodes
+} node;
+
+// A lock stripe. Guards the slots whose index modulo STRIPES is the stripe index, and the
+// nodes in them.
+typedef struct _stripe
+{
+    pthread_rwlock_t lock; // read lock to get, write lock to change
+    pool nodes;            // allocator for the nodes in the stripe
+} stripe;
+
+// A stripe padded out to whole cache lines
+typedef union _padded_stripe
+{
+    stripe s;
+    char pad[(sizeof(stripe) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE];
+} padded_stripe;
+
+// The concurrent table. The array and capacity may only be read while holding a stripe lock,
+// and only changed while holding all of them.
+typedef struct _conc_tab
+{
+    header head;
+    padded_stripe *stripes; // the lock stripes
+    node **array;           // hash table slots
+    size_t capacity;        // number of slots, a power of two
+    clxns_hash hash;        // hashes the keys
+    uint64_t seed;          // seed passed to the hash function
+} conc_tab;
+
+// State to iterate over the table. Holds a copy of the items of one stripe at a time.
+typedef struct _iter_state
+{
+    conc_tab *ct;   // the table being iterated
+    size_t stripe;  // next stripe to copy
+    kvp *items;     // copies of the items in the current stripe
+    size_t count;   // number of items copied
+    size_t cap;     // size of the items buffer
+    size_t next;    // next item to return
+} iter_state;
+
+/*
+ * Takes every stripe lock, always in the same order so that two threads doing this cannot
+ * deadlock
+ */
+static void lock_all(conc_tab *ct, int write)
+{
+    for (size_t i = 0; i < STRIPES; i++)
+    {
+        if (write)
+        {
+            pthread_rwlock_wrlock(&ct->stripes[i].s.lock);
+        }
+        else
+        {
+            pthread_rwlock_rdlock(&ct->stripes[i].s.lock);
+        }
+    }
+}
+
+/*
+ * Releases every stripe lock
+ */
+static void unlock_all(conc_tab *ct)
+{
+    for (size_t i = 0; i < STRIPES; i++)
+    {
+        pthread_rwlock_unlock(&ct->stripes[i].s.lock);
+    }
+}
+
+/*
+ * Gets the stripe for a hash. Slot indexes are the low bits of the hash, so every slot of a
+ * stripe stays in that stripe whatever the capacity.
+ */
+static stripe *stripe_of(const conc_tab *ct, uint64_t hash_val)
+{
+    return &ct->stripes[hash_val & (STRIPES - 1)].s;
+}
+
+/*
+ * Searches the linked list pointed to by head for the given key
+ */
+static node **find(node **head, const char *key, size_t len, uint64_t hash_val)
+{
+    while (*head)
+    {
+        const kvp *kv = &(*head)->key_value;
+        if ((*head)->hash == hash_val && kv->key_len == len && !memcmp(kv->key, key, len))
+        {
+            return head;
+        }
+
+        head = &(*head)->next;
+    }
+
+    return 0;
+}
+
+/*
+ * Grows the table to the new power of two size, holding every stripe while the nodes are moved.
+ * Another thread may have grown the table while this one waited for the locks, so the need is
+ * checked again.
+ */
+static void grow(conc_tab *ct, size_t seen_capacity, size_t new_size)
+{
+    lock_all(ct, 1);
+    if (ct->capacity == seen_capacity)
+    {
+        node **array = calloc(new_size, sizeof(node*));
+        for (size_t i = 0; i < ct->capacity; i++)
+        {
+            node *nn = ct->array[i];
+            while (nn)
+            {
+                node *next = nn->next;
+                node **head = &array[nn->hash & (new_size - 1)];
+                nn->next = *head;
+                *head = nn;
+                nn = next;
+            }
+        }
+
+        free(ct->array);
+        ct->array = array;
+        ct->capacity = new_size;
+    }
+
+    unlock_all(ct);
+}
+
+/*
+ * Copies the items of the next stripe which has any in to the iterator. The stripe is only
+ * locked while it is copied. Items never move between stripes, so an item which is in the
+ * table for the whole iteration is returned exactly once.
+ */
+static void copy_stripe(iter_state *st)
+{
+    conc_tab *ct = st->ct;
+    st->count = 0;
+    st->next = 0;
+    while (!st->count && st->stripe < STRIPES)
+    {
+        size_t index = st->stripe++;
+        pthread_rwlock_t *lock = &ct->stripes[index].s.lock;
+        pthread_rwlock_rdlock(lock);
+        for (; index < ct->capacity; index += STRIPES)
+        {
+            for (node *nn = ct->array[index]; nn; nn = nn->next)
+            {
+                if (st->count == st->cap)
+                {
+                    st->cap = st->cap ? st->cap * 2 : STRIPES;
+                    st->items = realloc(st->items, st->cap * sizeof(kvp));
+                }
+
+                st->items[st->count++] = nn->key_value;
+            }
+        }
+
+        pthread_rwlock_unlock(lock);
+    }
+}
+
+/*
+ * Creates a new iterator. No locks are held between calls, so other threads, and this one, may
+ * change the table while iterating. Items added or removed during the iteration may or may not
+ * be returned.
+ */
+static void *alloc_iter_state(const void *table)
+{
+    iter_state *st = (iter_state*)malloc(sizeof(iter_state));
+    st->ct = (conc_tab*)table;
+    st->stripe = 0;
+    st->items = 0;
+    st->cap = 0;
+    copy_stripe(st);
+    return st;
+}
+
+/*
+ * Gets the next key/value pair from the iterator. It points to the iterator's copy of the pair,
+ * which is valid until the next call.
+ */
+static int get_next_iter(const void *table, void *iter_state_ptr, void **next)
+{
+    UNUSED(table);
+
+    iter_state *st = iter_state_ptr;
+    if (st->next == st->count)
+    {
+        copy_stripe(st);
+    }
+
+    if (st->next < st->count)
+    {
+        *next = &st->items[st->next++];
+        return 1;
+    }
+
+    *next = 0;
+    return 0;
+}
+
+/*
+ * Frees the iterator and its copied items
+ */
+static void free_iter(void *iter_state_ptr)
+{
+    iter_state *st = iter_state_ptr;
+    free(st->items);
+    free(st);
+}
+
+/*
+ * Copies a concurrent table. The original is locked for reading while it is copied.
+ */
+static void *copy_concurrent_table(const void *table)
+{
+    conc_tab *orig = (conc_tab*)table;
+    lock_all(orig, 0);
+
+    conc_tab *rv = concurrent_table_seeded(orig->capacity, orig->hash, orig->seed);
+    for (size_t i = 0; i < orig->capacity; i++)
+    {
+        for (node *nn = orig->array[i]; nn; nn = nn->next)
+        {
+            stripe *sp = stripe_of(rv, nn->hash);
+            node *cp = pool_alloc(&sp->nodes);
+            *cp = *nn;
+            cp->next = rv->array[nn->hash & (rv->capacity - 1)];
+            rv->array[nn->hash & (rv->capacity - 1)] = cp;
+        }
+    }
+
+    rv->head.size = orig->head.size;
+    unlock_all(orig);
+    return rv;
+}
+
+/*
+ * Frees a concurrent table. No other thread may be using the table. If items is non-zero the
+ * keys and values are freed too.
+ */
+static void free_concurrent_table(void *table, int items)
+{
+    conc_tab *ct = table;
+    if (items)
+    {
+        for (size_t i = 0; i < ct->capacity; i++)
+        {
+            for (node *nn = ct->array[i]; nn; nn = nn->next)
+            {
+                free(nn->key_value.key);
+                free(nn->key_value.value);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < STRIPES; i++)
+    {
+        pthread_rwlock_destroy(&ct->stripes[i].s.lock);
+        pool_destroy(&ct->stripes[i].s.nodes);
+    }
+
+    free(ct->stripes);
+    free(ct->array);
+    free(ct);
+}
+
+/*
+ * Reads count key/value pairs in to the table. Grows the table once up front to hold them.
+ */
+static int read_concurrent_table(void *table, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    conc_tab *ct = table;
+    pthread_rwlock_rdlock(&ct->stripes[0].s.lock);
+    size_t capacity = ct->capacity;
+    pthread_rwlock_unlock(&ct->stripes[0].s.lock);
+
+    size_t sz = capacity;
+    size_t needed = ct->head.size + serial_presize(count);
+    while (sz < needed)
+    {
+        sz <<= 1;
+    }
+
+    if (sz != capacity)
+    {
+        grow(ct, capacity, sz);
+    }
+
+    serial_buf buf = { 0, 0 };
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        kvp kv;
+        ok = serial_read_kvp(fp, codec, &buf, &kv);
+        if (ok)
+        {
+            concurrent_table_add(ct, kv.key, kv.value);
+        }
+    }
+
+    serial_buf_free(&buf);
+    return ok;
+}
+
+/*
+ * Creates a new concurrent table which hashes its keys with wyhash. The size is rounded up to a
+ * power of two, and to at least the number of lock stripes.
+ */
+void *concurrent_table(size_t init_size)
+{
+    return concurrent_table_seeded(init_size, clxns_hash_wy, 0);
+}
+
+/*
+ * Creates a new concurrent table which hashes its keys with the given function and seed
+ */
+void *concurrent_table_seeded(size_t init_size, clxns_hash hash, uint64_t seed)
+{
+    size_t sz = DEF_SIZE;
+    while (sz < init_size)
+    {
+        sz <<= 1;
+    }
+
+    conc_tab *ct = (conc_tab*)malloc(sizeof(conc_tab));
+    void *stripes;
+    if (posix_memalign(&stripes, CACHE_LINE, STRIPES * sizeof(padded_stripe)))
+    {
+        free(ct);
+        return 0;
+    }
+
+    ct->stripes = stripes;
+    for (size_t i = 0; i < STRIPES; i++)
+    {
+        pthread_rwlock_init(&ct->stripes[i].s.lock, 0);
+        pool_init(&ct->stripes[i].s.nodes, sizeof(node));
+    }
+
+    ct->array = calloc(sz, sizeof(node*));
+    ct->capacity = sz;
+    ct->hash = hash;
+    ct->seed = seed;
+
+    ct->head.size = 0;
+    ct->head.alloc_iter_state = alloc_iter_state;
+    ct->head.get_next_iter = get_next_iter;
+    ct->head.free_iter = free_iter;
+    ct->head.copy_collection = copy_concurrent_table;
+    ct->head.free_collection = free_concurrent_table;
+    ct->head.write_items = serial_write_kvps;
+    ct->head.read_items = read_concurrent_table;
+
+    return ct;
+}
+
+/*
+ * Adds a new key/value pair to the table. Grows the table once it holds more items than slots.
+ */
+void concurrent_table_add(void *table, char *key, void *value)
+{
+    conc_tab *ct = table;
+    size_t len = strlen(key);
+    uint64_t hash_val = ct->hash(key, len, ct->seed);
+    stripe *sp = stripe_of(ct, hash_val);
+
+    pthread_rwlock_wrlock(&sp->lock);
+    size_t capacity = ct->capacity;
+    node **head = &ct->array[hash_val & (capacity - 1)];
+    node **ptr = find(head, key, len, hash_val);
+    if (ptr)
+    {
+        (*ptr)->key_value.key = key;
+        (*ptr)->key_value.value = value;
+        pthread_rwlock_unlock(&sp->lock);
+        return;
+    }
+
+    node *nn = pool_alloc(&sp->nodes);
+    nn->key_value.key = key;
+    nn->key_value.key_len = len;
+    nn->key_value.value = value;
+    nn->hash = hash_val;
+    nn->next = *head;
+    *head = nn;
+    pthread_rwlock_unlock(&sp->lock);
+
+    size_t size = __atomic_add_fetch(&ct->head.size, 1, __ATOMIC_RELAXED);
+    if (size > capacity)
+    {
+        grow(ct, capacity, capacity * 2);
+    }
+}
+
+/*
+ * Returns the value associated with the given key. Readers of the same stripe do not block
+ * each other.
+ */
+C_STATUS concurrent_table_get(const void *table, const char *key, void **value)
+{
+    const conc_tab *ct = table;
+    size_t len = strlen(key);
+    uint64_t hash_val = ct->hash(key, len, ct->seed);
+    stripe *sp = stripe_of(ct, hash_val);
+
+    pthread_rwlock_rdlock(&sp->lock);
+    node **ptr = find(&ct->array[hash_val & (ct->capacity - 1)], key, len, hash_val);
+    *value = ptr ? (*ptr)->key_value.value : 0;
+    pthread_rwlock_unlock(&sp->lock);
+
+    return ptr ? C_OK : CE_MISSING;
+}
+
+/*
+ * Disassociates a value from a key
+ */
+C_STATUS concurrent_table_remove(void *table, const char *key, int items)
+{
+    conc_tab *ct = table;
+    size_t len = strlen(key);
+    uint64_t hash_val = ct->hash(key, len, ct->seed);
+    stripe *sp = stripe_of(ct, hash_val);
+
+    pthread_rwlock_wrlock(&sp->lock);
+    node **ptr = find(&ct->array[hash_val & (ct->capacity - 1)], key, len, hash_val);
+    if (!ptr)
+    {
+        pthread_rwlock_unlock(&sp->lock);
+        return CE_MISSING;
+    }
+
+    node *rm = *ptr;
+    *ptr = rm->next;
+    if (items)
+    {
+        free(rm->key_value.key);
+        free(rm->key_value.value);
+    }
+
+    pool_release(&sp->nodes, rm);
+    pthread_rwlock_unlock(&sp->lock);
+
+    __atomic_sub_fetch(&ct->head.size, 1, __ATOMIC_RELAXED);
+    return C_OK;
+}
@@ -0,0 +1,351 @@
+/*
+ * Implementation functions for the dense table. A compact hash table in the style of Python's
+ * dict. The key/value pairs are stored in a dense array in the order they were added and a
+ * separate array of small indexes, probed linearly, maps hashes to positions in that array.
+ *
+ * Iterating is a scan of the dense array and the index costs four bytes per slot, so a sparse
+ * table costs little to walk or to keep. Removed entries leave a hole in the dense array which
+ * is closed up the next time the table is rebuilt.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+
+// Default number of index slots if none is supplied by the user, always a power of two
+#define DEF_SIZE 8
+
+// Number of entries that fit in a table with the given number of index slots
+#define USABLE(capacity) ((capacity) / 3 * 2)
+
+// An entry in the dense array. A null key marks a removed entry.
+typedef struct _entry
+{
+    kvp key_value;  // key and value pair
+    uint64_t hash;  // hash of the key, checked before comparing keys
+} entry;
+
+// The dense table
+typedef struct _dense_tab
+{
+    header head;
+    entry *entries;    // entries in the order they were added
+    size_t used;       // entries used, including removed ones
+    uint32_t *index;   // position of an entry plus one for each slot, zero if the slot is empty
+    size_t capacity;   // number of index slots, always a power of two
+    size_t base_cap;   // the initial / minimum size
+} dense_tab;
+
+/*
+ * Rounds a size up to the next power of two
+ */
+static size_t round_pow2(size_t size)
+{
+    size_t rv = DEF_SIZE;
+    while (rv < size)
+    {
+        rv <<= 1;
+    }
+
+    return rv;
+}
+
+/*
+ * Gets the index slot for a key with the given hash. Searches from the key's home slot until
+ * it finds the key or an empty slot.
+ */
+static size_t find_slot(const dense_tab *dt, const char *key, size_t len, uint64_t hash_val)
+{
+    size_t mask = dt->capacity - 1;
+    size_t pos = hash_val & mask;
+    while (dt->index[pos])
+    {
+        const entry *en = &dt->entries[dt->index[pos] - 1];
+        if (en->hash == hash_val && en->key_value.key_len == len && !memcmp(en->key_value.key, key, len))
+        {
+            break;
+        }
+
+        pos = (pos + 1) & mask;
+    }
+
+    return pos;
+}
+
+/*
+ * Rebuilds the table with the given number of index slots. Closes up the holes left by removed
+ * entries, keeping the order of the rest, and indexes them again.
+ */
+static void rebuild(dense_tab *dt, size_t capacity)
+{
+    size_t live = 0;
+    for (size_t i = 0; i < dt->used; i++)
+    {
+        if (dt->entries[i].key_value.key)
+        {
+            dt->entries[live++] = dt->entries[i];
+        }
+    }
+
+    free(dt->index);
+    dt->entries = realloc(dt->entries, USABLE(capacity) * sizeof(entry));
+    dt->index = calloc(capacity, sizeof(uint32_t));
+    dt->capacity = capacity;
+    dt->used = live;
+
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < live; i++)
+    {
+        size_t pos = dt->entries[i].hash & mask;
+        while (dt->index[pos])
+        {
+            pos = (pos + 1) & mask;
+        }
+
+        dt->index[pos] = (uint32_t)(i + 1);
+    }
+}
+
+/*
+ * Gets the number of index slots needed to hold n entries
+ */
+static size_t fit(const dense_tab *dt, size_t n)
+{
+    size_t rv = dt->base_cap;
+    while (USABLE(rv) < n)
+    {
+        rv <<= 1;
+    }
+
+    return rv;
+}
+
+/*
+ * Creates a new iterator. Allocates an index to keep track of the position in the entries.
+ */
+static void *alloc_iter_state(const void *table)
+{
+    UNUSED(table);
+
+    size_t *st = (size_t*)malloc(sizeof(size_t));
+    *st = 0;
+    return st;
+}
+
+/*
+ * Gets the next key/value pair from the iterator, skipping removed entries
+ */
+static int get_next_iter(const void *table, void *iter_state, void **next)
+{
+    const dense_tab *dt = table;
+    size_t *cur = iter_state;
+
+    while (*cur < dt->used)
+    {
+        entry *en = &dt->entries[(*cur)++];
+        if (en->key_value.key)
+        {
+            *next = &en->key_value;
+            return 1;
+        }
+    }
+
+    *next = 0;
+    return 0;
+}
+
+/*
+ * Shallow copies a dense table. The arrays are copied as they are, no need to re-hash.
+ */
+static void *copy_dense_table(const void *table)
+{
+    const dense_tab *dt = table;
+    dense_tab *rv = (dense_tab*)malloc(sizeof(dense_tab));
+    memcpy(rv, dt, sizeof(dense_tab));
+
+    rv->entries = malloc(USABLE(dt->capacity) * sizeof(entry));
+    memcpy(rv->entries, dt->entries, dt->used * sizeof(entry));
+    rv->index = malloc(dt->capacity * sizeof(uint32_t));
+    memcpy(rv->index, dt->index, dt->capacity * sizeof(uint32_t));
+    return rv;
+}
+
+/*
+ * Frees a dense table. If items is non-zero the keys and values are freed too.
+ */
+static void free_dense_table(void *table, int items)
+{
+    dense_tab *dt = table;
+    if (items)
+    {
+        for (size_t i = 0; i < dt->used; i++)
+        {
+            if (dt->entries[i].key_value.key)
+            {
+                free(dt->entries[i].key_value.key);
+                free(dt->entries[i].key_value.value);
+            }
+        }
+    }
+
+    free(dt->entries);
+    free(dt->index);
+    free(dt);
+}
+
+/*
+ * Reads count key/value pairs in to the table, sized once up front to hold them
+ */
+static int read_dense_table(void *table, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    dense_tab *dt = table;
+    size_t sz = fit(dt, dt->head.size + serial_presize(count));
+    if (sz > dt->capacity)
+    {
+        rebuild(dt, sz);
+    }
+
+    serial_buf buf = { 0, 0 };
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        kvp kv;
+        ok = serial_read_kvp(fp, codec, &buf, &kv);
+        if (ok)
+        {
+            dense_table_add(dt, kv.key, kv.value);
+        }
+    }
+
+    serial_buf_free(&buf);
+    return ok;
+}
+
+/*
+ * Creates a new dense table. Uses the default size if no value is provided by the user.
+ */
+void *dense_table(size_t init_size)
+{
+    dense_tab *dt = (dense_tab*)malloc(sizeof(dense_tab));
+    dt->base_cap = round_pow2(init_size);
+    dt->capacity = dt->base_cap;
+    dt->entries = malloc(USABLE(dt->capacity) * sizeof(entry));
+    dt->index = calloc(dt->capacity, sizeof(uint32_t));
+    dt->used = 0;
+
+    dt->head.size = 0;
+    dt->head.alloc_iter_state = alloc_iter_state;
+    dt->head.get_next_iter = get_next_iter;
+    dt->head.free_iter = 0;
+    dt->head.copy_collection = copy_dense_table;
+    dt->head.free_collection = free_dense_table;
+    dt->head.write_items = serial_write_kvps;
+    dt->head.read_items = read_dense_table;
+
+    return dt;
+}
+
+/*
+ * Adds a new key/value pair to the end of the table. A key already in the table keeps its
+ * place and has its value replaced. When the dense array is full the table is rebuilt, at
+ * twice the size unless closing up the removed entries makes enough room.
+ */
+void dense_table_add(void *table, char *key, void *value)
+{
+    dense_tab *dt = table;
+    size_t len = strlen(key);
+    uint64_t hash_val = clxns_hash_wy(key, len, 0);
+    size_t pos = find_slot(dt, key, len, hash_val);
+    if (dt->index[pos])
+    {
+        entry *en = &dt->entries[dt->index[pos] - 1];
+        en->key_value.key = key;
+        en->key_value.value = value;
+        return;
+    }
+
+    if (dt->used == USABLE(dt->capacity))
+    {
+        rebuild(dt, fit(dt, 2 * (dt->head.size + 1)));
+        pos = find_slot(dt, key, len, hash_val);
+    }
+
+    entry *en = &dt->entries[dt->used++];
+    en->key_value.key = key;
+    en->key_value.value = value;
+    en->key_value.key_len = len;
+    en->hash = hash_val;
+    dt->index[pos] = (uint32_t)dt->used;
+    dt->head.size++;
+}
+
+/*
+ * Returns the value associated with the given key
+ */
+C_STATUS dense_table_get(const void *table, const char *key, void **value)
+{
+    const dense_tab *dt = table;
+    size_t len = strlen(key);
+    size_t pos = find_slot(dt, key, len, clxns_hash_wy(key, len, 0));
+    if (dt->index[pos])
+    {
+        *value = dt->entries[dt->index[pos] - 1].key_value.value;
+        return C_OK;
+    }
+
+    *value = 0;
+    return CE_MISSING;
+}
+
+/*
+ * Disassociates a value from a key. The entry is left as a hole in the dense array and the
+ * index slots after it are shifted back, so the index holds no tombstones.
+ */
+C_STATUS dense_table_remove(void *table, const char *key, int items)
+{
+    dense_tab *dt = table;
+    size_t len = strlen(key);
+    size_t hole = find_slot(dt, key, len, clxns_hash_wy(key, len, 0));
+    if (!dt->index[hole])
+    {
+        return CE_MISSING;
+    }
+
+    entry *en = &dt->entries[dt->index[hole] - 1];
+    if (items)
+    {
+        free(en->key_value.key);
+        free(en->key_value.value);
+    }
+
+    en->key_value.key = 0;
+    while (dt->used && !dt->entries[dt->used - 1].key_value.key)
+    {
+        dt->used--;
+    }
+
+    // Move back any slot which can be reached from its home slot without passing the hole
+    size_t mask = dt->capacity - 1;
+    for (size_t next = (hole + 1) & mask; dt->index[next]; next = (next + 1) & mask)
+    {
+        size_t home = dt->entries[dt->index[next] - 1].hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            dt->index[hole] = dt->index[next];
+            hole = next;
+        }
+    }
+
+    dt->index[hole] = 0;
+    dt->head.size--;
+
+    if (dt->capacity > dt->base_cap && dt->head.size <= USABLE(dt->capacity) / 8)
+    {
+        rebuild(dt, fit(dt, 2 * dt->head.size));
+    }
+
+    return C_OK;
+}
@@ -0,0 +1,396 @@
+/*
+ * Implementation functions for the frozen table. A read-only map built from a hash table using
+ * a minimal perfect hash, in the style of PTHash. Every key has its own entry, there are no
+ * empty entries and no chains, so a lookup is a single probe.
+ *
+ * Keys are split in to buckets of a few keys each. Each bucket has a pilot value, chosen when
+ * the table is built, which moves all of the bucket's keys to entries nobody else is using.
+ * The entry for a key is found from its hash and the pilot of its bucket.
+ *
+ * Pilots map keys on to a few more positions than there are keys, so the last buckets placed
+ * still find free positions quickly. Each key placed past the last entry is moved to one of the
+ * entries left free, and a small remap table sends lookups of those positions to it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+
+// Average number of keys in a bucket, more keys per bucket saves memory but takes longer to build
+#define BUCKET_KEYS 4
+
+// Number of pilots tried for a bucket before building again with a new seed
+#define MAX_PILOT (1U << 24)
+
+// Number of seeds tried before giving up, only keys with the same hash for every seed need more
+#define MAX_SEEDS 16
+
+// Keys per position the pilots map on to, PTHash's alpha
+#define LOAD_FACTOR 0.99
+
+// An entry in the table
+typedef struct _entry
+{
+    kvp key_value;  // key and value pair
+    uint64_t hash;  // hash of the key, checked before comparing keys
+} entry;
+
+// The frozen table
+typedef struct _frozen_tab
+{
+    header head;
+    entry *entries;    // one entry per key
+    uint32_t *pilots;  // pilot for each bucket
+    size_t buckets;    // number of buckets
+    size_t positions;  // number of positions the pilots map on to, at least the number of keys
+    size_t *remap;     // entry for each position from the number of keys on
+    uint64_t seed;     // seed the keys are hashed with
+} frozen_tab;
+
+/*
+ * Mixes a pilot in to a value to xor with a key hash, the splitmix64 finalizer
+ */
+static uint64_t mix(uint64_t val)
+{
+    val ^= val >> 30;
+    val *= 0xbf58476d1ce4e5b9ULL;
+    val ^= val >> 27;
+    val *= 0x94d049bb133111ebULL;
+    val ^= val >> 31;
+    return val;
+}
+
+/*
+ * Maps a 64 bit value on to 0 to n - 1 with a multiply rather than a division
+ */
+static size_t range(uint64_t val, size_t n)
+{
+    return (size_t)(((unsigned __int128)val * n) >> 64);
+}
+
+/*
+ * Gets the bucket for a hash from its low 32 bits. The entry is found from the high bits, so
+ * the keys in a bucket do not end up in neighbouring entries.
+ */
+static size_t bucket_of(const frozen_tab *ft, uint64_t hash_val)
+{
+    return (size_t)(((hash_val & 0xffffffff) * ft->buckets) >> 32);
+}
+
+/*
+ * Gets the position for a hash with the given pilot. The result is mixed again before taking
+ * its top bits, otherwise keys whose hashes differ only in the low bits would share a position
+ * for every pilot.
+ */
+static size_t position_of(const frozen_tab *ft, uint64_t hash_val, uint32_t pilot)
+{
+    return range(mix(hash_val ^ mix(pilot)), ft->positions);
+}
+
+/*
+ * Gets the entry index for a position, positions past the last entry are remapped
+ */
+static size_t entry_of(const frozen_tab *ft, size_t pos)
+{
+    return pos < ft->head.size ? pos : ft->remap[pos - ft->head.size];
+}
+
+/*
+ * Searches for pilots which give every key its own position. Buckets are placed largest first,
+ * while the table is still empty. Then moves the keys placed past the last entry in to the
+ * entries left free. Returns zero if a bucket cannot be placed, which happens when two keys
+ * have the same hash.
+ */
+static int place(frozen_tab *ft, const kvp *items, const uint64_t *hashes)
+{
+    size_t n = ft->head.size;
+    size_t *sizes = calloc(ft->buckets + 1, sizeof(size_t));
+    size_t *starts = calloc(ft->buckets + 1, sizeof(size_t));
+    size_t *keys = malloc(n * sizeof(size_t));
+    size_t *owner = malloc(ft->positions * sizeof(size_t));
+    unsigned char *taken = calloc(ft->positions, 1);
+    size_t pos[64];
+    int ok = 1;
+
+    // Group the keys by bucket
+    size_t max_size = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t b = bucket_of(ft, hashes[i]);
+        if (++sizes[b] > max_size)
+        {
+            max_size = sizes[b];
+        }
+    }
+
+    for (size_t b = 0; b < ft->buckets; b++)
+    {
+        starts[b + 1] = starts[b] + sizes[b];
+        sizes[b] = 0;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t b = bucket_of(ft, hashes[i]);
+        keys[starts[b] + sizes[b]++] = i;
+    }
+
+    // Place the largest buckets first, while it is easy to find free entries for all their keys
+    for (size_t size = max_size; ok && size > 0; size--)
+    {
+        for (size_t b = 0; ok && b < ft->buckets; b++)
+        {
+            if (sizes[b] != size)
+            {
+                continue;
+            }
+
+            if (size > sizeof(pos) / sizeof(pos[0]))
+            {
+                ok = 0;
+                break;
+            }
+
+            // No pilot separates keys with the same hash
+            const size_t *bkeys = &keys[starts[b]];
+            for (size_t k = 1; ok && k < size; k++)
+            {
+                for (size_t j = 0; ok && j < k; j++)
+                {
+                    ok = hashes[bkeys[j]] != hashes[bkeys[k]];
+                }
+            }
+
+            uint32_t pilot = 0;
+            while (ok)
+            {
+                size_t k = 0;
+                while (k < size)
+                {
+                    pos[k] = position_of(ft, hashes[bkeys[k]], pilot);
+                    size_t j = 0;
+                    while (j < k && pos[j] != pos[k])
+                    {
+                        j++;
+                    }
+
+                    if (taken[pos[k]] || j < k)
+                    {
+                        break;
+                    }
+
+                    k++;
+                }
+
+                if (k == size)
+                {
+                    break;
+                }
+                else if (++pilot == MAX_PILOT)
+                {
+                    ok = 0;
+                    break;
+                }
+            }
+
+            ft->pilots[b] = pilot;
+            for (size_t k = 0; ok && k < size; k++)
+            {
+                taken[pos[k]] = 1;
+                owner[pos[k]] = bkeys[k];
+            }
+        }
+    }
+
+    // There are as many keys past the last entry as there are free entries
+    size_t next_free = 0;
+    for (size_t p = 0; ok && p < ft->positions; p++)
+    {
+        if (p >= n && taken[p])
+        {
+            while (taken[next_free])
+            {
+                next_free++;
+            }
+
+            ft->remap[p - n] = next_free++;
+        }
+
+        if (taken[p])
+        {
+            size_t e = entry_of(ft, p);
+            ft->entries[e].key_value = items[owner[p]];
+            ft->entries[e].hash = hashes[owner[p]];
+        }
+    }
+
+    free(taken);
+    free(owner);
+    free(keys);
+    free(starts);
+    free(sizes);
+    return ok;
+}
+
+/*
+ * Creates a new iterator. Allocates an index to keep track of the position in the entries.
+ */
+static void *alloc_iter_state(const void *table)
+{
+    UNUSED(table);
+
+    size_t *st = (size_t*)malloc(sizeof(size_t));
+    *st = 0;
+    return st;
+}
+
+/*
+ * Gets the next key/value pair from the iterator
+ */
+static int get_next_iter(const void *table, void *iter_state, void **next)
+{
+    const frozen_tab *ft = table;
+    size_t *cur = iter_state;
+
+    if (*cur < ft->head.size)
+    {
+        *next = &ft->entries[(*cur)++].key_value;
+        return 1;
+    }
+
+    *next = 0;
+    return 0;
+}
+
+/*
+ * Shallow copies a frozen table. The arrays are copied as they are.
+ */
+static void *copy_frozen_table(const void *table)
+{
+    const frozen_tab *ft = table;
+    frozen_tab *rv = (frozen_tab*)malloc(sizeof(frozen_tab));
+    memcpy(rv, ft, sizeof(frozen_tab));
+
+    rv->entries = malloc(ft->head.size * sizeof(entry));
+    memcpy(rv->entries, ft->entries, ft->head.size * sizeof(entry));
+    rv->pilots = malloc(ft->buckets * sizeof(uint32_t));
+    memcpy(rv->pilots, ft->pilots, ft->buckets * sizeof(uint32_t));
+    rv->remap = malloc((ft->positions - ft->head.size + 1) * sizeof(size_t));
+    memcpy(rv->remap, ft->remap, (ft->positions - ft->head.size) * sizeof(size_t));
+    return rv;
+}
+
+/*
+ * Frees a frozen table. If items is non-zero the keys and values are freed too.
+ */
+static void free_frozen_table(void *table, int items)
+{
+    frozen_tab *ft = table;
+    if (items)
+    {
+        for (size_t i = 0; i < ft->head.size; i++)
+        {
+            free(ft->entries[i].key_value.key);
+            free(ft->entries[i].key_value.value);
+        }
+    }
+
+    free(ft->entries);
+    free(ft->pilots);
+    free(ft->remap);
+    free(ft);
+}
+
+/*
+ * Creates a frozen table holding the key/value pairs of a hash table, or of any collection
+ * whose iterator returns kvp items. The keys and values are shared with the original. Returns
+ * null if no seed gives the keys distinct hashes, which means the collection has duplicate keys.
+ */
+void *hash_table_freeze(const void *table)
+{
+    size_t n = clxns_count(table);
+    frozen_tab *ft = (frozen_tab*)malloc(sizeof(frozen_tab));
+    ft->head.size = n;
+    ft->buckets = n / BUCKET_KEYS + 1;
+    ft->positions = (size_t)(n / LOAD_FACTOR);
+    ft->positions = ft->positions < n ? n : ft->positions;
+    ft->entries = malloc((n ? n : 1) * sizeof(entry));
+    ft->pilots = malloc(ft->buckets * sizeof(uint32_t));
+    ft->remap = malloc((ft->positions - n + 1) * sizeof(size_t));
+    ft->seed = 0;
+
+    kvp *items = malloc((n ? n : 1) * sizeof(kvp));
+    uint64_t *hashes = malloc((n ? n : 1) * sizeof(uint64_t));
+    size_t i = 0;
+    void *iter = clxns_iter_new(table);
+    while (clxns_iter_move_next(iter))
+    {
+        items[i++] = *(kvp*)clxns_iter_get_next(iter);
+    }
+
+    clxns_iter_free(iter);
+
+    // Keys with the same hash cannot be told apart, so try again with a new seed
+    int ok = 0;
+    while (!ok && ft->seed < MAX_SEEDS)
+    {
+        for (i = 0; i < n; i++)
+        {
+            hashes[i] = clxns_hash_wy(items[i].key, items[i].key_len, ft->seed);
+        }
+
+        ok = place(ft, items, hashes);
+        ft->seed += !ok;
+    }
+
+    free(hashes);
+    free(items);
+    if (!ok)
+    {
+        free_frozen_table(ft, 0);
+        return 0;
+    }
+
+    ft->head.alloc_iter_state = alloc_iter_state;
+    ft->head.get_next_iter = get_next_iter;
+    ft->head.free_iter = 0;
+    ft->head.copy_collection = copy_frozen_table;
+    ft->head.free_collection = free_frozen_table;
+    ft->head.write_items = serial_write_kvps;
+    ft->head.read_items = 0;
+
+    return ft;
+}
+
+/*
+ * Returns the value associated with the given key
+ */
+C_STATUS frozen_table_get(const void *table, const char *key, void **value)
+{
+    return frozen_table_get_bin(table, key, strlen(key), value);
+}
+
+/*
+ * Returns the value associated with the given binary key. Looks at exactly one entry.
+ */
+C_STATUS frozen_table_get_bin(const void *table, const void *key, size_t len, void **value)
+{
+    const frozen_tab *ft = table;
+    if (ft->head.size)
+    {
+        uint64_t hash_val = clxns_hash_wy(key, len, ft->seed);
+        size_t pos = position_of(ft, hash_val, ft->pilots[bucket_of(ft, hash_val)]);
+        const entry *en = &ft->entries[entry_of(ft, pos)];
+        if (en->hash == hash_val && en->key_value.key_len == len && !memcmp(en->key_value.key, key, len))
+        {
+            *value = en->key_value.value;
+            return C_OK;
+        }
+    }
+
+    *value = 0;
+    return CE_MISSING;
+}
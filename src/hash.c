@@ -0,0 +1,187 @@
+/*
+ * Built-in hash functions for the hash tables. All take the key bytes, the key length and a
+ * seed so that tables can be seeded independently.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "collections.h"
+
+// wyhash secret constants
+static const uint64_t WY_SECRET[4] =
+{
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+/*
+ * Reads 8 bytes from a possibly unaligned address
+ */
+static inline uint64_t read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/*
+ * Reads 4 bytes from a possibly unaligned address
+ */
+static inline uint64_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/*
+ * 64 x 64 -> 128 bit multiply, folded back in to 64 bits
+ */
+static inline uint64_t wymix(uint64_t a, uint64_t b)
+{
+    unsigned __int128 r = (unsigned __int128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+/*
+ * Hashes a string. Courtesy of http://www.cse.yorku.ca/~oz/hash.html
+ * Processes one byte at a time. Kept as the default for compatibility.
+ */
+uint64_t clxns_hash_djb2(const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = key;
+    uint64_t hash = 5381 ^ seed;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        // hash  *33 + c
+        hash = ((hash << 5) + hash) + p[i];
+    }
+
+    return hash;
+}
+
+/*
+ * wyhash, https://github.com/wangyi-fudan/wyhash. Reads the key a word at a time and mixes
+ * with 128 bit multiplies. Fast on both short and long keys with good distribution.
+ */
+uint64_t clxns_hash_wy(const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = key;
+    uint64_t a, b;
+
+    seed ^= wymix(seed ^ WY_SECRET[0], WY_SECRET[1]);
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            size_t off = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + off);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - off);
+        }
+        else if (len > 0)
+        {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t i = len;
+        if (i > 48)
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = wymix(read64(p) ^ WY_SECRET[1], read64(p + 8) ^ seed);
+                see1 = wymix(read64(p + 16) ^ WY_SECRET[2], read64(p + 24) ^ see1);
+                see2 = wymix(read64(p + 32) ^ WY_SECRET[3], read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16)
+        {
+            seed = wymix(read64(p) ^ WY_SECRET[1], read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+
+    unsigned __int128 r = (unsigned __int128)(a ^ WY_SECRET[1]) * (b ^ seed);
+    a = (uint64_t)r;
+    b = (uint64_t)(r >> 64);
+    return wymix(a ^ WY_SECRET[0] ^ len, b ^ WY_SECRET[1]);
+}
+
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND                                                      \
+    do                                                                \
+    {                                                                 \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32);     \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;                        \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;                        \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32);     \
+    } while (0)
+
+/*
+ * SipHash-2-4, https://www.aumasson.jp/siphash/. Slower than wyhash but designed to resist
+ * hash flooding. Use with a secret random seed when keys come from untrusted input. The
+ * second half of the 128 bit SipHash key is derived from the seed.
+ */
+uint64_t clxns_hash_sip(const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = key;
+    uint64_t k0 = seed;
+    uint64_t k1 = wymix(seed ^ WY_SECRET[2], WY_SECRET[3]);
+
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const uint8_t *end = p + len - (len % 8);
+    for (; p != end; p += 8)
+    {
+        uint64_t m = read64(p);
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    uint64_t b = (uint64_t)len << 56;
+    switch (len & 7)
+    {
+        case 7: b |= (uint64_t)p[6] << 48; // fall through
+        case 6: b |= (uint64_t)p[5] << 40; // fall through
+        case 5: b |= (uint64_t)p[4] << 32; // fall through
+        case 4: b |= (uint64_t)p[3] << 24; // fall through
+        case 3: b |= (uint64_t)p[2] << 16; // fall through
+        case 2: b |= (uint64_t)p[1] << 8;  // fall through
+        case 1: b |= (uint64_t)p[0];       // fall through
+        default: break;
+    }
+
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
@@ -4,38 +4,139 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
 #include "collections.h"
 #include "common.h"
+#include "serial.h"
+#include "pool.h"
 
 // Default size of a hash table if none is supplied by the user
 #define DEF_SIZE 7
 
-// An item in the hash table
+// Fibonacci hashing multiplier, spreads the hash over the high bits of the product
+#define GOLDEN 0x9E3779B97F4A7C15ULL
+
+// Limits on the work done by each add or remove during an incremental resize
+#define MIGRATE_SLOTS 8
+#define MIGRATE_SCAN 64
+
+// Number of keys hashed ahead of being inserted by a bulk add
+#define BATCH_SIZE 32
+
+// Counts lookups and the nodes they look at when built with CLXNS_PROBE_STATS, otherwise nothing
+#ifdef CLXNS_PROBE_STATS
+#define COUNT_PROBES(ht, lookups_add, probes_add) \
+    (((hash_tab*)(ht))->lookups += (lookups_add), ((hash_tab*)(ht))->probes += (probes_add))
+#else
+#define COUNT_PROBES(ht, lookups_add, probes_add)
+#endif
+
+// An item in the hash table. Nodes are allocated with room for keys of up to the table's
+// inline length to be copied after them.
 typedef struct _node
 {
     kvp key_value;      // key and value pair
-    unsigned long hash; // the hash of the key
+    uint64_t hash;      // the hash of the key
     struct _node *next; // next item in the linked list of nodes
+    char key_copy[];    // copy of a short key, compared instead of following the key pointer
 } node;
 
-// Set of pointers to iterate over the hash table
-typedef struct _iter_ptrs
+// An array of slots, each the head of a linked list of nodes
+typedef struct _slots
 {
-    node **head; // first node in the hash table array
-    node **tail; // last node in the hash table array
-    node *next;  // next item pointer
-} iter_ptr;
+    node **array;       // hash table slots
+    uint64_t *occupied; // a bit per slot, set while the slot holds a chain
+    size_t capacity;    // number of slots in the array
+    size_t filled;      // number of slots filled in the array
+    int shift;          // 64 - log2(capacity) for power of two slots, zero to index by modulo
+} slots;
 
 // The hash table
 typedef struct _hash_tab
 {
     header head;
-    node **array;     // hash table slots
-    size_t capacity;  // number of items in the hash_table
-    size_t base_cap;  // the initial / minimum size
-    size_t num_array; // number of slots filled in the array
+    slots cur;          // slots that new items are added to
+    slots old;          // slots being migrated by an incremental resize, empty otherwise
+    size_t migrated;    // slots in old before this index have been migrated
+    size_t base_cap;    // the initial / minimum size
+    int flags;          // HT_FLAGS set on the table
+    size_t inline_max;  // keys up to this length are copied in to the nodes
+    pool nodes;         // allocator for the table nodes
+    clxns_hash hash;    // hashes the keys
+    uint64_t seed;      // seed passed to the hash function
+    void *filter;       // bloom filter checked before lookups, null if none
+    int filter_hash;    // non-zero if the keys are hashed as the filter hashes them
+    size_t resizes;     // number of resizes started
+    double resize_secs; // time spent resizing, see resize()
+#ifdef CLXNS_PROBE_STATS
+    uint64_t lookups;   // number of key lookups
+    uint64_t probes;    // number of nodes looked at by lookups
+#endif
 } hash_tab;
 
+// State to iterate over the hash table
+typedef struct _iter_ptrs
+{
+    const slots *sl;   // slot array being walked
+    const slots *last; // final slot array to walk
+    size_t index;      // next slot in the array to look at
+    node *next;        // next item pointer
+} iter_ptr;
+
+/*
+ * Finds the first occupied slot from index from up to end, or returns end if there is none.
+ * Skips 64 empty slots at a time using the occupancy bitmap.
+ */
+static size_t next_occupied(const slots *sl, size_t from, size_t end)
+{
+    if (from >= end)
+    {
+        return end;
+    }
+
+    size_t word = from / 64;
+    uint64_t bits = sl->occupied[word] & (~0ULL << (from % 64));
+    while (!bits)
+    {
+        if (++word * 64 >= end)
+        {
+            return end;
+        }
+
+        bits = sl->occupied[word];
+    }
+
+    size_t rv = word * 64 + __builtin_ctzll(bits);
+    return rv < end ? rv : end;
+}
+
+/*
+ * Moves the iterator to the next occupied slot. Walks the slots not yet migrated by an in
+ * flight incremental resize before the current slots.
+ */
+static void next_slot(iter_ptr *iptr)
+{
+    for (;;)
+    {
+        iptr->index = next_occupied(iptr->sl, iptr->index, iptr->sl->capacity);
+        if (iptr->index < iptr->sl->capacity)
+        {
+            iptr->next = iptr->sl->array[iptr->index++];
+            return;
+        }
+
+        if (iptr->sl == iptr->last)
+        {
+            iptr->next = 0;
+            return;
+        }
+
+        iptr->sl = iptr->last;
+        iptr->index = 0;
+    }
+}
+
 /*
  * Creates a new hash table iterator and points it to the first item in the table.
  */
@@ -43,17 +144,19 @@ static void *alloc_iter_state(const void *table)
 {
     const hash_tab *ht = table;
     iter_ptr *rv = (iter_ptr*)malloc(sizeof(iter_ptr));
-    for (size_t i = 0; i < ht->capacity; i++)
+    rv->last = &ht->cur;
+    if (ht->old.array)
     {
-        rv->head = ht->array + i;
-        if (*(rv->head))
-        {
-            break;
-        }
+        rv->sl = &ht->old;
+        rv->index = ht->migrated;
+    }
+    else
+    {
+        rv->sl = &ht->cur;
+        rv->index = 0;
     }
 
-    rv->tail = ht->array + ht->capacity - 1;
-    rv->next = *(rv->head);
+    next_slot(rv);
     return rv;
 }
 
@@ -68,16 +171,9 @@ static int get_next_node(void *iter_state, node **next)
     {
         *next = iptr->next;
         iptr->next = iptr->next->next;
-
-        if (!iptr->next && iptr->head != iptr->tail)
+        if (!iptr->next)
         {
-            // Find the next occupied slot in the array
-            do
-            {
-                iptr->head++;
-            } while (!(*iptr->head) && iptr->head != iptr->tail);
-
-            iptr->next = iptr->head ? *(iptr->head) : 0;
+            next_slot(iptr);
         }
 
         return 1;
@@ -105,153 +201,499 @@ static int get_next_iter(const void *table, void *iter_state, void **next)
     return 0;
 }
 
+/*
+ * Gets the index of the slot for a hash. Power of two slots multiply by the golden ratio and
+ * take the top bits, which mixes the whole hash in to the index without a division.
+ */
+static size_t slot_of(const slots *sl, uint64_t hash_val)
+{
+    if (sl->shift)
+    {
+        return (size_t)((hash_val * GOLDEN) >> sl->shift);
+    }
+
+    return hash_val % sl->capacity;
+}
+
+/*
+ * Sets up a new, empty slot array. With HT_POW2 the capacity is rounded up to a power of two.
+ */
+static void init_slots(slots *sl, size_t capacity, int flags)
+{
+    sl->shift = 0;
+    if (flags & HT_POW2)
+    {
+        sl->shift = 64;
+        size_t pow2 = 1;
+        while (pow2 < capacity || sl->shift > 61)
+        {
+            pow2 <<= 1;
+            sl->shift--;
+        }
+
+        capacity = pow2;
+    }
+
+    sl->array = calloc(capacity, sizeof(node*));
+    sl->occupied = calloc((capacity + 63) / 64, sizeof(uint64_t));
+    sl->capacity = capacity;
+    sl->filled = 0;
+}
+
+/*
+ * Frees a slot array and its occupancy bitmap
+ */
+static void free_slots(slots *sl)
+{
+    free(sl->array);
+    free(sl->occupied);
+}
+
+/*
+ * Counts a slot as filled if it is empty, called before a node is linked in to it
+ */
+static void fill_slot(slots *sl, size_t index)
+{
+    if (!sl->array[index])
+    {
+        sl->filled++;
+        sl->occupied[index / 64] |= 1ULL << (index % 64);
+    }
+}
+
+/*
+ * Counts a slot as empty if it is empty, called after a node is unlinked from it
+ */
+static void empty_slot(slots *sl, size_t index)
+{
+    if (!sl->array[index])
+    {
+        sl->filled--;
+        sl->occupied[index / 64] &= ~(1ULL << (index % 64));
+    }
+}
+
+/*
+ * Returns a monotonic time in seconds, used to time resizes
+ */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Moves a chain of nodes from the old slots in to the current slots
+ */
+static void move_chain(hash_tab *ht, node *nn)
+{
+    while (nn)
+    {
+        node *next = nn->next;
+        size_t index = slot_of(&ht->cur, nn->hash);
+        node **head = &ht->cur.array[index];
+        fill_slot(&ht->cur, index);
+        nn->next = *head;
+        *head = nn;
+        nn = next;
+    }
+}
+
+/*
+ * Migrates up to max_filled occupied slots from the old slots, looking at no more than
+ * max_scan slots in total. Frees the old slots once they have all been migrated.
+ */
+static void migrate(hash_tab *ht, size_t max_filled, size_t max_scan)
+{
+    size_t end = ht->old.capacity - ht->migrated > max_scan ? ht->migrated + max_scan : ht->old.capacity;
+    while (max_filled && (ht->migrated = next_occupied(&ht->old, ht->migrated, end)) < end)
+    {
+        node **head = &ht->old.array[ht->migrated];
+        move_chain(ht, *head);
+        *head = 0;
+        empty_slot(&ht->old, ht->migrated++);
+        max_filled--;
+    }
+
+    if (ht->migrated == ht->old.capacity)
+    {
+        free_slots(&ht->old);
+        memset(&ht->old, 0, sizeof(slots));
+        ht->migrated = 0;
+    }
+}
+
+/*
+ * Completes an in flight incremental resize
+ */
+static void finish_migration(hash_tab *ht)
+{
+    if (ht->old.array)
+    {
+        migrate(ht, SIZE_MAX, SIZE_MAX);
+    }
+}
+
 /*
  * Resize the hash table to the new size. Allows the hash table to expand and shrink as items
  * are added and removed. Stops too many items colliding and being added to sequential searches
  * when the table is growing.
  *
- * A resize operation creates a new array in the hash table and iterates over all nodes to
- * find them a new slot.
+ * A resize operation creates a new array in the hash table and moves all nodes to find them a
+ * new slot. In incremental mode the old array is kept and its slots are migrated a few at a
+ * time by the following adds and removes.
+ *
+ * The whole resize is timed, but in incremental mode that leaves out the later migration steps.
+ * They are only timed when built with CLXNS_PROBE_STATS, to keep the clock off the hot path.
  */
 static void resize(hash_tab *ht, size_t new_size)
 {
-    node **array = calloc(new_size, sizeof(node*));
+    double start = now();
+    finish_migration(ht);
 
-    void *iter = alloc_iter_state(ht);
-    node *nn;
-    while (get_next_node(iter, &nn))
+    ht->old = ht->cur;
+    ht->migrated = 0;
+    init_slots(&ht->cur, new_size, ht->flags);
+    ht->resizes++;
+
+    if (!(ht->flags & HT_INCREMENTAL))
     {
-        int slot = nn->hash % new_size;
-        node **head = &array[slot];
-        nn->next = *head;
-        *head = nn;
+        finish_migration(ht);
     }
 
-    free(iter);
-    free(ht->array);
+    ht->resize_secs += now() - start;
+}
 
-    ht->array = array;
-    ht->capacity = new_size;
+/*
+ * Does a share of the work of an in flight incremental resize, otherwise checks whether the
+ * table needs to grow or shrink. Called by the operations which modify the table.
+ */
+static void maintain(hash_tab *ht, int adding)
+{
+    if (ht->old.array)
+    {
+#ifdef CLXNS_PROBE_STATS
+        double start = now();
+        migrate(ht, MIGRATE_SLOTS, MIGRATE_SCAN);
+        ht->resize_secs += now() - start;
+#else
+        migrate(ht, MIGRATE_SLOTS, MIGRATE_SCAN);
+#endif
+    }
+    else if (adding && ht->cur.filled > ht->cur.capacity / 2)
+    {
+        resize(ht, ht->cur.capacity * 2);
+    }
+    else if (!adding && ht->cur.capacity / 2 >= ht->base_cap && ht->cur.filled <= ht->cur.capacity / 4)
+    {
+        resize(ht, ht->cur.capacity / 4 < ht->base_cap ? ht->base_cap : ht->cur.capacity / 4);
+    }
 }
 
 /*
- * Hashes a string. Courtesy of http://www.cse.yorku.ca/~oz/hash.html
+ * Grows the table if needed so that n items can be held without it needing to grow again
  */
-static unsigned long hash(const char *str)
+static void make_room(hash_tab *ht, size_t n)
 {
-    unsigned long hash = 5381;
-    int c;
+    if (ht->cur.capacity / 2 < n)
+    {
+        resize(ht, 2 * n + 1);
+    }
+}
 
-    while ((c = *str++))
+/*
+ * Searches the linked list pointed to by head for the given key. The cached hash and length are
+ * checked first so that the keys are only compared when they match. Short keys are compared
+ * against the copy in the node. Returns the node with that key.
+ */
+static node **find(const hash_tab *ht, node **head, const void *key, size_t len, uint64_t hash_val)
+{
+    size_t inline_max = ht->inline_max;
+    while (*head)
     {
-        // hash  *33 + c
-        hash = ((hash << 5) + hash) + c;
+        COUNT_PROBES(ht, 0, 1);
+        const kvp *kv = &(*head)->key_value;
+        if ((*head)->hash == hash_val && kv->key_len == len &&
+            !memcmp(len <= inline_max ? (*head)->key_copy : kv->key, key, len))
+        {
+            return head;
+        }
+
+        head = &(*head)->next;
     }
 
-    return hash;
+    return 0;
 }
 
 /*
- * Gets the first item in the linked list at the array slot for the given key
+ * Searches the table for a key. Looks in the old slots too when an incremental resize is in
+ * flight. Sets sl to the slot array holding the key and returns the pointer to its node.
  */
-static node **get_slot_head(const hash_tab *ht, const char *key, unsigned long *hash_val)
+static node **find_key(const hash_tab *ht, const void *key, size_t len, uint64_t hash_val, slots **sl)
 {
-    *hash_val = hash(key);
-    int slot = *hash_val % ht->capacity;
+    COUNT_PROBES(ht, 1, 0);
+    *sl = (slots*)&ht->cur;
+    node **rv = find(ht, &ht->cur.array[slot_of(&ht->cur, hash_val)], key, len, hash_val);
+    if (!rv && ht->old.array)
+    {
+        *sl = (slots*)&ht->old;
+        rv = find(ht, &ht->old.array[slot_of(&ht->old, hash_val)], key, len, hash_val);
+    }
 
-    return &ht->array[slot];
+    return rv;
 }
 
 /*
- * Creates a new node to be stored in the hash table
+ * Creates a new node to be stored in the hash table. Nodes are taken from the table's pool.
  */
-static node *new_node(char *key, void *value, unsigned long hash_val)
+static node *new_node(hash_tab *ht, void *key, size_t len, void *value, uint64_t hash_val)
 {
-    node *rv = (node*)malloc(sizeof(node));
+    node *rv = (node*)pool_alloc(&ht->nodes);
+    if (len <= ht->inline_max)
+    {
+        memcpy(rv->key_copy, key, len);
+    }
+
     rv->hash = hash_val;
     rv->key_value.key = key;
+    rv->key_value.key_len = len;
     rv->key_value.value = value;
     rv->next = 0;
     return rv;
 }
 
 /*
- * Searches the linked list pointed to by head for the given hash value. Returns the node
- * with that hash.
+ * Adds a key to the table's filter, if it has one. The key's hash is passed to the filter if it
+ * is the one the filter would make.
  */
-static node **find(node **head, unsigned long hash_val)
+static void filter_add(hash_tab *ht, const void *key, size_t len, uint64_t hash_val)
 {
-    while (*head)
+    if (ht->filter && ht->filter_hash)
+    {
+        bloom_filter_add_hash(ht->filter, hash_val);
+    }
+    else if (ht->filter)
+    {
+        bloom_filter_add_bin(ht->filter, key, len);
+    }
+}
+
+/*
+ * Finds the node for a key with a known hash, adding a node with a null value if the key is not
+ * in the table. Only checks whether the table needs to resize when a node is added. Sets
+ * inserted to non-zero if the node is new.
+ */
+static node *probe(hash_tab *ht, void *key, size_t len, uint64_t hash_val, int *inserted)
+{
+    slots *sl;
+    node **ptr = find_key(ht, key, len, hash_val, &sl);
+    *inserted = !ptr;
+    if (ptr)
+    {
+        return *ptr;
+    }
+
+    maintain(ht, 1);
+    size_t index = slot_of(&ht->cur, hash_val);
+    node **head = &ht->cur.array[index];
+    fill_slot(&ht->cur, index);
+
+    node *nn = new_node(ht, key, len, 0, hash_val);
+    nn->next = *head;
+    *head = nn;
+    ht->head.size++;
+
+    filter_add(ht, key, len, hash_val);
+    return nn;
+}
+
+/*
+ * Adds a key/value pair with a known hash to the table. Replaces the value if the key is
+ * already in the table.
+ */
+static void insert(hash_tab *ht, void *key, size_t len, void *value, uint64_t hash_val)
+{
+    int inserted;
+    node *nn = probe(ht, key, len, hash_val, &inserted);
+    nn->key_value.key = key;
+    nn->key_value.value = value;
+}
+
+/*
+ * Checks whether the table's filter rules the key out, so it need not be looked up. The key's
+ * hash is passed to the filter if it is the one the filter would make.
+ */
+static int filtered_out(const hash_tab *ht, const void *key, size_t len, uint64_t hash_val)
+{
+    if (!ht->filter)
     {
-        if ((*head)->hash == hash_val)
+        return 0;
+    }
+
+    return ht->filter_hash ? !bloom_filter_test_hash(ht->filter, hash_val)
+                           : !bloom_filter_test_bin(ht->filter, key, len);
+}
+
+/*
+ * Returns the value associated with a key with a known hash
+ */
+static C_STATUS get_hashed(const hash_tab *ht, const void *key, size_t len, uint64_t hash_val, void **value)
+{
+    slots *sl;
+    node **ptr = find_key(ht, key, len, hash_val, &sl);
+    if (ptr)
+    {
+        *value = (*ptr)->key_value.value;
+        return C_OK;
+    }
+
+    *value = 0;
+    return CE_MISSING;
+}
+
+/*
+ * Disassociates a value from a key with a known hash
+ */
+static C_STATUS remove_hashed(hash_tab *ht, const void *key, size_t len, uint64_t hash_val, int items)
+{
+    maintain(ht, 0);
+
+    slots *sl;
+    node **ptr = find_key(ht, key, len, hash_val, &sl);
+    if (ptr)
+    {
+        node *rm = (*ptr);
+        (*ptr) = rm->next;
+        empty_slot(sl, slot_of(sl, hash_val));
+
+        if (items)
         {
-            return head;
+            free(rm->key_value.key);
+            free(rm->key_value.value);
         }
 
-        head = &(*head)->next;
+        pool_release(&ht->nodes, rm);
+        ht->head.size--;
+        return C_OK;
     }
 
-    return 0;
+    return CE_MISSING;
 }
 
 /*
- * Copies a hash table. Performs a shallow copy by creating a new table and adding
- * all of the values from the original in to it.
+ * Copies a hash table. Performs a shallow copy by creating a new table the same size as the
+ * original and linking a copy of each node straight in to its slot. The keys are already known
+ * to be unique and their hashes are cached, so nothing is hashed or compared.
  */
 static void *copy_hash_table(const void *table)
 {
     const hash_tab *orig = table;
-    hash_tab *rv = hash_table(orig->capacity);
+    hash_tab *rv = hash_table_seeded(0, orig->hash, orig->seed);
+    rv->base_cap = orig->base_cap;
+    rv->flags = orig->flags;
+    rv->inline_max = orig->inline_max;
+    rv->filter = orig->filter;
+    pool_init(&rv->nodes, orig->nodes.item_size);
+    free_slots(&rv->cur);
+    init_slots(&rv->cur, orig->cur.capacity, orig->flags);
 
     void *iter = alloc_iter_state(orig);
     node *nn;
     while (get_next_node(iter, &nn))
     {
-        hash_table_add(rv, nn->key_value.key, nn->key_value.value);
+        node *cp = new_node(rv, nn->key_value.key, nn->key_value.key_len, nn->key_value.value, nn->hash);
+        move_chain(rv, cp);
     }
 
     free(iter);
+    rv->head.size = orig->head.size;
     return rv;
 }
 
 /*
  * Frees a hash table. If items is non-zero this method will also attempt to free any memory
- * pointed to by the keys and values.
+ * pointed to by the keys and values. The nodes are released in bulk with the pool.
  */
 static void free_hash_table(void *table, int items)
 {
     hash_tab *ht = table;
-    iter_ptr *iter = alloc_iter_state(table);
-    node *next;
-    while (get_next_node(iter, &next))
+    if (items)
     {
-        if (items)
+        iter_ptr *iter = alloc_iter_state(table);
+        node *next;
+        while (get_next_node(iter, &next))
         {
             free(next->key_value.key);
             free(next->key_value.value);
         }
 
-        free(next);
+        free(iter);
     }
 
-    free(ht->array);
+    pool_destroy(&ht->nodes);
+    free_slots(&ht->old);
+    free_slots(&ht->cur);
     free(ht);
-    free(iter);
+}
+
+/*
+ * Reads count key/value pairs in to the table, sized once up front to hold them
+ */
+static int read_hash_table(void *table, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    hash_tab *ht = table;
+    make_room(ht, ht->head.size + serial_presize(count));
+
+    serial_buf buf = { 0, 0 };
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        kvp kv;
+        ok = serial_read_kvp(fp, codec, &buf, &kv);
+        if (ok)
+        {
+            hash_table_add_bin(ht, kv.key, kv.key_len, kv.value);
+        }
+    }
+
+    serial_buf_free(&buf);
+    return ok;
 }
 
 /*
  * Creates a new hash table. Uses the default size if no value is provided by the user.
  */
 void *hash_table(size_t init_size)
+{
+    return hash_table_seeded(init_size, clxns_hash_djb2, 0);
+}
+
+/*
+ * Creates a new hash table which hashes its keys with the given function and seed
+ */
+void *hash_table_seeded(size_t init_size, clxns_hash hash, uint64_t seed)
 {
     size_t sz = init_size <= DEF_SIZE ? DEF_SIZE : init_size;
 
     hash_tab *ht = (hash_tab*)malloc(sizeof(hash_tab));
-    node **array = calloc(sz, sizeof(node*));
-    ht->array = array;
-    ht->capacity = sz;
+    init_slots(&ht->cur, sz, HT_DEFAULT);
+    memset(&ht->old, 0, sizeof(slots));
+    ht->migrated = 0;
     ht->base_cap = sz;
-    ht->num_array = 0;
+    ht->flags = HT_DEFAULT;
+    ht->inline_max = 0;
+    pool_init(&ht->nodes, sizeof(node));
+    ht->hash = hash;
+    ht->seed = seed;
+    ht->filter = 0;
+    ht->filter_hash = hash == clxns_hash_wy && !seed;
+    ht->resizes = 0;
+    ht->resize_secs = 0;
+#ifdef CLXNS_PROBE_STATS
+    ht->lookups = 0;
+    ht->probes = 0;
+#endif
 
     ht->head.size = 0;
     ht->head.alloc_iter_state = alloc_iter_state;
@@ -259,45 +701,67 @@ void *hash_table(size_t init_size)
     ht->head.free_iter = 0;
     ht->head.copy_collection = copy_hash_table;
     ht->head.free_collection = free_hash_table;
+    ht->head.write_items = serial_write_kvps;
+    ht->head.read_items = read_hash_table;
 
     return ht;
 }
 
 /*
- * Adds a new key/value pair to the hash table
+ * Sets the HT_FLAGS for the table. Turning off incremental resizing completes any resize
+ * which is in flight. Changing HT_POW2 rebuilds the slots with the new indexing.
  */
-void hash_table_add(void *table, char *key, void *value)
+void hash_table_set_flags(void *table, int flags)
 {
     hash_tab *ht = table;
+    int changed = ht->flags ^ flags;
+    ht->flags = flags;
 
-    if (ht->num_array > ht->capacity / 2)
+    if (changed & HT_POW2)
     {
-        resize(ht, ht->capacity  *2);
+        resize(ht, ht->cur.capacity);
     }
 
-    unsigned long hash_val;
-    node **head = get_slot_head(ht, key, &hash_val);
-    if (*head)
+    if (!(flags & HT_INCREMENTAL))
     {
-        // collision
-        node **ptr = find(head, hash_val);
-        if (ptr)
-        {
-            (*ptr)->key_value.key = key;
-            (*ptr)->key_value.value = value;
-            (*ptr)->hash = hash_val;
-            return;
-        }
+        finish_migration(ht);
     }
-    else
+}
+
+/*
+ * Copies keys of up to max_len bytes in to the nodes so that looking them up does not need to
+ * follow the key pointer. The key pointers are still kept and returned by the iterator. Any
+ * items already in the table are moved to new nodes.
+ */
+void hash_table_set_inline(void *table, size_t max_len)
+{
+    hash_tab *ht = table;
+    finish_migration(ht);
+
+    pool old_nodes = ht->nodes;
+    slots old_slots = ht->cur;
+    ht->inline_max = max_len;
+    pool_init(&ht->nodes, sizeof(node) + max_len);
+    init_slots(&ht->cur, old_slots.capacity, ht->flags);
+
+    for (size_t i = 0; (i = next_occupied(&old_slots, i, old_slots.capacity)) < old_slots.capacity; i++)
     {
-        ht->num_array++;
+        for (node *nn = old_slots.array[i]; nn; nn = nn->next)
+        {
+            move_chain(ht, new_node(ht, nn->key_value.key, nn->key_value.key_len, nn->key_value.value, nn->hash));
+        }
     }
 
-    node *nn = new_node(key, value, hash_val);
-    nn->next = *head;
-    *head = nn;
-    ht->head.size++;
+    free_slots(&old_slots);
+    pool_destroy(&old_nodes);
+}
+
+/*
+ * Adds a new key/value pair to the hash table
+ */
+void hash_table_add(void *table, char *key, void *value)
+{
+    hash_table_add_bin(table, key, strlen(key), value);
 }
 
 /*
@@ -305,61 +769,242 @@ void hash_table_add(void *table, char *key, void *value)
  */
 C_STATUS hash_table_get(const void *table, const char *key, void **value)
 {
-    const hash_tab *ht = table;
+    return hash_table_get_bin(table, key, strlen(key), value);
+}
+
+/*
+ * Disassociates a value from a key
+ */
+C_STATUS hash_table_remove(void *table, const char *key, int items)
+{
+    return hash_table_remove_bin(table, key, strlen(key), items);
+}
 
-    unsigned long hash_val;
-    node **head = get_slot_head(ht, key, &hash_val);
-    if (*head)
+/*
+ * Adds a new key/value pair to the hash table. The key is len bytes long and may contain
+ * any data, including zeros.
+ */
+void hash_table_add_bin(void *table, void *key, size_t len, void *value)
+{
+    hash_tab *ht = table;
+    insert(ht, key, len, value, ht->hash(key, len, ht->seed));
+}
+
+/*
+ * Returns a pointer to the value associated with the key, so that it can be read and updated in
+ * place. The key is added with a null value if it is not in the table. The key is hashed and
+ * looked up once. The pointer is valid until the key is removed.
+ */
+void **hash_table_get_or_insert(void *table, char *key, int *inserted)
+{
+    hash_tab *ht = table;
+    size_t len = strlen(key);
+    int added;
+    node *nn = probe(ht, key, len, ht->hash(key, len, ht->seed), &added);
+    if (inserted)
     {
-        node **ptr = find(head, hash_val);
-        if (ptr)
+        *inserted = added;
+    }
+
+    return &nn->key_value.value;
+}
+
+/*
+ * Finds or adds the key and passes its value to the update function to change in place
+ */
+void hash_table_upsert(void *table, char *key, clxns_update update, void *ctx)
+{
+    int inserted;
+    void **value = hash_table_get_or_insert(table, key, &inserted);
+    update(value, inserted, ctx);
+}
+
+/*
+ * Sizes the table so that n items can be held without it needing to grow. The table does not
+ * shrink below this size as items are removed.
+ */
+void hash_table_reserve(void *table, size_t n)
+{
+    hash_tab *ht = table;
+    make_room(ht, n);
+    if (ht->base_cap < 2 * n + 1)
+    {
+        ht->base_cap = 2 * n + 1;
+    }
+}
+
+/*
+ * Adds n key/value pairs to the hash table. The table is sized once up front and the keys are
+ * hashed in batches ahead of being inserted, so the hashing is not interleaved with the cache
+ * misses of walking the slots. If values is null every value is set to null.
+ */
+void hash_table_add_many(void *table, char **keys, void **values, size_t n)
+{
+    hash_tab *ht = table;
+    size_t lens[BATCH_SIZE];
+    uint64_t hashes[BATCH_SIZE];
+
+    make_room(ht, ht->head.size + n);
+    for (size_t i = 0; i < n; i += BATCH_SIZE)
+    {
+        size_t batch = n - i < BATCH_SIZE ? n - i : BATCH_SIZE;
+        for (size_t j = 0; j < batch; j++)
         {
-            *value = (*ptr)->key_value.value;
-            return C_OK;
+            lens[j] = strlen(keys[i + j]);
+            hashes[j] = ht->hash(keys[i + j], lens[j], ht->seed);
+            __builtin_prefetch(&ht->cur.array[slot_of(&ht->cur, hashes[j])]);
+        }
+
+        for (size_t j = 0; j < batch; j++)
+        {
+            insert(ht, keys[i + j], lens[j], values ? values[i + j] : 0, hashes[j]);
         }
     }
+}
 
-    *value = 0;
-    return CE_MISSING;
+
+/*
+ * Returns the value associated with the given binary key
+ */
+C_STATUS hash_table_get_bin(const void *table, const void *key, size_t len, void **value)
+{
+    const hash_tab *ht = table;
+    uint64_t hash_val = ht->hash(key, len, ht->seed);
+    if (filtered_out(ht, key, len, hash_val))
+    {
+        *value = 0;
+        return CE_MISSING;
+    }
+
+    return get_hashed(ht, key, len, hash_val, value);
 }
 
 /*
- * Disassociates a value from a key
+ * Disassociates a value from a binary key
  */
-C_STATUS hash_table_remove(void *table, const char *key, int items)
+C_STATUS hash_table_remove_bin(void *table, const void *key, size_t len, int items)
 {
     hash_tab *ht = table;
+    uint64_t hash_val = ht->hash(key, len, ht->seed);
+    if (filtered_out(ht, key, len, hash_val))
+    {
+        return CE_MISSING;
+    }
 
-    if (ht->num_array > ht->base_cap && ht->num_array <= ht->capacity / 4)
+    return remove_hashed(ht, key, len, hash_val, items);
+}
+
+/*
+ * Hashes a key with the table's hash function and seed, for the _prehashed functions. Tables
+ * with the same hash function and seed give the same hash for a key.
+ */
+uint64_t hash_table_hash(const void *table, const char *key)
+{
+    const hash_tab *ht = table;
+    return ht->hash(key, strlen(key), ht->seed);
+}
+
+/*
+ * Adds a new key/value pair to the hash table using a hash from hash_table_hash
+ */
+void hash_table_add_prehashed(void *table, char *key, uint64_t hash_val, void *value)
+{
+    insert(table, key, strlen(key), value, hash_val);
+}
+
+/*
+ * Returns the value associated with the key using a hash from hash_table_hash
+ */
+C_STATUS hash_table_get_prehashed(const void *table, const char *key, uint64_t hash_val, void **value)
+{
+    size_t len = strlen(key);
+    if (filtered_out(table, key, len, hash_val))
+    {
+        *value = 0;
+        return CE_MISSING;
+    }
+
+    return get_hashed(table, key, len, hash_val, value);
+}
+
+/*
+ * Disassociates a value from a key using a hash from hash_table_hash
+ */
+C_STATUS hash_table_remove_prehashed(void *table, const char *key, uint64_t hash_val, int items)
+{
+    size_t len = strlen(key);
+    if (filtered_out(table, key, len, hash_val))
+    {
+        return CE_MISSING;
+    }
+
+    return remove_hashed(table, key, len, hash_val, items);
+}
+
+/*
+ * Attaches a bloom filter to the table and adds the table's keys to it. The filter may be
+ * shared with other tables, and is shared with copies of the table. Tables hashed with wyhash
+ * and a zero seed pass their hashes to the filter, others hash each key again for it.
+ */
+void hash_table_set_filter(void *table, void *filter)
+{
+    hash_tab *ht = table;
+    ht->filter = filter;
+    if (filter)
     {
-        resize(ht, ht->capacity / 4);
+        void *iter = alloc_iter_state(ht);
+        node *nn;
+        while (get_next_node(iter, &nn))
+        {
+            filter_add(ht, nn->key_value.key, nn->key_value.key_len, nn->hash);
+        }
+
+        free(iter);
     }
+}
 
-    unsigned long hash_val;
-    node **head = get_slot_head(ht, key, &hash_val);
-    if (*head)
+/*
+ * Adds up the chain lengths of an array of slots in to the stats
+ */
+static void count_chains(const slots *sl, ht_stats *stats)
+{
+    stats->chains[0] += sl->capacity - sl->filled;
+    for (size_t i = 0; (i = next_occupied(sl, i, sl->capacity)) < sl->capacity; i++)
     {
-        node **ptr = find(head, hash_val);
-        if (ptr)
+        size_t len = 0;
+        for (node *nn = sl->array[i]; nn; nn = nn->next)
+        {
+            len++;
+        }
+
+        stats->chains[len < HT_STATS_CHAINS ? len : HT_STATS_CHAINS - 1]++;
+        if (len > stats->max_chain)
         {
-            node *rm = (*ptr);
-            if (head == ptr && rm->next == 0)
-            {
-                ht->num_array--;
-            }
-
-            (*ptr) = rm->next;
-            if (items)
-            {
-                free(rm->key_value.key);
-                free(rm->key_value.value);
-            }
-
-            free(rm);
-            ht->head.size--;
-            return C_OK;
+            stats->max_chain = len;
         }
     }
+}
 
-    return CE_MISSING;
+/*
+ * Gets statistics on the shape of the table. Walks every slot to measure the chain lengths.
+ */
+void hash_table_stats(const void *table, ht_stats *stats)
+{
+    const hash_tab *ht = table;
+    memset(stats, 0, sizeof(ht_stats));
+    stats->count = ht->head.size;
+    stats->capacity = ht->cur.capacity + ht->old.capacity;
+    stats->filled = ht->cur.filled + ht->old.filled;
+    stats->load_factor = (double)stats->count / stats->capacity;
+    count_chains(&ht->cur, stats);
+    count_chains(&ht->old, stats);
+
+    stats->resizes = ht->resizes;
+    stats->resize_secs = ht->resize_secs;
+    size_t bitmap = (ht->cur.capacity + 63) / 64 + (ht->old.capacity + 63) / 64;
+    stats->bytes = sizeof(hash_tab) + stats->capacity * sizeof(node*) + bitmap * sizeof(uint64_t) + ht->nodes.bytes;
+#ifdef CLXNS_PROBE_STATS
+    stats->lookups = ht->lookups;
+    stats->probes = ht->probes;
+#endif
 }
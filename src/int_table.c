@@ -0,0 +1,363 @@
+/*
+ * Implementation functions for the int table. A hash table keyed on 64 bit integers. Keys are
+ * stored inline in a flat array of slots using linear probing, so nothing is allocated per key.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+
+// Default size of an int table if none is supplied by the user, always a power of two
+#define DEF_SIZE 8
+
+// The int table. Zero marks an empty slot so a zero key is held outside of the slot array.
+typedef struct _int_tab
+{
+    header head;
+    ikvp *slots;      // the table slots
+    size_t capacity;  // number of slots, always a power of two
+    size_t base_cap;  // the initial / minimum size
+    int has_zero;     // non-zero if the zero key is in the table
+    ikvp zero;        // the zero key and its value
+} int_tab;
+
+/*
+ * Mixes the bits of an integer key, the splitmix64 finalizer. Neighbouring keys end up in
+ * unrelated slots.
+ */
+static uint64_t mix(uint64_t key)
+{
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+/*
+ * Gets the home slot for a key
+ */
+static size_t home_slot(const int_tab *it, uint64_t key)
+{
+    return mix(key) & (it->capacity - 1);
+}
+
+/*
+ * Searches for the slot holding the key, or the empty slot where it would go
+ */
+static size_t find(const int_tab *it, uint64_t key)
+{
+    size_t mask = it->capacity - 1;
+    size_t pos = home_slot(it, key);
+    while (it->slots[pos].key && it->slots[pos].key != key)
+    {
+        pos = (pos + 1) & mask;
+    }
+
+    return pos;
+}
+
+/*
+ * Resizes the table to the new power of two size, re-placing every entry
+ */
+static void resize(int_tab *it, size_t new_size)
+{
+    ikvp *old = it->slots;
+    size_t old_cap = it->capacity;
+    it->slots = calloc(new_size, sizeof(ikvp));
+    it->capacity = new_size;
+
+    for (size_t i = 0; i < old_cap; i++)
+    {
+        if (old[i].key)
+        {
+            it->slots[find(it, old[i].key)] = old[i];
+        }
+    }
+
+    free(old);
+}
+
+/*
+ * Creates a new iterator. Allocates an index to keep track of the position in the slot array.
+ * Index zero is the zero key, slots start from one.
+ */
+static void *alloc_iter_state(const void *table)
+{
+    UNUSED(table);
+
+    size_t *st = (size_t*)malloc(sizeof(size_t));
+    *st = 0;
+    return st;
+}
+
+/*
+ * Gets the next key/value pair from the iterator
+ */
+static int get_next_iter(const void *table, void *iter_state, void **next)
+{
+    const int_tab *it = table;
+    size_t *cur = iter_state;
+
+    if (*cur == 0)
+    {
+        (*cur)++;
+        if (it->has_zero)
+        {
+            *next = (void*)&it->zero;
+            return 1;
+        }
+    }
+
+    while (*cur <= it->capacity)
+    {
+        ikvp *sl = &it->slots[(*cur)++ - 1];
+        if (sl->key)
+        {
+            *next = sl;
+            return 1;
+        }
+    }
+
+    *next = 0;
+    return 0;
+}
+
+/*
+ * Shallow copies an int table. The slot array is copied as is.
+ */
+static void *copy_int_table(const void *table)
+{
+    const int_tab *it = table;
+    int_tab *rv = (int_tab*)malloc(sizeof(int_tab));
+    memcpy(rv, it, sizeof(int_tab));
+
+    rv->slots = malloc(it->capacity * sizeof(ikvp));
+    memcpy(rv->slots, it->slots, it->capacity * sizeof(ikvp));
+    return rv;
+}
+
+/*
+ * Frees an int table. If items is non-zero the values are freed too.
+ */
+static void free_int_table(void *table, int items)
+{
+    int_tab *it = table;
+    if (items)
+    {
+        for (size_t i = 0; i < it->capacity; i++)
+        {
+            if (it->slots[i].key)
+            {
+                free(it->slots[i].value);
+            }
+        }
+
+        if (it->has_zero)
+        {
+            free(it->zero.value);
+        }
+    }
+
+    free(it->slots);
+    free(it);
+}
+
+/*
+ * Writes the integer keys and their values through the codec
+ */
+static int write_int_table(const void *table, FILE *fp, const clxns_codec *codec)
+{
+    int ok = 1;
+    void *iter = clxns_iter_new(table);
+    while (ok && clxns_iter_move_next(iter))
+    {
+        const ikvp *kv = clxns_iter_get_next(iter);
+        ok = serial_write_uint(fp, kv->key) && serial_write_item(fp, kv->value, codec);
+    }
+
+    clxns_iter_free(iter);
+    return ok;
+}
+
+/*
+ * Reads count key/value pairs in to the table, sized once up front to hold them
+ */
+static int read_int_table(void *table, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    int_tab *it = table;
+    size_t needed = it->head.size + serial_presize(count);
+    size_t sz = it->capacity;
+    while (needed > sz - sz / 4)
+    {
+        sz <<= 1;
+    }
+
+    if (sz != it->capacity)
+    {
+        resize(it, sz);
+    }
+
+    serial_buf buf = { 0, 0 };
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        uint64_t key;
+        void *value;
+        ok = serial_read_uint(fp, &key) && serial_read_item(fp, codec, &buf, &value);
+        if (ok)
+        {
+            int_table_add(it, key, value);
+        }
+    }
+
+    serial_buf_free(&buf);
+    return ok;
+}
+
+/*
+ * Creates a new int table. Uses the default size if no value is provided by the user.
+ */
+void *int_table(size_t init_size)
+{
+    size_t sz = DEF_SIZE;
+    while (sz < init_size)
+    {
+        sz <<= 1;
+    }
+
+    int_tab *it = (int_tab*)malloc(sizeof(int_tab));
+    it->slots = calloc(sz, sizeof(ikvp));
+    it->capacity = sz;
+    it->base_cap = sz;
+    it->has_zero = 0;
+    it->zero.key = 0;
+    it->zero.value = 0;
+
+    it->head.size = 0;
+    it->head.alloc_iter_state = alloc_iter_state;
+    it->head.get_next_iter = get_next_iter;
+    it->head.free_iter = 0;
+    it->head.copy_collection = copy_int_table;
+    it->head.free_collection = free_int_table;
+    it->head.write_items = write_int_table;
+    it->head.read_items = read_int_table;
+
+    return it;
+}
+
+/*
+ * Adds a new key/value pair to the int table. Grows the table when it is three quarters full.
+ */
+void int_table_add(void *table, uint64_t key, void *value)
+{
+    int_tab *it = table;
+    if (!key)
+    {
+        it->head.size += !it->has_zero;
+        it->has_zero = 1;
+        it->zero.value = value;
+        return;
+    }
+
+    if (it->head.size + 1 > it->capacity - it->capacity / 4)
+    {
+        resize(it, it->capacity * 2);
+    }
+
+    size_t pos = find(it, key);
+    if (!it->slots[pos].key)
+    {
+        it->slots[pos].key = key;
+        it->head.size++;
+    }
+
+    it->slots[pos].value = value;
+}
+
+/*
+ * Returns the value associated with the given key
+ */
+C_STATUS int_table_get(const void *table, uint64_t key, void **value)
+{
+    const int_tab *it = table;
+    if (!key)
+    {
+        *value = it->zero.value;
+        return it->has_zero ? C_OK : CE_MISSING;
+    }
+
+    size_t pos = find(it, key);
+    if (it->slots[pos].key)
+    {
+        *value = it->slots[pos].value;
+        return C_OK;
+    }
+
+    *value = 0;
+    return CE_MISSING;
+}
+
+/*
+ * Disassociates a value from a key. Entries further along the probe sequence are shifted back
+ * in to the gap when their home slot allows it, so no tombstones are left behind.
+ */
+C_STATUS int_table_remove(void *table, uint64_t key, int items)
+{
+    int_tab *it = table;
+    if (!key)
+    {
+        if (!it->has_zero)
+        {
+            return CE_MISSING;
+        }
+
+        if (items)
+        {
+            free(it->zero.value);
+        }
+
+        it->has_zero = 0;
+        it->zero.value = 0;
+        it->head.size--;
+        return C_OK;
+    }
+
+    size_t gap = find(it, key);
+    if (!it->slots[gap].key)
+    {
+        return CE_MISSING;
+    }
+
+    if (items)
+    {
+        free(it->slots[gap].value);
+    }
+
+    size_t mask = it->capacity - 1;
+    for (size_t pos = (gap + 1) & mask; it->slots[pos].key; pos = (pos + 1) & mask)
+    {
+        // Move the entry back if the gap lies between its home slot and where it is now
+        size_t home = home_slot(it, it->slots[pos].key);
+        if (((pos - home) & mask) >= ((pos - gap) & mask))
+        {
+            it->slots[gap] = it->slots[pos];
+            gap = pos;
+        }
+    }
+
+    it->slots[gap].key = 0;
+    it->slots[gap].value = 0;
+    it->head.size--;
+
+    if (it->capacity > it->base_cap && it->head.size <= it->capacity / 8)
+    {
+        resize(it, it->capacity / 2);
+    }
+
+    return C_OK;
+}
@@ -0,0 +1,458 @@
+/*
+ * Implementation functions for the LRU cache. A chained hash table bounded by a capacity, which
+ * evicts the least recently used entries to make room for new ones. Each node carries its own
+ * recency links, so an entry is one allocation from the node pool and every operation is O(1).
+ *
+ * The nodes form a ring in order of use, with the hand pointing at the next node to evict.
+ * In LRU mode a node moves to just behind the hand each time it is used. In CLOCK mode a get
+ * only sets the node's referenced bit, if it is not set already, and the hand skips over and
+ * clears referenced nodes when it evicts. Reads then leave the ring alone.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+#include "pool.h"
+
+// Default number of slots, always a power of two
+#define DEF_SIZE 16
+
+// An entry in the cache
+typedef struct _node
+{
+    kvp key_value;        // key and value pair
+    uint64_t hash;        // the hash of the key
+    size_t size;          // size counted against the capacity
+    struct _node *next;   // next node in the slot's chain
+    struct _node *newer;  // next node in the ring, used more recently
+    struct _node *older;  // previous node in the ring, used less recently
+    int referenced;       // set by a get in CLOCK mode, cleared as the hand passes
+} node;
+
+// The cache
+typedef struct _lru_tab
+{
+    header head;
+    node **slots;         // hash table slots
+    size_t capacity;      // number of slots, a power of two
+    pool nodes;           // allocator for the nodes
+    node *hand;           // next node to evict, null if the cache is empty
+    size_t max_size;      // capacity of the cache
+    size_t total;         // sum of the sizes of the entries
+    int policy;           // CACHE_POLICY of the cache
+    clxns_evict evict;    // called with each evicted entry, may be null
+    void *ctx;            // passed to evict
+} lru_tab;
+
+// State to iterate over the cache
+typedef struct _iter_state
+{
+    const node *next;     // next node to return, null at the end
+} iter_state;
+
+/*
+ * Gets the slot for a hash
+ */
+static node **slot_of(const lru_tab *lc, uint64_t hash_val)
+{
+    return &lc->slots[hash_val & (lc->capacity - 1)];
+}
+
+/*
+ * Searches the slot's chain for the key. Returns the pointer to its node or null.
+ */
+static node **find(const lru_tab *lc, const char *key, size_t len, uint64_t hash_val)
+{
+    node **head = slot_of(lc, hash_val);
+    while (*head)
+    {
+        const kvp *kv = &(*head)->key_value;
+        if ((*head)->hash == hash_val && kv->key_len == len && !memcmp(kv->key, key, len))
+        {
+            return head;
+        }
+
+        head = &(*head)->next;
+    }
+
+    return 0;
+}
+
+/*
+ * Doubles the number of slots and moves the nodes in to them
+ */
+static void grow(lru_tab *lc)
+{
+    node **old = lc->slots;
+    size_t old_cap = lc->capacity;
+    lc->capacity *= 2;
+    lc->slots = calloc(lc->capacity, sizeof(node*));
+
+    for (size_t i = 0; i < old_cap; i++)
+    {
+        node *nn = old[i];
+        while (nn)
+        {
+            node *next = nn->next;
+            node **head = slot_of(lc, nn->hash);
+            nn->next = *head;
+            *head = nn;
+            nn = next;
+        }
+    }
+
+    free(old);
+}
+
+/*
+ * Links a node in to the ring just behind the hand, so that it is the last to be evicted
+ */
+static void link_ring(lru_tab *lc, node *nn)
+{
+    if (!lc->hand)
+    {
+        nn->newer = nn;
+        nn->older = nn;
+        lc->hand = nn;
+        return;
+    }
+
+    nn->newer = lc->hand;
+    nn->older = lc->hand->older;
+    nn->older->newer = nn;
+    lc->hand->older = nn;
+}
+
+/*
+ * Takes a node out of the ring, moving the hand on if it points at the node
+ */
+static void unlink_ring(lru_tab *lc, node *nn)
+{
+    if (nn->newer == nn)
+    {
+        lc->hand = 0;
+        return;
+    }
+
+    if (lc->hand == nn)
+    {
+        lc->hand = nn->newer;
+    }
+
+    nn->older->newer = nn->newer;
+    nn->newer->older = nn->older;
+}
+
+/*
+ * Marks a node as used. In LRU mode it moves to the most recently used end of the ring, in
+ * CLOCK mode its referenced bit is set.
+ */
+static void touch(lru_tab *lc, node *nn)
+{
+    if (lc->policy == CACHE_CLOCK)
+    {
+        if (!__atomic_load_n(&nn->referenced, __ATOMIC_RELAXED))
+        {
+            __atomic_store_n(&nn->referenced, 1, __ATOMIC_RELAXED);
+        }
+    }
+    else if (lc->hand == nn)
+    {
+        // Behind the hand is the newest position, so moving the hand on is enough
+        lc->hand = nn->newer;
+    }
+    else
+    {
+        unlink_ring(lc, nn);
+        link_ring(lc, nn);
+    }
+}
+
+/*
+ * Unlinks a node from its chain and the ring and returns it to the pool
+ */
+static void remove_node(lru_tab *lc, node **ptr)
+{
+    node *rm = *ptr;
+    *ptr = rm->next;
+    unlink_ring(lc, rm);
+    lc->total -= rm->size;
+    lc->head.size--;
+    pool_release(&lc->nodes, rm);
+}
+
+/*
+ * Evicts entries until the cache is within its capacity. Keeps the given node, which has just
+ * been added, even if it is larger than the capacity on its own.
+ */
+static void evict(lru_tab *lc, const node *keep)
+{
+    while (lc->total > lc->max_size && lc->head.size > 1)
+    {
+        node *victim = lc->hand;
+        if (lc->policy == CACHE_CLOCK)
+        {
+            // Give referenced nodes a second chance
+            while (victim->referenced || victim == keep)
+            {
+                victim->referenced = 0;
+                victim = victim->newer;
+            }
+
+            lc->hand = victim;
+        }
+        else if (victim == keep)
+        {
+            victim = victim->newer;
+        }
+
+        kvp kv = victim->key_value;
+        remove_node(lc, find(lc, kv.key, kv.key_len, victim->hash));
+        if (lc->evict)
+        {
+            lc->evict(kv.key, kv.value, lc->ctx);
+        }
+    }
+}
+
+/*
+ * Creates a new iterator starting at the next node to evict
+ */
+static void *alloc_iter_state(const void *cache)
+{
+    const lru_tab *lc = cache;
+    iter_state *st = (iter_state*)malloc(sizeof(iter_state));
+    st->next = lc->hand;
+    return st;
+}
+
+/*
+ * Gets the next key/value pair from the iterator, from the next to be evicted to the most
+ * recently added
+ */
+static int get_next_iter(const void *cache, void *iter_state_ptr, void **next)
+{
+    const lru_tab *lc = cache;
+    iter_state *st = iter_state_ptr;
+    if (st->next)
+    {
+        *next = (void*)&st->next->key_value;
+        st->next = st->next->newer == lc->hand ? 0 : st->next->newer;
+        return 1;
+    }
+
+    *next = 0;
+    return 0;
+}
+
+/*
+ * Adds a node for a key known not to be in the cache, behind the hand
+ */
+static node *add_node(lru_tab *lc, char *key, size_t len, void *value, uint64_t hash_val, size_t size)
+{
+    if (lc->head.size >= lc->capacity)
+    {
+        grow(lc);
+    }
+
+    node **head = slot_of(lc, hash_val);
+    node *nn = (node*)pool_alloc(&lc->nodes);
+    nn->key_value.key = key;
+    nn->key_value.key_len = len;
+    nn->key_value.value = value;
+    nn->hash = hash_val;
+    nn->size = size;
+    nn->referenced = 0;
+    nn->next = *head;
+    *head = nn;
+    link_ring(lc, nn);
+
+    lc->total += size;
+    lc->head.size++;
+    return nn;
+}
+
+/*
+ * Copies a cache, keeping the order of the entries and the eviction callback. Entries evicted
+ * from the copy are passed to the same callback.
+ */
+static void *copy_lru_cache(const void *cache)
+{
+    const lru_tab *lc = cache;
+    lru_tab *rv = lru_cache(lc->max_size, lc->policy);
+    lru_cache_set_evict(rv, lc->evict, lc->ctx);
+
+    const node *nn = lc->hand;
+    for (size_t i = 0; i < lc->head.size; i++, nn = nn->newer)
+    {
+        const kvp *kv = &nn->key_value;
+        node *cp = add_node(rv, kv->key, kv->key_len, kv->value, nn->hash, nn->size);
+        cp->referenced = nn->referenced;
+    }
+
+    return rv;
+}
+
+/*
+ * Frees a cache. If items is non-zero the keys and values are freed too, without calling the
+ * eviction callback.
+ */
+static void free_lru_cache(void *cache, int items)
+{
+    lru_tab *lc = cache;
+    if (items)
+    {
+        node *nn = lc->hand;
+        for (size_t i = 0; i < lc->head.size; i++, nn = nn->newer)
+        {
+            free(nn->key_value.key);
+            free(nn->key_value.value);
+        }
+    }
+
+    pool_destroy(&lc->nodes);
+    free(lc->slots);
+    free(lc);
+}
+
+/*
+ * Reads count key/value pairs in to the cache, oldest first, each with a size of one
+ */
+static int read_lru_cache(void *cache, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    serial_buf buf = { 0, 0 };
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        kvp kv;
+        ok = serial_read_kvp(fp, codec, &buf, &kv);
+        if (ok)
+        {
+            lru_cache_put(cache, kv.key, kv.value);
+        }
+    }
+
+    serial_buf_free(&buf);
+    return ok;
+}
+
+/*
+ * Creates a new cache which holds entries whose sizes add up to at most capacity. Entries
+ * added with lru_cache_put have a size of one, so the capacity is a number of entries, or
+ * give each entry its size in bytes with lru_cache_put_sized for a capacity in bytes.
+ */
+void *lru_cache(size_t capacity, int policy)
+{
+    lru_tab *lc = (lru_tab*)malloc(sizeof(lru_tab));
+    lc->capacity = DEF_SIZE;
+    lc->slots = calloc(lc->capacity, sizeof(node*));
+    pool_init(&lc->nodes, sizeof(node));
+    lc->hand = 0;
+    lc->max_size = capacity;
+    lc->total = 0;
+    lc->policy = policy;
+    lc->evict = 0;
+    lc->ctx = 0;
+
+    lc->head.size = 0;
+    lc->head.alloc_iter_state = alloc_iter_state;
+    lc->head.get_next_iter = get_next_iter;
+    lc->head.free_iter = 0;
+    lc->head.copy_collection = copy_lru_cache;
+    lc->head.free_collection = free_lru_cache;
+    lc->head.write_items = serial_write_kvps;
+    lc->head.read_items = read_lru_cache;
+
+    return lc;
+}
+
+/*
+ * Sets the function called with the key and value of each evicted entry
+ */
+void lru_cache_set_evict(void *cache, clxns_evict evict, void *ctx)
+{
+    lru_tab *lc = cache;
+    lc->evict = evict;
+    lc->ctx = ctx;
+}
+
+/*
+ * Adds a key/value pair with a size of one
+ */
+void lru_cache_put(void *cache, char *key, void *value)
+{
+    lru_cache_put_sized(cache, key, value, 1);
+}
+
+/*
+ * Adds a key/value pair of the given size, evicting entries until the cache is within its
+ * capacity. A key already in the cache has its value and size replaced and counts as used.
+ */
+void lru_cache_put_sized(void *cache, char *key, void *value, size_t size)
+{
+    lru_tab *lc = cache;
+    size_t len = strlen(key);
+    uint64_t hash_val = clxns_hash_wy(key, len, 0);
+    node **ptr = find(lc, key, len, hash_val);
+    node *nn;
+    if (ptr)
+    {
+        nn = *ptr;
+        nn->key_value.key = key;
+        nn->key_value.value = value;
+        lc->total += size - nn->size;
+        nn->size = size;
+        touch(lc, nn);
+    }
+    else
+    {
+        nn = add_node(lc, key, len, value, hash_val, size);
+    }
+
+    evict(lc, nn);
+}
+
+/*
+ * Returns the value associated with the key and marks the entry as used
+ */
+C_STATUS lru_cache_get(void *cache, const char *key, void **value)
+{
+    lru_tab *lc = cache;
+    size_t len = strlen(key);
+    node **ptr = find(lc, key, len, clxns_hash_wy(key, len, 0));
+    if (ptr)
+    {
+        touch(lc, *ptr);
+        *value = (*ptr)->key_value.value;
+        return C_OK;
+    }
+
+    *value = 0;
+    return CE_MISSING;
+}
+
+/*
+ * Removes the key/value pair without calling the eviction callback
+ */
+C_STATUS lru_cache_remove(void *cache, const char *key, int items)
+{
+    lru_tab *lc = cache;
+    size_t len = strlen(key);
+    node **ptr = find(lc, key, len, clxns_hash_wy(key, len, 0));
+    if (!ptr)
+    {
+        return CE_MISSING;
+    }
+
+    if (items)
+    {
+        free((*ptr)->key_value.key);
+        free((*ptr)->key_value.value);
+    }
+
+    remove_node(lc, ptr);
+    return C_OK;
+}
@@ -0,0 +1,347 @@
+/*
+ * Implementation functions for the mapped table. A read-only hash table stored in a file which
+ * is memory mapped and queried in place, so opening it costs no more than the page faults of
+ * the lookups. The file is written from any collection whose iterator returns key/value pairs.
+ *
+ * File layout, in native byte order:
+ *   file_header
+ *   slot[capacity]     linear probing table, a zero offset marks an empty slot
+ *   entry...           key bytes then value bytes, each padded to 8 bytes so values are aligned
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+
+// Identifies a mapped table file and its format version
+#define MAGIC "CLXNMT03"
+
+// Value length recorded for a null value
+#define NULL_VALUE UINT32_MAX
+
+// Start of the file
+typedef struct _file_header
+{
+    char magic[8];     // MAGIC
+    uint64_t count;    // number of entries
+    uint64_t capacity; // number of slots, a power of two
+    uint64_t seed;     // seed the keys were hashed with
+} file_header;
+
+// A slot in the file, points to an entry
+typedef struct _slot
+{
+    uint64_t hash;     // hash of the key
+    uint64_t offset;   // offset of the entry from the start of the file, zero if empty
+} slot;
+
+// An entry in the file, followed by the key and value bytes
+typedef struct _entry
+{
+    uint32_t key_len;   // length of the key
+    uint32_t value_len; // length of the value, NULL_VALUE for a null value
+} entry;
+
+// The mapped table
+typedef struct _mapped_tab
+{
+    header head;
+    const char *data;     // the mapped file
+    size_t length;        // length of the mapping
+    int mapped;           // non-zero if data is mapped, zero if it is a malloc'd copy
+    const slot *slots;    // the slots in the file
+    size_t capacity;      // number of slots, a power of two
+    uint64_t seed;        // seed the keys were hashed with
+} mapped_tab;
+
+// State to iterate over the table
+typedef struct _iter_state
+{
+    size_t index; // next slot to look at
+    kvp kv;       // the pair returned to the caller
+} iter_state;
+
+/*
+ * Rounds up to a multiple of 8 bytes
+ */
+static size_t pad8(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+/*
+ * Gets the space taken by a key in an entry. Keys are always followed by at least one zero
+ * byte, so the iterator can return them as strings, and padded so the value is aligned.
+ */
+static size_t key_space(size_t key_len)
+{
+    return pad8(key_len + 1);
+}
+
+/*
+ * Fills in a key/value pair from the entry at the given offset
+ */
+static void read_entry(const mapped_tab *mt, uint64_t offset, kvp *kv)
+{
+    const entry *en = (const entry*)(mt->data + offset);
+    kv->key = (char*)(en + 1);
+    kv->key_len = en->key_len;
+    kv->value = en->value_len == NULL_VALUE ? 0 : kv->key + key_space(en->key_len);
+}
+
+/*
+ * Creates a new iterator over the slots
+ */
+static void *alloc_iter_state(const void *table)
+{
+    UNUSED(table);
+
+    iter_state *st = (iter_state*)malloc(sizeof(iter_state));
+    st->index = 0;
+    return st;
+}
+
+/*
+ * Gets the next key/value pair from the iterator. The pair is only valid until the next call.
+ */
+static int get_next_iter(const void *table, void *iter_state_ptr, void **next)
+{
+    const mapped_tab *mt = table;
+    iter_state *st = iter_state_ptr;
+
+    while (st->index < mt->capacity)
+    {
+        const slot *sl = &mt->slots[st->index++];
+        if (sl->offset)
+        {
+            read_entry(mt, sl->offset, &st->kv);
+            *next = &st->kv;
+            return 1;
+        }
+    }
+
+    *next = 0;
+    return 0;
+}
+
+/*
+ * Copies a mapped table. The copy reads the file data in to memory, so it no longer depends on
+ * the file.
+ */
+static void *copy_mapped_table(const void *table)
+{
+    const mapped_tab *mt = table;
+    char *data = malloc(mt->length);
+    memcpy(data, mt->data, mt->length);
+
+    mapped_tab *rv = (mapped_tab*)malloc(sizeof(mapped_tab));
+    memcpy(rv, mt, sizeof(mapped_tab));
+    rv->data = data;
+    rv->mapped = 0;
+    rv->slots = (const slot*)(data + sizeof(file_header));
+    return rv;
+}
+
+/*
+ * Frees a mapped table and unmaps the file. The keys and values live in the file, so items is
+ * ignored.
+ */
+static void free_mapped_table(void *table, int items)
+{
+    UNUSED(items);
+
+    mapped_tab *mt = table;
+    if (mt->mapped)
+    {
+        munmap((void*)mt->data, mt->length);
+    }
+    else
+    {
+        free((void*)mt->data);
+    }
+
+    free(mt);
+}
+
+/*
+ * Sets up a table over the file data. Checks that the header is valid and that the slots fit
+ * in the data, the entries themselves are trusted.
+ */
+static mapped_tab *open_data(const char *data, size_t length)
+{
+    const file_header *fh = (const file_header*)data;
+    if (length < sizeof(file_header) || memcmp(fh->magic, MAGIC, sizeof(fh->magic)) ||
+        !fh->capacity || (fh->capacity & (fh->capacity - 1)) ||
+        fh->capacity > (length - sizeof(file_header)) / sizeof(slot))
+    {
+        return 0;
+    }
+
+    mapped_tab *mt = (mapped_tab*)malloc(sizeof(mapped_tab));
+    mt->data = data;
+    mt->length = length;
+    mt->mapped = 1;
+    mt->slots = (const slot*)(data + sizeof(file_header));
+    mt->capacity = fh->capacity;
+    mt->seed = fh->seed;
+
+    mt->head.size = fh->count;
+    mt->head.alloc_iter_state = alloc_iter_state;
+    mt->head.get_next_iter = get_next_iter;
+    mt->head.free_iter = 0;
+    mt->head.copy_collection = copy_mapped_table;
+    mt->head.free_collection = free_mapped_table;
+    mt->head.write_items = serial_write_kvps;
+    mt->head.read_items = 0;
+    return mt;
+}
+
+/*
+ * Writes the key/value pairs of a collection to a mapped table file. The collection's iterator
+ * must return kvp items. If value_size is zero the values are strings, otherwise each value
+ * points to value_size bytes. Null values are kept as null.
+ *
+ * The entries are written as the collection is iterated and the slots, built in memory, are
+ * written in front of them at the end.
+ */
+C_STATUS mapped_table_write(const void *collection, const char *path, size_t value_size)
+{
+    size_t count = clxns_count(collection);
+    size_t capacity = 8;
+    while (capacity < count * 2)
+    {
+        capacity <<= 1;
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        return CE_IO;
+    }
+
+    slot *slots = calloc(capacity, sizeof(slot));
+    uint64_t offset = sizeof(file_header) + capacity * sizeof(slot);
+    int ok = !fseek(fp, (long)offset, SEEK_SET);
+
+    static const char zeros[8] = { 0 };
+    void *iter = clxns_iter_new(collection);
+    while (ok && clxns_iter_move_next(iter))
+    {
+        const kvp *kv = clxns_iter_get_next(iter);
+        size_t value_len = 0;
+        entry en = { (uint32_t)kv->key_len, NULL_VALUE };
+        if (kv->value)
+        {
+            value_len = value_size ? value_size : strlen(kv->value) + 1;
+            en.value_len = (uint32_t)value_len;
+        }
+
+        uint64_t hash_val = clxns_hash_wy(kv->key, kv->key_len, 0);
+        size_t pos = hash_val & (capacity - 1);
+        while (slots[pos].offset)
+        {
+            pos = (pos + 1) & (capacity - 1);
+        }
+
+        slots[pos].hash = hash_val;
+        slots[pos].offset = offset;
+
+        size_t key_pad = key_space(kv->key_len) - kv->key_len;
+        size_t value_pad = pad8(value_len) - value_len;
+        ok = fwrite(&en, sizeof(entry), 1, fp) == 1 &&
+             fwrite(kv->key, 1, kv->key_len, fp) == kv->key_len &&
+             fwrite(zeros, 1, key_pad, fp) == key_pad &&
+             (!value_len || fwrite(kv->value, 1, value_len, fp) == value_len) &&
+             fwrite(zeros, 1, value_pad, fp) == value_pad;
+        offset += sizeof(entry) + key_space(kv->key_len) + pad8(value_len);
+    }
+
+    clxns_iter_free(iter);
+
+    file_header fh = { MAGIC, count, capacity, 0 };
+    ok = ok && !fseek(fp, 0, SEEK_SET) &&
+         fwrite(&fh, sizeof(file_header), 1, fp) == 1 &&
+         fwrite(slots, sizeof(slot), capacity, fp) == capacity;
+
+    free(slots);
+    ok = !fclose(fp) && ok;
+    return ok ? C_OK : CE_IO;
+}
+
+/*
+ * Opens a mapped table file. Returns null if the file cannot be mapped or is not a mapped
+ * table. The table is read-only, copying it reads the whole file in to memory.
+ */
+void *mapped_table(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    struct stat sb;
+    void *data = MAP_FAILED;
+    if (!fstat(fd, &sb) && sb.st_size > 0)
+    {
+        data = mmap(0, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    mapped_tab *mt = open_data(data, (size_t)sb.st_size);
+    if (!mt)
+    {
+        munmap(data, (size_t)sb.st_size);
+    }
+
+    return mt;
+}
+
+/*
+ * Returns the value associated with the given key. The value points in to the file.
+ */
+C_STATUS mapped_table_get(const void *table, const char *key, void **value)
+{
+    return mapped_table_get_bin(table, key, strlen(key), value);
+}
+
+/*
+ * Returns the value associated with the given binary key. The value points in to the file.
+ */
+C_STATUS mapped_table_get_bin(const void *table, const void *key, size_t len, void **value)
+{
+    const mapped_tab *mt = table;
+    uint64_t hash_val = clxns_hash_wy(key, len, mt->seed);
+    size_t mask = mt->capacity - 1;
+
+    for (size_t pos = hash_val & mask; mt->slots[pos].offset; pos = (pos + 1) & mask)
+    {
+        const slot *sl = &mt->slots[pos];
+        if (sl->hash == hash_val)
+        {
+            kvp kv;
+            read_entry(mt, sl->offset, &kv);
+            if (kv.key_len == len && !memcmp(kv.key, key, len))
+            {
+                *value = kv.value;
+                return C_OK;
+            }
+        }
+    }
+
+    *value = 0;
+    return CE_MISSING;
+}
@@ -0,0 +1,386 @@
+/*
+ * Implementation functions for the open addressing hash table. Stores values accessed by key
+ * in a single flat array of slots using Robin Hood hashing. Avoids the per-key allocation and
+ * pointer chasing of the chained hash table.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+
+// Default size of an open table if none is supplied by the user, always a power of two
+#define DEF_SIZE 8
+
+// Fibonacci hashing multiplier, spreads the hash over the high bits of the product
+#define GOLDEN 0x9E3779B97F4A7C15ULL
+
+// A slot in the table. A dist of zero marks the slot as empty.
+typedef struct _slot
+{
+    kvp key_value;  // key and value pair
+    uint64_t hash;  // the key hash, checked before comparing keys and re-used on resize
+    uint32_t dist;  // distance from the home slot plus one
+} slot;
+
+// The open table
+typedef struct _open_tab
+{
+    header head;
+    slot *slots;      // the table slots
+    size_t capacity;  // number of slots, always a power of two
+    size_t base_cap;  // the initial / minimum size
+    int shift;        // 64 - log2(capacity), used to find the home slot
+    clxns_hash hash;  // hashes the keys
+    uint64_t seed;    // seed passed to the hash function
+} open_tab;
+
+/*
+ * Rounds a size up to the next power of two
+ */
+static size_t round_pow2(size_t size)
+{
+    size_t rv = DEF_SIZE;
+    while (rv < size)
+    {
+        rv <<= 1;
+    }
+
+    return rv;
+}
+
+/*
+ * Sets the slot array of the table to a new zeroed array of the given power of two size
+ */
+static void init_slots(open_tab *ot, size_t capacity)
+{
+    ot->slots = calloc(capacity, sizeof(slot));
+    ot->capacity = capacity;
+    ot->shift = 64;
+    while (capacity > 1)
+    {
+        capacity >>= 1;
+        ot->shift--;
+    }
+}
+
+/*
+ * Gets the home slot for a hash. Multiplying by the golden ratio mixes the weak
+ * low bits of the hash into the high bits which are used as the index.
+ */
+static size_t home_slot(const open_tab *ot, uint64_t hash_val)
+{
+    return ot->shift == 64 ? 0 : (size_t)((hash_val * GOLDEN) >> ot->shift);
+}
+
+/*
+ * Places a key/value pair in to the table. Entries which are closer to their home slot than
+ * the one being placed are moved along to make room. Returns the slot holding the key.
+ */
+static slot *place(open_tab *ot, kvp key_value, uint64_t hash_val, int *added)
+{
+    size_t mask = ot->capacity - 1;
+    size_t pos = home_slot(ot, hash_val);
+    slot entry = { key_value, hash_val, 1 };
+    slot *rv = 0;
+
+    *added = 1;
+    for (;;)
+    {
+        slot *sl = &ot->slots[pos];
+        if (!sl->dist)
+        {
+            *sl = entry;
+            return rv ? rv : sl;
+        }
+
+        if (!rv && sl->dist == entry.dist && sl->hash == entry.hash &&
+            sl->key_value.key_len == entry.key_value.key_len &&
+            !memcmp(sl->key_value.key, entry.key_value.key, entry.key_value.key_len))
+        {
+            *added = 0;
+            sl->key_value = entry.key_value;
+            return sl;
+        }
+
+        if (sl->dist < entry.dist)
+        {
+            // Rob the rich slot and carry on placing the displaced entry
+            slot tmp = *sl;
+            *sl = entry;
+            entry = tmp;
+            if (!rv)
+            {
+                rv = sl;
+            }
+        }
+
+        pos = (pos + 1) & mask;
+        entry.dist++;
+    }
+}
+
+/*
+ * Resizes the table to the new power of two size, re-placing every entry by its stored hash
+ */
+static void resize(open_tab *ot, size_t new_size)
+{
+    slot *old = ot->slots;
+    size_t old_cap = ot->capacity;
+    init_slots(ot, new_size);
+
+    int added;
+    for (size_t i = 0; i < old_cap; i++)
+    {
+        if (old[i].dist)
+        {
+            place(ot, old[i].key_value, old[i].hash, &added);
+        }
+    }
+
+    free(old);
+}
+
+/*
+ * Searches for the slot holding the key. Stops as soon as the probe passes a slot whose entry
+ * is closer to home than the key would be. Returns the slot index or -1 if not found.
+ */
+static long find(const open_tab *ot, const char *key)
+{
+    size_t len = strlen(key);
+    uint64_t hash_val = ot->hash(key, len, ot->seed);
+    size_t mask = ot->capacity - 1;
+    size_t pos = home_slot(ot, hash_val);
+
+    for (uint32_t dist = 1; ; dist++)
+    {
+        const slot *sl = &ot->slots[pos];
+        if (sl->dist < dist)
+        {
+            return -1;
+        }
+
+        if (sl->hash == hash_val && sl->key_value.key_len == len && !memcmp(sl->key_value.key, key, len))
+        {
+            return (long)pos;
+        }
+
+        pos = (pos + 1) & mask;
+    }
+}
+
+/*
+ * Creates a new iterator. Allocates an index to keep track of the position in the slot array.
+ */
+static void *alloc_iter_state(const void *table)
+{
+    UNUSED(table);
+
+    size_t *st = (size_t*)malloc(sizeof(size_t));
+    *st = 0;
+    return st;
+}
+
+/*
+ * Gets the next key/value pair from the iterator
+ */
+static int get_next_iter(const void *table, void *iter_state, void **next)
+{
+    const open_tab *ot = table;
+    size_t *cur = iter_state;
+
+    while (*cur < ot->capacity)
+    {
+        slot *sl = &ot->slots[(*cur)++];
+        if (sl->dist)
+        {
+            *next = &sl->key_value;
+            return 1;
+        }
+    }
+
+    *next = 0;
+    return 0;
+}
+
+/*
+ * Shallow copies an open table. The slot array is copied as is, no need to re-hash.
+ */
+static void *copy_open_table(const void *table)
+{
+    const open_tab *ot = table;
+    open_tab *rv = (open_tab*)malloc(sizeof(open_tab));
+    memcpy(rv, ot, sizeof(open_tab));
+
+    rv->slots = malloc(ot->capacity * sizeof(slot));
+    memcpy(rv->slots, ot->slots, ot->capacity * sizeof(slot));
+    return rv;
+}
+
+/*
+ * Frees an open table. If items is non-zero this method will also attempt to free any memory
+ * pointed to by the keys and values.
+ */
+static void free_open_table(void *table, int items)
+{
+    open_tab *ot = table;
+    if (items)
+    {
+        for (size_t i = 0; i < ot->capacity; i++)
+        {
+            if (ot->slots[i].dist)
+            {
+                free(ot->slots[i].key_value.key);
+                free(ot->slots[i].key_value.value);
+            }
+        }
+    }
+
+    free(ot->slots);
+    free(ot);
+}
+
+/*
+ * Reads count key/value pairs in to the table, sized once up front to hold them
+ */
+static int read_open_table(void *table, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    open_tab *ot = table;
+    size_t needed = ot->head.size + serial_presize(count);
+    size_t sz = ot->capacity;
+    while (needed > sz - sz / 8)
+    {
+        sz <<= 1;
+    }
+
+    if (sz != ot->capacity)
+    {
+        resize(ot, sz);
+    }
+
+    serial_buf buf = { 0, 0 };
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        kvp kv;
+        ok = serial_read_kvp(fp, codec, &buf, &kv);
+        if (ok)
+        {
+            open_table_add(ot, kv.key, kv.value);
+        }
+    }
+
+    serial_buf_free(&buf);
+    return ok;
+}
+
+/*
+ * Creates a new open table. Uses the default size if no value is provided by the user.
+ */
+void *open_table(size_t init_size)
+{
+    return open_table_seeded(init_size, clxns_hash_djb2, 0);
+}
+
+/*
+ * Creates a new open table which hashes its keys with the given function and seed
+ */
+void *open_table_seeded(size_t init_size, clxns_hash hash, uint64_t seed)
+{
+    size_t sz = round_pow2(init_size);
+
+    open_tab *ot = (open_tab*)malloc(sizeof(open_tab));
+    init_slots(ot, sz);
+    ot->base_cap = sz;
+    ot->hash = hash;
+    ot->seed = seed;
+
+    ot->head.size = 0;
+    ot->head.alloc_iter_state = alloc_iter_state;
+    ot->head.get_next_iter = get_next_iter;
+    ot->head.free_iter = 0;
+    ot->head.copy_collection = copy_open_table;
+    ot->head.free_collection = free_open_table;
+    ot->head.write_items = serial_write_kvps;
+    ot->head.read_items = read_open_table;
+
+    return ot;
+}
+
+/*
+ * Adds a new key/value pair to the open table. Grows the table when it is seven eighths full.
+ */
+void open_table_add(void *table, char *key, void *value)
+{
+    open_tab *ot = table;
+
+    if (ot->head.size + 1 > ot->capacity - ot->capacity / 8)
+    {
+        resize(ot, ot->capacity * 2);
+    }
+
+    int added;
+    kvp key_value = { key, value, strlen(key) };
+    place(ot, key_value, ot->hash(key, key_value.key_len, ot->seed), &added);
+    ot->head.size += added;
+}
+
+/*
+ * Returns the value associated with the given key
+ */
+C_STATUS open_table_get(const void *table, const char *key, void **value)
+{
+    const open_tab *ot = table;
+    long pos = find(ot, key);
+    if (pos >= 0)
+    {
+        *value = ot->slots[pos].key_value.value;
+        return C_OK;
+    }
+
+    *value = 0;
+    return CE_MISSING;
+}
+
+/*
+ * Disassociates a value from a key. The entries following the removed key are shifted back
+ * one slot until one is found in its home slot, so no tombstones are left behind.
+ */
+C_STATUS open_table_remove(void *table, const char *key, int items)
+{
+    open_tab *ot = table;
+    long pos = find(ot, key);
+    if (pos < 0)
+    {
+        return CE_MISSING;
+    }
+
+    size_t mask = ot->capacity - 1;
+    size_t cur = (size_t)pos;
+    if (items)
+    {
+        free(ot->slots[cur].key_value.key);
+        free(ot->slots[cur].key_value.value);
+    }
+
+    size_t next = (cur + 1) & mask;
+    while (ot->slots[next].dist > 1)
+    {
+        ot->slots[cur] = ot->slots[next];
+        ot->slots[cur].dist--;
+        cur = next;
+        next = (next + 1) & mask;
+    }
+
+    memset(&ot->slots[cur], 0, sizeof(slot));
+    ot->head.size--;
+
+    if (ot->capacity > ot->base_cap && ot->head.size <= ot->capacity / 8)
+    {
+        resize(ot, ot->capacity / 2);
+    }
+
+    return C_OK;
+}
@@ -0,0 +1,93 @@
+/*
+ * Fixed size item allocator. Avoids a malloc / free per item for collections which
+ * allocate many small nodes.
+ */
+
+#include <stdlib.h>
+#include "pool.h"
+
+// Number of items in the first chunk, each new chunk doubles up to the maximum
+#define MIN_CHUNK 64
+#define MAX_CHUNK 65536
+
+// Alignment of items within a chunk
+#define ALIGN sizeof(void*)
+
+/*
+ * Initialise a pool for items of the given size
+ */
+void pool_init(pool *pl, size_t item_size)
+{
+    if (item_size < sizeof(void*))
+    {
+        item_size = sizeof(void*);
+    }
+
+    pl->item_size = (item_size + ALIGN - 1) & ~(ALIGN - 1);
+    pl->chunk_items = MIN_CHUNK;
+    pl->free_list = 0;
+    pl->chunks = 0;
+    pl->next = 0;
+    pl->end = 0;
+    pl->bytes = 0;
+}
+
+/*
+ * Allocate an item from the pool. Released items are reused first, then items are carved
+ * from the current chunk. A new chunk is allocated when the current one is used up.
+ */
+void *pool_alloc(pool *pl)
+{
+    if (pl->free_list)
+    {
+        void *rv = pl->free_list;
+        pl->free_list = *(void**)rv;
+        return rv;
+    }
+
+    if (pl->next == pl->end)
+    {
+        size_t hdr = (sizeof(pool_chunk) + ALIGN - 1) & ~(ALIGN - 1);
+        size_t bytes = hdr + pl->chunk_items * pl->item_size;
+        pool_chunk *chunk = malloc(bytes);
+        pl->bytes += bytes;
+        chunk->next = pl->chunks;
+        pl->chunks = chunk;
+        pl->next = (char*)chunk + hdr;
+        pl->end = pl->next + pl->chunk_items * pl->item_size;
+
+        if (pl->chunk_items < MAX_CHUNK)
+        {
+            pl->chunk_items *= 2;
+        }
+    }
+
+    void *rv = pl->next;
+    pl->next += pl->item_size;
+    return rv;
+}
+
+/*
+ * Return an item to the pool. The item is pushed on to the free list.
+ */
+void pool_release(pool *pl, void *item)
+{
+    *(void**)item = pl->free_list;
+    pl->free_list = item;
+}
+
+/*
+ * Free every chunk held by the pool. Items allocated from the pool are no longer valid.
+ */
+void pool_destroy(pool *pl)
+{
+    pool_chunk *chunk = pl->chunks;
+    while (chunk)
+    {
+        pool_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    pool_init(pl, pl->item_size);
+}
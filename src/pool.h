@@ -0,0 +1,36 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+// A chunk of memory that items are carved from
+typedef struct pool_chunk
+{
+    struct pool_chunk *next; // next chunk in the list of all chunks
+} pool_chunk;
+
+// Fixed size item allocator. Items are carved from large chunks and recycled through a free list.
+typedef struct pool
+{
+    size_t item_size;     // size of each item, rounded up for alignment
+    size_t chunk_items;   // number of items in the next chunk to be allocated
+    void *free_list;      // released items ready for reuse
+    pool_chunk *chunks;   // all chunks allocated by the pool
+    char *next;           // next unused item in the current chunk
+    char *end;            // end of the current chunk
+    size_t bytes;         // total size of the chunks
+} pool;
+
+// Initialise a pool for items of the given size
+void pool_init(pool *pl, size_t item_size);
+
+// Allocate an item from the pool
+void *pool_alloc(pool *pl);
+
+// Return an item to the pool for reuse
+void pool_release(pool *pl, void *item);
+
+// Free every chunk held by the pool in one go
+void pool_destroy(pool *pl);
+
+#endif
@@ -7,6 +7,7 @@
 #include <string.h>
 #include "common.h"
 #include "collections.h"
+#include "serial.h"
 
 // The priority queue structure
 typedef struct p_queue
@@ -114,6 +115,42 @@ static void free_priority_queue(void *pqueue, int items)
     free(pq);
 }
 
+/*
+ * Writes the items in heap order, so that reading them back needs no re-ordering
+ */
+static int write_priority_queue(const void *pqueue, FILE *fp, const clxns_codec *codec)
+{
+    const p_queue *pq = pqueue;
+    for (size_t i = 1; i <= pq->head.size; i++)
+    {
+        void *item;
+        resize_array_get(pq->array, i, &item);
+        if (!serial_write_item(fp, item, codec))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Reads count items in to the heap array in one go, then swims each in to place. Items read
+ * in to an empty queue are already in heap order and do not move.
+ */
+static int read_priority_queue(void *pqueue, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    p_queue *pq = pqueue;
+    header *arr = pq->array;
+    int ok = arr->read_items(pq->array, fp, count, codec);
+    while (pq->head.size + 1 < arr->size)
+    {
+        swim(pq, ++(pq->head.size));
+    }
+
+    return ok;
+}
+
 /*
  * Creates a new priority queue. Values are sorted based on the compare function. The order
  * parameter indicates direction.
@@ -131,6 +168,8 @@ static void *new_pq(size_t init_size, int order, int (*compare)(const void *firs
     rv->head.free_iter = free_iter;
     rv->head.copy_collection = copy_priority_queue;
     rv->head.free_collection = free_priority_queue;
+    rv->head.write_items = write_priority_queue;
+    rv->head.read_items = read_priority_queue;
 
     // 1 based array for the heap
     resize_array_add(rv->array, NULL);
@@ -1,6 +1,7 @@
 /*
  * Implementation of the resizing array. The array expands and contracts
- * as items are added to and removed from it.
+ * as items are added to and removed from it. Arrays made by resize_array_of
+ * hold their elements by value rather than as pointers.
  */
 
 #include <stdlib.h>
@@ -8,17 +9,25 @@
 #include <string.h>
 #include "common.h"
 #include "collections.h"
+#include "serial.h"
+#include "sort.h"
 
 // Default size if none is provided by the user
 #define DEF_SIZE 8
 
+// Default growth policy, doubles when full and halves when a quarter full
+static const ra_policy DEF_POLICY = { 2.0, 0.25, 0.5, 0 };
+
 // The resize array structure
 typedef struct rs_array
 {
     header head;
-    void **buff;     // the data in the array
-    size_t capacity; // the number of items allocated to the array
-    size_t base_cap; // the intial / minimum size
+    void **buff;       // the data in the array
+    size_t capacity;   // the number of items allocated to the array
+    size_t base_cap;   // the intial / minimum size
+    ra_policy policy;  // how the array grows and shrinks
+    size_t elem_size;  // bytes per element, the size of a pointer unless made by resize_array_of
+    int is_value;      // non-zero if made by resize_array_of, the elements are held by value
 } rs_array;
 
 /*
@@ -26,11 +35,65 @@ typedef struct rs_array
  */
 static void resize(rs_array *ra, size_t new_size)
 {
-    void **buffer = realloc(ra->buff, new_size * sizeof(void*));
+    void **buffer = realloc(ra->buff, new_size * ra->elem_size);
     ra->buff = buffer;
     ra->capacity = new_size;
 }
 
+/*
+ * Gets the address of an element in the buffer. No bounds checking performed here.
+ */
+static char *elem_at(const rs_array *ra, size_t index)
+{
+    return (char*)ra->buff + index * ra->elem_size;
+}
+
+/*
+ * Grows the array by the growth factor of its policy until it can hold needed items
+ */
+static void make_room(rs_array *ra, size_t needed)
+{
+    size_t sz = ra->capacity;
+    while (sz < needed)
+    {
+        double next = sz * ra->policy.growth;
+        if (next >= (double)SIZE_MAX)
+        {
+            sz = needed;
+            break;
+        }
+
+        sz = (size_t)next > sz ? (size_t)next : sz + 1;
+    }
+
+    if (sz != ra->capacity)
+    {
+        resize(ra, sz);
+    }
+}
+
+/*
+ * Shrinks the array if it has dropped to the shrink threshold of its policy. The new capacity
+ * leaves the array less full than the growth point and emptier than the threshold, so adding
+ * and removing a few items around either point does not keep reallocating.
+ */
+static void shrink(rs_array *ra)
+{
+    const ra_policy *pol = &ra->policy;
+    if (pol->no_shrink || ra->capacity <= ra->base_cap || ra->head.size > ra->capacity * pol->shrink_at)
+    {
+        return;
+    }
+
+    size_t sz = (size_t)(ra->head.size / pol->shrink_to);
+    sz = sz < ra->head.size ? ra->head.size : sz;
+    sz = sz < ra->base_cap ? ra->base_cap : sz;
+    if (sz < ra->capacity)
+    {
+        resize(ra, sz);
+    }
+}
+
 /*
  * Creates a new iterator and points it to the first item in the array.
  * Allocates an integer to keep track of the position in the array
@@ -56,13 +119,40 @@ static int get_next_iter(const void *array, void *iter_state, void **next)
 }
 
 /*
- * Swap two elements in the array. No bounds checking performed here.
+ * Gets a pointer to the next element from the iterator of a value array
+ */
+static int get_next_value_iter(const void *array, void *iter_state, void **next)
+{
+    int *cur = (int*)iter_state;
+    *next = resize_array_at(array, *cur);
+    (*cur)++;
+    return *next != 0;
+}
+
+/*
+ * Swap two elements in the array, a chunk at a time for elements held by value. No bounds
+ * checking performed here.
  */
 static void swap_elements(rs_array *ra, size_t first, size_t second)
 {
-    void *tmp = ra->buff[first];
-    ra->buff[first] = ra->buff[second];
-    ra->buff[second] = tmp;
+    if (!ra->is_value)
+    {
+        void *tmp = ra->buff[first];
+        ra->buff[first] = ra->buff[second];
+        ra->buff[second] = tmp;
+        return;
+    }
+
+    char tmp[64];
+    char *a = elem_at(ra, first);
+    char *b = elem_at(ra, second);
+    for (size_t done = 0; done < ra->elem_size; done += sizeof(tmp))
+    {
+        size_t n = ra->elem_size - done < sizeof(tmp) ? ra->elem_size - done : sizeof(tmp);
+        memcpy(tmp, a + done, n);
+        memcpy(a + done, b + done, n);
+        memcpy(b + done, tmp, n);
+    }
 }
 
 /*
@@ -74,9 +164,9 @@ static void *copy_resize_array(const void *array)
     rs_array *rv = (rs_array*)malloc(sizeof(rs_array));
     memcpy(rv, ra, sizeof(rs_array));
 
-    void **buffer = malloc(rv->capacity * sizeof(void*));
+    void **buffer = malloc(rv->capacity * rv->elem_size);
     rv->buff = buffer;
-    memcpy(rv->buff, ra->buff, rv->head.size * sizeof(void*));
+    memcpy(rv->buff, ra->buff, rv->head.size * rv->elem_size);
     return rv;
 }
 
@@ -98,6 +188,108 @@ static void free_resize_array(void *array, int items)
     free(ra);
 }
 
+/*
+ * Writes the element size and then the bytes of the elements of a value array. The elements
+ * are copied as they are, so the codec is not used.
+ */
+static int write_value_array(const void *array, FILE *fp, const clxns_codec *codec)
+{
+    UNUSED(codec);
+
+    const rs_array *ra = array;
+    return serial_write_uint(fp, ra->elem_size) &&
+           fwrite(ra->buff, ra->elem_size, ra->head.size, fp) == ra->head.size;
+}
+
+/*
+ * Reads count elements in to the end of a value array, which must have the element size they
+ * were written with. The array is grown a bounded number of elements at a time as they are read.
+ */
+static int read_value_array(void *array, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    UNUSED(codec);
+
+    rs_array *ra = array;
+    uint64_t elem_size;
+    if (!serial_read_uint(fp, &elem_size) || elem_size != ra->elem_size)
+    {
+        return 0;
+    }
+
+    size_t chunk = SERIAL_PRESIZE_MAX * sizeof(void*) / ra->elem_size + 1;
+    size_t left = count;
+    while (left)
+    {
+        size_t n = left < chunk ? left : chunk;
+        make_room(ra, ra->head.size + n);
+        size_t got = fread(elem_at(ra, ra->head.size), ra->elem_size, n, fp);
+        ra->head.size += got;
+        left -= got;
+        if (got != n)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Free a value array. Its elements are held in the buffer, so items is ignored.
+ */
+static void free_value_array(void *array, int items)
+{
+    UNUSED(items);
+    free_resize_array(array, 0);
+}
+
+/*
+ * Writes the items in the array through the codec
+ */
+static int write_resize_array(const void *array, FILE *fp, const clxns_codec *codec)
+{
+    const rs_array *ra = array;
+    for (size_t i = 0; i < ra->head.size; i++)
+    {
+        if (!serial_write_item(fp, ra->buff[i], codec))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Reads count items and adds them to the end of the array. The array is sized once up front,
+ * and grows as usual if there are more items than it was sized for.
+ */
+static int read_resize_array(void *array, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    rs_array *ra = array;
+    size_t needed = ra->head.size + serial_presize(count);
+    if (needed > ra->capacity)
+    {
+        resize(ra, needed);
+    }
+
+    serial_buf buf = { 0, 0 };
+    int ok = 1;
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        if (ra->head.size == ra->capacity)
+        {
+            make_room(ra, ra->head.size + 1);
+        }
+
+        ok = serial_read_item(fp, codec, &buf, &ra->buff[ra->head.size]);
+        ra->head.size += ok;
+    }
+
+    serial_buf_free(&buf);
+    return ok;
+}
+
 /*
  * Creates a new resizable array. Uses the default size if none is
  * specified by the user.
@@ -110,6 +302,9 @@ void *resize_array(size_t init_size)
     rv->buff = buffer;
     rv->capacity = sz;
     rv->base_cap = sz;
+    rv->policy = DEF_POLICY;
+    rv->elem_size = sizeof(void*);
+    rv->is_value = 0;
 
     rv->head.size = 0;
     rv->head.alloc_iter_state = alloc_iter_state;
@@ -117,24 +312,60 @@ void *resize_array(size_t init_size)
     rv->head.free_iter = 0;
     rv->head.copy_collection = copy_resize_array;
     rv->head.free_collection = free_resize_array;
+    rv->head.write_items = write_resize_array;
+    rv->head.read_items = read_resize_array;
+
+    return rv;
+}
+
+/*
+ * Creates a new array holding elements of elem_size bytes by value, so that they sit next to
+ * each other in one buffer rather than each being a separate allocation. Iterators return
+ * pointers in to the buffer. Serialising writes the element bytes as they are, without the
+ * codec, so they may only be read back on a machine with the same layout. Returns null if
+ * elem_size is zero.
+ */
+void *resize_array_of(size_t elem_size, size_t init_size)
+{
+    if (elem_size == 0)
+    {
+        return 0;
+    }
+
+    rs_array *rv = resize_array(0);
+    size_t sz = init_size <= DEF_SIZE ? DEF_SIZE : init_size;
+    rv->elem_size = elem_size;
+    rv->is_value = 1;
+    resize(rv, sz);
+    rv->base_cap = sz;
+
+    rv->head.get_next_iter = get_next_value_iter;
+    rv->head.free_collection = free_value_array;
+    rv->head.write_items = write_value_array;
+    rv->head.read_items = read_value_array;
 
     return rv;
 }
 
 /*
- * Adds an item to the array. Doubles the size of the array when full.
+ * Adds an item to the array. Grows the array by the policy's growth factor when full.
  */
-void resize_array_add(void *array, void *item)
+C_STATUS resize_array_add(void *array, void *item)
 {
     rs_array *ra = array;
+    if (ra->is_value)
+    {
+        return CE_BY_VALUE;
+    }
 
     if (ra->head.size == ra->capacity)
     {
-        resize(ra, ra->capacity * 2);
+        make_room(ra, ra->head.size + 1);
     }
 
     ra->buff[ra->head.size] = item;
     ra->head.size++;
+    return C_OK;
 }
 
 /*
@@ -143,26 +374,23 @@ void resize_array_add(void *array, void *item)
 C_STATUS resize_array_insert(void *array, size_t index, void *item)
 {
     rs_array *ra = array;
-    if (index > ra->head.size)
+    if (ra->is_value)
+    {
+        return CE_BY_VALUE;
+    }
+    else if (index > ra->head.size)
     {
         return CE_BOUNDS;
     }
     else if (index == ra->head.size)
     {
-        resize_array_add(ra, item);
-        return C_OK;
+        return resize_array_add(ra, item);
     }
 
-    if (ra->head.size == ra->capacity)
-    {
-        resize(ra, ra->capacity * 2);
-    }
+    make_room(ra, ra->head.size + 1);
 
     // Shuffle items up to make space at index
-    for (size_t i = ra->head.size; i > index; i--) {
-        swap_elements(ra, i - 1, i);
-    }
-
+    memmove(&ra->buff[index + 1], &ra->buff[index], (ra->head.size - index) * sizeof(void*));
     ra->buff[index] = item;
     ra->head.size++;
     return C_OK;
@@ -171,10 +399,16 @@ C_STATUS resize_array_insert(void *array, size_t index, void *item)
 /*
  * Replaces an item in the array
  */
-void resize_array_replace(void *array, size_t index, void *item)
+C_STATUS resize_array_replace(void *array, size_t index, void *item)
 {
     rs_array *ra = array;
+    if (ra->is_value)
+    {
+        return CE_BY_VALUE;
+    }
+
     ra->buff[index] = item;
+    return C_OK;
 }
 
 /*
@@ -184,7 +418,11 @@ void resize_array_replace(void *array, size_t index, void *item)
 C_STATUS resize_array_get(const void *array, size_t index, void **item)
 {
     const rs_array *ra = array;
-    if (index >= ra->head.size)
+    if (ra->is_value)
+    {
+        return CE_BY_VALUE;
+    }
+    else if (index >= ra->head.size)
     {
         return CE_BOUNDS;
     }
@@ -194,7 +432,7 @@ C_STATUS resize_array_get(const void *array, size_t index, void **item)
 }
 
 /*
- * Swaps two items in the array at the index values specified.
+ * Swaps two items in the array at the index values specified. Works on value arrays too.
  */
 C_STATUS resize_array_exchange(void *array, size_t first, size_t second)
 {
@@ -210,7 +448,8 @@ C_STATUS resize_array_exchange(void *array, size_t first, size_t second)
 
 /*
  * Removes an item from the array and shuffles everything after that
- * point back one space. Reallcoates the array if it's one quarter full.
+ * point back one space. Reallocates the array if it has dropped to the
+ * policy's shrink threshold.
  */
 C_STATUS resize_array_remove(void *array, size_t index, void **item)
 {
@@ -226,17 +465,324 @@ C_STATUS resize_array_remove(void *array, size_t index, void **item)
         *item = rv;
     }
 
-    for (size_t i = index; i < ra->head.size - 1; i++)
+    memmove(&ra->buff[index], &ra->buff[index + 1], (ra->head.size - index - 1) * sizeof(void*));
+    ra->head.size--;
+    shrink(ra);
+    return C_OK;
+}
+
+/*
+ * Inserts n items in to the array at the position specified. The items after that point are
+ * moved up once to make room for them all.
+ */
+C_STATUS resize_array_insert_range(void *array, size_t index, void **items, size_t n)
+{
+    rs_array *ra = array;
+    if (ra->is_value)
+    {
+        return CE_BY_VALUE;
+    }
+    else if (index > ra->head.size)
     {
-        ra->buff[i] = ra->buff[i + 1];
+        return CE_BOUNDS;
     }
 
-    ra->head.size--;
+    make_room(ra, ra->head.size + n);
+    memmove(&ra->buff[index + n], &ra->buff[index], (ra->head.size - index) * sizeof(void*));
+    memcpy(&ra->buff[index], items, n * sizeof(void*));
+    ra->head.size += n;
+    return C_OK;
+}
 
-    if (ra->head.size > ra->base_cap && ra->head.size <= ra->capacity / 4)
+/*
+ * Removes n items from the array starting at index, and moves the items after them back once.
+ * If items is non-zero the removed items are copied in to it.
+ */
+C_STATUS resize_array_remove_range(void *array, size_t index, size_t n, void **items)
+{
+    rs_array *ra = array;
+    if (ra->is_value)
+    {
+        return CE_BY_VALUE;
+    }
+    else if (index > ra->head.size || n > ra->head.size - index)
     {
-        resize(ra, ra->capacity / 4);
+        return CE_BOUNDS;
     }
 
+    if (items)
+    {
+        memcpy(items, &ra->buff[index], n * sizeof(void*));
+    }
+
+    memmove(&ra->buff[index], &ra->buff[index + n], (ra->head.size - index - n) * sizeof(void*));
+    ra->head.size -= n;
+    shrink(ra);
     return C_OK;
 }
+
+/*
+ * Adds n items from a C array to the end of the array
+ */
+C_STATUS resize_array_extend(void *array, void **items, size_t n)
+{
+    rs_array *ra = array;
+    return resize_array_insert_range(ra, ra->head.size, items, n);
+}
+
+/*
+ * Adds the items returned by another collection's iterator to the end of the array. The array
+ * is grown once up front.
+ */
+C_STATUS resize_array_extend_collection(void *array, const void *collection)
+{
+    rs_array *ra = array;
+    if (ra->is_value)
+    {
+        return CE_BY_VALUE;
+    }
+
+    size_t count = clxns_count(collection);
+    make_room(ra, ra->head.size + count);
+
+    if (collection == array)
+    {
+        memcpy(&ra->buff[ra->head.size], ra->buff, count * sizeof(void*));
+        ra->head.size += count;
+        return C_OK;
+    }
+
+    void *iter = clxns_iter_new(collection);
+    while (clxns_iter_move_next(iter))
+    {
+        ra->buff[ra->head.size++] = clxns_iter_get_next(iter);
+    }
+
+    clxns_iter_free(iter);
+    return C_OK;
+}
+
+/*
+ * Sets how the array grows and shrinks. Takes effect from the next change to the array. Returns
+ * CE_BOUNDS and keeps the current policy if the growth factor is not above 1, or the shrink
+ * points are not 0 <= shrink_at < shrink_to <= 1.
+ */
+C_STATUS resize_array_set_policy(void *array, const ra_policy *policy)
+{
+    if (!(policy->growth > 1) || !(policy->shrink_at >= 0) ||
+        !(policy->shrink_to > policy->shrink_at) || !(policy->shrink_to <= 1))
+    {
+        return CE_BOUNDS;
+    }
+
+    rs_array *ra = array;
+    ra->policy = *policy;
+    return C_OK;
+}
+
+/*
+ * Grows the array so that it can hold n items without reallocating
+ */
+void resize_array_reserve(void *array, size_t n)
+{
+    rs_array *ra = array;
+    if (n > ra->capacity)
+    {
+        resize(ra, n);
+    }
+}
+
+/*
+ * Shrinks the array's capacity to the number of items in it, releasing the slack
+ */
+void resize_array_shrink_to_fit(void *array)
+{
+    rs_array *ra = array;
+    size_t sz = ra->head.size ? ra->head.size : 1;
+    if (sz != ra->capacity)
+    {
+        resize(ra, sz);
+    }
+}
+
+/*
+ * Returns the number of items the array can hold before it next reallocates
+ */
+size_t resize_array_capacity(const void *array)
+{
+    const rs_array *ra = array;
+    return ra->capacity;
+}
+
+/*
+ * Gets a pointer to the element at index in a value array, or null if index is out of bounds.
+ * The pointer is valid until the array is next resized.
+ */
+void *resize_array_at(const void *array, size_t index)
+{
+    const rs_array *ra = array;
+    return index < ra->head.size ? elem_at(ra, index) : 0;
+}
+
+/*
+ * Copies an element to the end of a value array
+ */
+void resize_array_add_value(void *array, const void *elem)
+{
+    rs_array *ra = array;
+    make_room(ra, ra->head.size + 1);
+    memcpy(elem_at(ra, ra->head.size), elem, ra->elem_size);
+    ra->head.size++;
+}
+
+/*
+ * Copies an element in to a value array at the position specified, moving the later elements up
+ */
+C_STATUS resize_array_insert_value(void *array, size_t index, const void *elem)
+{
+    rs_array *ra = array;
+    if (index > ra->head.size)
+    {
+        return CE_BOUNDS;
+    }
+
+    make_room(ra, ra->head.size + 1);
+    memmove(elem_at(ra, index + 1), elem_at(ra, index), (ra->head.size - index) * ra->elem_size);
+    memcpy(elem_at(ra, index), elem, ra->elem_size);
+    ra->head.size++;
+    return C_OK;
+}
+
+/*
+ * Copies the element at index in a value array out to elem
+ */
+C_STATUS resize_array_get_value(const void *array, size_t index, void *elem)
+{
+    const rs_array *ra = array;
+    if (index >= ra->head.size)
+    {
+        return CE_BOUNDS;
+    }
+
+    memcpy(elem, elem_at(ra, index), ra->elem_size);
+    return C_OK;
+}
+
+/*
+ * Overwrites the element at index in a value array with a copy of elem
+ */
+C_STATUS resize_array_put_value(void *array, size_t index, const void *elem)
+{
+    rs_array *ra = array;
+    if (index >= ra->head.size)
+    {
+        return CE_BOUNDS;
+    }
+
+    memcpy(elem_at(ra, index), elem, ra->elem_size);
+    return C_OK;
+}
+
+/*
+ * Removes the element at index from a value array, copying it to elem if non-zero, and moves
+ * the later elements back one space
+ */
+C_STATUS resize_array_remove_value(void *array, size_t index, void *elem)
+{
+    rs_array *ra = array;
+    if (index >= ra->head.size)
+    {
+        return CE_BOUNDS;
+    }
+    else if (elem)
+    {
+        memcpy(elem, elem_at(ra, index), ra->elem_size);
+    }
+
+    memmove(elem_at(ra, index), elem_at(ra, index + 1), (ra->head.size - index - 1) * ra->elem_size);
+    ra->head.size--;
+    shrink(ra);
+    return C_OK;
+}
+
+/*
+ * Sorts items with the compare function, or by key if one is given
+ */
+static void sort_pointers(void **items, size_t n, sort_cmp compare, sort_key key, int nthreads)
+{
+    if (key)
+    {
+        sort_items_radix(items, n, key, nthreads);
+    }
+    else
+    {
+        sort_items_parallel(items, n, compare, nthreads);
+    }
+}
+
+/*
+ * Sorts the array with up to nthreads threads. A value array is sorted as pointers to its
+ * elements, which are then copied in to a new buffer in order, so each element moves once.
+ */
+static void sort_array(rs_array *ra, sort_cmp compare, sort_key key, int nthreads)
+{
+    size_t n = ra->head.size;
+    if (!ra->is_value)
+    {
+        sort_pointers(ra->buff, n, compare, key, nthreads);
+        return;
+    }
+
+    void **ptrs = malloc(n * sizeof(void*));
+    char *sorted = malloc(ra->capacity * ra->elem_size);
+    for (size_t i = 0; i < n; i++)
+    {
+        ptrs[i] = elem_at(ra, i);
+    }
+
+    sort_pointers(ptrs, n, compare, key, nthreads);
+    for (size_t i = 0; i < n; i++)
+    {
+        memcpy(sorted + i * ra->elem_size, ptrs[i], ra->elem_size);
+    }
+
+    free(ra->buff);
+    ra->buff = (void**)sorted;
+    free(ptrs);
+}
+
+/*
+ * Sorts the array in place with an introsort. The compare function is passed items, or
+ * pointers to the elements of a value array.
+ */
+void resize_array_sort(void *array, int (*compare)(const void *first, const void *second))
+{
+    sort_array(array, compare, 0, 1);
+}
+
+/*
+ * Sorts the array with up to nthreads threads, each introsorting a chunk before the chunks are
+ * merged. Small arrays are sorted on the calling thread.
+ */
+void resize_array_sort_parallel(void *array, int (*compare)(const void *first, const void *second), int nthreads)
+{
+    sort_array(array, compare, 0, nthreads);
+}
+
+/*
+ * Sorts the array by the integer key_fn returns for each item, or for a pointer to each element
+ * of a value array. Each key is got once and the keys are radix sorted. Items with equal keys
+ * keep their order.
+ */
+void resize_array_radix_sort(void *array, uint64_t (*key_fn)(const void *item))
+{
+    sort_array(array, 0, key_fn, 1);
+}
+
+/*
+ * Radix sorts the array, getting and counting the keys on up to nthreads threads
+ */
+void resize_array_radix_sort_parallel(void *array, uint64_t (*key_fn)(const void *item), int nthreads)
+{
+    sort_array(array, 0, key_fn, nthreads);
+}
@@ -0,0 +1,173 @@
+/*
+ * Helpers to write and read collections as a stream of length prefixed items. Integers are
+ * written seven bits at a time, low bits first, with the top bit set on all but the last byte.
+ * Callers hold the stream lock, so single bytes are written and read without locking.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "serial.h"
+
+/*
+ * Writes an unsigned integer as a variable length quantity
+ */
+int serial_write_uint(FILE *fp, uint64_t val)
+{
+    while (val > 0x7f)
+    {
+        if (putc_unlocked((int)(val & 0x7f) | 0x80, fp) == EOF)
+        {
+            return 0;
+        }
+
+        val >>= 7;
+    }
+
+    return putc_unlocked((int)val, fp) != EOF;
+}
+
+/*
+ * Reads an unsigned integer written by serial_write_uint
+ */
+int serial_read_uint(FILE *fp, uint64_t *val)
+{
+    *val = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = getc_unlocked(fp);
+        if (c == EOF)
+        {
+            return 0;
+        }
+
+        *val |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Writes an item as its length plus one followed by the bytes from the codec. A null item is
+ * written as a zero length.
+ */
+int serial_write_item(FILE *fp, const void *item, const clxns_codec *codec)
+{
+    if (!item)
+    {
+        return serial_write_uint(fp, 0);
+    }
+
+    size_t len;
+    const void *data = codec->encode(item, &len, codec->ctx);
+    return serial_write_uint(fp, len + 1) && fwrite(data, 1, len, fp) == len;
+}
+
+/*
+ * Reads the bytes of an item in to the buffer and passes them to the codec to make the item.
+ * Fails on lengths over SERIAL_MAX_LEN or if the buffer cannot be grown.
+ */
+int serial_read_item(FILE *fp, const clxns_codec *codec, serial_buf *buf, void **item)
+{
+    uint64_t len;
+    *item = 0;
+    if (!serial_read_uint(fp, &len) || len > SERIAL_MAX_LEN + 1)
+    {
+        return 0;
+    }
+    else if (!len--)
+    {
+        return 1;
+    }
+
+    if (len > buf->cap)
+    {
+        free(buf->data);
+        buf->data = malloc(len);
+        buf->cap = buf->data ? len : 0;
+        if (!buf->data)
+        {
+            return 0;
+        }
+    }
+
+    if (fread(buf->data, 1, len, fp) != len)
+    {
+        return 0;
+    }
+
+    *item = codec->decode(buf->data, len, codec->ctx);
+    return 1;
+}
+
+/*
+ * Writes the key bytes, prefixed with their length, then the value through the codec
+ */
+int serial_write_kvp(FILE *fp, const kvp *kv, const clxns_codec *codec)
+{
+    return serial_write_uint(fp, kv->key_len) &&
+           fwrite(kv->key, 1, kv->key_len, fp) == kv->key_len &&
+           serial_write_item(fp, kv->value, codec);
+}
+
+/*
+ * Reads a key/value pair. The key is allocated with room for a terminator, so string keys can
+ * be used as strings. Nothing is left allocated on failure.
+ */
+int serial_read_kvp(FILE *fp, const clxns_codec *codec, serial_buf *buf, kvp *kv)
+{
+    uint64_t len;
+    if (!serial_read_uint(fp, &len) || len > SERIAL_MAX_LEN || !(kv->key = malloc(len + 1)))
+    {
+        return 0;
+    }
+
+    kv->key_len = len;
+    if (fread(kv->key, 1, len, fp) != len || !serial_read_item(fp, codec, buf, &kv->value))
+    {
+        free(kv->key);
+        return 0;
+    }
+
+    kv->key[len] = 0;
+    return 1;
+}
+
+/*
+ * Caps the number of items a collection is sized for before reading them. Collections grow as
+ * usual if there turn out to be more.
+ */
+size_t serial_presize(size_t count)
+{
+    return count < SERIAL_PRESIZE_MAX ? count : SERIAL_PRESIZE_MAX;
+}
+
+/*
+ * Writes every key/value pair from a collection's iterator
+ */
+int serial_write_kvps(const void *collection, FILE *fp, const clxns_codec *codec)
+{
+    int ok = 1;
+    void *iter = clxns_iter_new(collection);
+    while (ok && clxns_iter_move_next(iter))
+    {
+        ok = serial_write_kvp(fp, clxns_iter_get_next(iter), codec);
+    }
+
+    clxns_iter_free(iter);
+    return ok;
+}
+
+/*
+ * Frees the scratch buffer
+ */
+void serial_buf_free(serial_buf *buf)
+{
+    free(buf->data);
+    buf->data = 0;
+    buf->cap = 0;
+}
@@ -0,0 +1,42 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdio.h>
+#include "collections.h"
+
+// Longest key or item payload which will be read, longer lengths are taken to be corrupt
+#define SERIAL_MAX_LEN ((uint64_t)1 << 30)
+
+// Most items a collection is sized for up front when reading. The count comes from the stream,
+// so a corrupt one must not make the collection allocate more than this before items are read.
+#define SERIAL_PRESIZE_MAX ((size_t)1 << 20)
+
+// Scratch space for reading item payloads, reused from one item to the next
+typedef struct serial_buf
+{
+    char *data;  // the buffer
+    size_t cap;  // size of the buffer
+} serial_buf;
+
+// Write / read an unsigned integer as a variable length quantity. Return zero on failure.
+int serial_write_uint(FILE *fp, uint64_t val);
+int serial_read_uint(FILE *fp, uint64_t *val);
+
+// Write / read an item through a codec, prefixed with its length. Null items are kept as null.
+int serial_write_item(FILE *fp, const void *item, const clxns_codec *codec);
+int serial_read_item(FILE *fp, const clxns_codec *codec, serial_buf *buf, void **item);
+
+// Write / read a key/value pair. Read keys are allocated with a terminator after the bytes.
+int serial_write_kvp(FILE *fp, const kvp *kv, const clxns_codec *codec);
+int serial_read_kvp(FILE *fp, const clxns_codec *codec, serial_buf *buf, kvp *kv);
+
+// Get the number of items to size a collection for before reading count items
+size_t serial_presize(size_t count);
+
+// Write the items of any collection whose iterator returns kvp items
+int serial_write_kvps(const void *collection, FILE *fp, const clxns_codec *codec);
+
+// Free the scratch buffer
+void serial_buf_free(serial_buf *buf);
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Implementation functions for the snapshot table. A hash table for data which is read far more
+ * often than it is changed. Readers look keys up in an immutable published version without
+ * taking any locks. A single writer changes a private copy and then publishes it as the next
+ * version. Old versions are freed once every reader which could be using them has moved on,
+ * tracked with epochs.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "collections.h"
+#include "common.h"
+#include "serial.h"
+
+// A published version of the table
+typedef struct _version
+{
+    void *table;           // the hash table, never changed once published
+    uint64_t retired;      // last epoch in which readers may have seen this version
+    struct _version *next; // next version waiting to be freed
+} version;
+
+struct _snap_tab;
+
+// A registered reader. The epoch is non-zero while the reader is inside a lookup.
+typedef struct _reader
+{
+    uint64_t epoch;          // epoch the current lookup started in, zero when idle
+    struct _snap_tab *table; // the table being read
+    struct _reader *next;    // next registered reader
+} reader;
+
+// The snapshot table
+typedef struct _snap_tab
+{
+    header head;
+    version *current;      // the version readers look up keys in
+    uint64_t epoch;        // global epoch, moved on by each publish
+    void *pending;         // the writer's copy of the table, null when there are no changes
+    version *retired;      // replaced versions which have not been freed yet
+    pthread_mutex_t lock;  // guards the list of readers
+    reader *readers;       // registered readers
+} snap_tab;
+
+/*
+ * Gets the table the writer sees, the pending changes or the current version
+ */
+static void *latest(const snap_tab *st)
+{
+    return st->pending ? st->pending : st->current->table;
+}
+
+/*
+ * Gets the pending table for the writer to change, copying the current version if there are
+ * no changes yet
+ */
+static void *writable(snap_tab *st)
+{
+    if (!st->pending)
+    {
+        st->pending = clxns_copy(st->current->table);
+    }
+
+    return st->pending;
+}
+
+/*
+ * Wraps a hash table in a version
+ */
+static version *new_version(void *table)
+{
+    version *rv = (version*)malloc(sizeof(version));
+    rv->table = table;
+    rv->retired = 0;
+    rv->next = 0;
+    return rv;
+}
+
+/*
+ * Frees the retired versions which no reader can still be using. A reader which started its
+ * lookup in an epoch after a version was retired can only have seen a later version.
+ */
+static void reclaim(snap_tab *st)
+{
+    uint64_t oldest = UINT64_MAX;
+    pthread_mutex_lock(&st->lock);
+    for (reader *rd = st->readers; rd; rd = rd->next)
+    {
+        uint64_t epoch = __atomic_load_n(&rd->epoch, __ATOMIC_SEQ_CST);
+        if (epoch && epoch < oldest)
+        {
+            oldest = epoch;
+        }
+    }
+
+    pthread_mutex_unlock(&st->lock);
+
+    version **ptr = &st->retired;
+    while (*ptr)
+    {
+        version *v = *ptr;
+        if (v->retired < oldest)
+        {
+            *ptr = v->next;
+            clxns_free(v->table, 0);
+            free(v);
+        }
+        else
+        {
+            ptr = &v->next;
+        }
+    }
+}
+
+/*
+ * Creates a new iterator over the latest version of the table. Only the writer may iterate.
+ */
+static void *alloc_iter_state(const void *table)
+{
+    return clxns_iter_new(latest(table));
+}
+
+/*
+ * Gets the next key/value pair from the iterator
+ */
+static int get_next_iter(const void *table, void *iter_state, void **next)
+{
+    UNUSED(table);
+
+    int rv = clxns_iter_move_next(iter_state);
+    *next = clxns_iter_get_next(iter_state);
+    return rv;
+}
+
+/*
+ * Frees the iterator
+ */
+static void free_iter(void *iter_state)
+{
+    clxns_iter_free(iter_state);
+}
+
+/*
+ * Copies a snapshot table. The new table starts with a copy of the latest version and has no
+ * readers. Only the writer may copy.
+ */
+static void *copy_snapshot_table(const void *table)
+{
+    snap_tab *rv = snapshot_table(0);
+    version *v = rv->current;
+    clxns_free(v->table, 0);
+    v->table = clxns_copy(latest(table));
+    rv->head.size = clxns_count(v->table);
+    return rv;
+}
+
+/*
+ * Frees a snapshot table, every version of it and all of its readers. No reader may be in a
+ * lookup. If items is non-zero the keys and values in the latest version are freed too.
+ */
+static void free_snapshot_table(void *table, int items)
+{
+    snap_tab *st = table;
+    version *v = st->current;
+    if (st->pending)
+    {
+        clxns_free(st->pending, items);
+        items = 0;
+    }
+
+    clxns_free(v->table, items);
+    free(v);
+
+    while (st->retired)
+    {
+        v = st->retired;
+        st->retired = v->next;
+        clxns_free(v->table, 0);
+        free(v);
+    }
+
+    while (st->readers)
+    {
+        reader *rd = st->readers;
+        st->readers = rd->next;
+        free(rd);
+    }
+
+    pthread_mutex_destroy(&st->lock);
+    free(st);
+}
+
+/*
+ * Writes the published version of the table, the one counted by the header
+ */
+static int write_snapshot_table(const void *table, FILE *fp, const clxns_codec *codec)
+{
+    const snap_tab *st = table;
+    return serial_write_kvps(st->current->table, fp, codec);
+}
+
+/*
+ * Reads count key/value pairs in to the writer's copy of the table. Readers see them once
+ * they are published.
+ */
+static int read_snapshot_table(void *table, FILE *fp, size_t count, const clxns_codec *codec)
+{
+    header *hdr = writable(table);
+    return hdr->read_items(hdr, fp, count, codec);
+}
+
+/*
+ * Creates a new snapshot table. Specify the initial size of the hash table.
+ */
+void *snapshot_table(size_t init_size)
+{
+    snap_tab *st = (snap_tab*)malloc(sizeof(snap_tab));
+    st->current = new_version(hash_table_seeded(init_size, clxns_hash_wy, 0));
+    st->epoch = 1;
+    st->pending = 0;
+    st->retired = 0;
+    st->readers = 0;
+    pthread_mutex_init(&st->lock, 0);
+
+    st->head.size = 0;
+    st->head.alloc_iter_state = alloc_iter_state;
+    st->head.get_next_iter = get_next_iter;
+    st->head.free_iter = free_iter;
+    st->head.copy_collection = copy_snapshot_table;
+    st->head.free_collection = free_snapshot_table;
+    st->head.write_items = write_snapshot_table;
+    st->head.read_items = read_snapshot_table;
+
+    return st;
+}
+
+/*
+ * Associates a key with a value. Readers do not see the change until it is published.
+ */
+void snapshot_table_add(void *table, char *key, void *value)
+{
+    snap_tab *st = table;
+    hash_table_add(writable(st), key, value);
+}
+
+/*
+ * Disassociates a value from a key. Readers do not see the change until it is published. The
+ * key and value are not freed since readers may still be using them.
+ */
+C_STATUS snapshot_table_remove(void *table, const char *key)
+{
+    snap_tab *st = table;
+    return hash_table_remove(writable(st), key, 0);
+}
+
+/*
+ * Publishes the changes made by the writer as the next version. Readers starting a lookup
+ * afterwards see the new version. Versions no reader can be using any more are freed.
+ */
+void snapshot_table_publish(void *table)
+{
+    snap_tab *st = table;
+    if (st->pending)
+    {
+        version *v = new_version(st->pending);
+        st->pending = 0;
+        st->head.size = clxns_count(v->table);
+
+        version *old = __atomic_exchange_n(&st->current, v, __ATOMIC_SEQ_CST);
+        old->retired = __atomic_fetch_add(&st->epoch, 1, __ATOMIC_SEQ_CST);
+        old->next = st->retired;
+        st->retired = old;
+    }
+
+    reclaim(st);
+}
+
+/*
+ * Registers a new reader of the table. Each thread reading the table needs its own reader.
+ */
+void *snapshot_reader(void *table)
+{
+    snap_tab *st = table;
+    reader *rd = (reader*)malloc(sizeof(reader));
+    rd->epoch = 0;
+    rd->table = st;
+
+    pthread_mutex_lock(&st->lock);
+    rd->next = st->readers;
+    st->readers = rd;
+    pthread_mutex_unlock(&st->lock);
+    return rd;
+}
+
+/*
+ * Unregisters and frees a reader
+ */
+void snapshot_reader_free(void *rdr)
+{
+    reader *rd = rdr;
+    snap_tab *st = rd->table;
+
+    pthread_mutex_lock(&st->lock);
+    reader **ptr = &st->readers;
+    while (*ptr != rd)
+    {
+        ptr = &(*ptr)->next;
+    }
+
+    *ptr = rd->next;
+    pthread_mutex_unlock(&st->lock);
+    free(rd);
+}
+
+/*
+ * Returns the value associated with the key in the current version. Wait free, the reader
+ * marks the epoch it started in, looks the key up and marks itself idle again.
+ */
+C_STATUS snapshot_table_get(void *rdr, const char *key, void **value)
+{
+    reader *rd = rdr;
+    snap_tab *st = rd->table;
+
+    __atomic_store_n(&rd->epoch, __atomic_load_n(&st->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    version *v = __atomic_load_n(&st->current, __ATOMIC_SEQ_CST);
+    C_STATUS rv = hash_table_get(v->table, key, value);
+    __atomic_store_n(&rd->epoch, 0, __ATOMIC_RELEASE);
+    return rv;
+}
@@ -0,0 +1,494 @@
+/*
+ * Sorting of pointer arrays. The serial sort is an introsort: a quicksort which falls back to a
+ * heapsort if it goes too deep, so it is never worse than O(n log n), and insertion sorts short
+ * ranges. The parallel sort introsorts one chunk per thread and then merges the chunks in
+ * rounds, splitting each merge between threads so that every round keeps all threads busy.
+ *
+ * The radix sort gets each item's key once and sorts the keys with their items eleven bits at a
+ * time, least significant first. The counts of every digit are taken in one read of the keys,
+ * shared between threads, and digits which are the same in every key are skipped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sort.h"
+
+// Ranges of this many items or fewer are insertion sorted
+#define INSERTION_MAX 16
+
+// Fewest items given to each thread by the parallel sorts
+#define PARALLEL_MIN 4096
+
+// Most threads used by the parallel merge sort, which keeps its chunk bounds on the stack
+#define PARALLEL_MAX 256
+
+// Number of bits sorted by each pass of the radix sort, and the number of passes. Eleven bits
+// sorts 32 bit keys in three passes, with the counts for a pass still fitting in L1.
+#define RADIX_BITS 11
+#define RADIX_PASSES ((64 + RADIX_BITS - 1) / RADIX_BITS)
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+// A chunk sorted by one thread
+typedef struct _chunk_task
+{
+    void **items;  // the chunk
+    size_t n;      // number of items in the chunk
+    sort_cmp cmp;  // item comparison
+} chunk_task;
+
+// Part of a merge of two sorted runs done by one thread
+typedef struct _merge_task
+{
+    void **a;      // items taken from the first run
+    size_t la;     // number of items from the first run
+    void **b;      // items taken from the second run
+    size_t lb;     // number of items from the second run
+    void **out;    // where the merged items go
+    sort_cmp cmp;  // item comparison
+} merge_task;
+
+// An item and its key, as moved by the radix sort
+typedef struct _keyed
+{
+    uint64_t key;  // the key got from the item
+    void *item;    // the item
+} keyed;
+
+// Part of the radix sort's keys, got and counted by one thread
+typedef struct _count_task
+{
+    void **items;                             // items to get the keys of
+    keyed *out;                               // where the keys and items go
+    size_t n;                                 // number of items
+    sort_key key;                             // gets the key of an item
+    size_t counts[RADIX_PASSES][RADIX_SIZE];  // count of each value of each digit of the keys
+} count_task;
+
+/*
+ * Swaps two items
+ */
+static void swap(void **items, size_t first, size_t second)
+{
+    void *tmp = items[first];
+    items[first] = items[second];
+    items[second] = tmp;
+}
+
+/*
+ * Sorts a short range by inserting each item in to the sorted items before it
+ */
+static void insertion_sort(void **items, size_t n, sort_cmp cmp)
+{
+    for (size_t i = 1; i < n; i++)
+    {
+        void *item = items[i];
+        size_t j = i;
+        while (j > 0 && cmp(item, items[j - 1]) < 0)
+        {
+            items[j] = items[j - 1];
+            j--;
+        }
+
+        items[j] = item;
+    }
+}
+
+/*
+ * Moves the item at root down the heap of n items until it is larger than its children
+ */
+static void sift_down(void **items, size_t root, size_t n, sort_cmp cmp)
+{
+    size_t child;
+    while ((child = root * 2 + 1) < n)
+    {
+        if (child + 1 < n && cmp(items[child], items[child + 1]) < 0)
+        {
+            child++;
+        }
+
+        if (cmp(items[root], items[child]) >= 0)
+        {
+            return;
+        }
+
+        swap(items, root, child);
+        root = child;
+    }
+}
+
+/*
+ * Sorts a range with a heapsort, used when the quicksort has picked too many bad pivots
+ */
+static void heap_sort(void **items, size_t n, sort_cmp cmp)
+{
+    for (size_t i = n / 2; i > 0; i--)
+    {
+        sift_down(items, i - 1, n, cmp);
+    }
+
+    for (size_t i = n - 1; i > 0; i--)
+    {
+        swap(items, 0, i);
+        sift_down(items, 0, i, cmp);
+    }
+}
+
+/*
+ * Partitions a range around the median of its first, middle and last items. Returns the size
+ * of the lower part; every item in it is no greater than every item after it. Both parts hold
+ * at least one item.
+ */
+static size_t partition(void **items, size_t n, sort_cmp cmp)
+{
+    size_t mid = n / 2;
+    if (cmp(items[mid], items[0]) < 0)
+    {
+        swap(items, 0, mid);
+    }
+
+    if (cmp(items[n - 1], items[mid]) < 0)
+    {
+        swap(items, mid, n - 1);
+        if (cmp(items[mid], items[0]) < 0)
+        {
+            swap(items, 0, mid);
+        }
+    }
+
+    // The first and last items stop the scans from running off the ends
+    void *pivot = items[mid];
+    size_t i = 0;
+    size_t j = n - 1;
+    while (1)
+    {
+        while (cmp(items[i], pivot) < 0)
+        {
+            i++;
+        }
+
+        while (cmp(pivot, items[j]) < 0)
+        {
+            j--;
+        }
+
+        if (i >= j)
+        {
+            return j + 1;
+        }
+
+        swap(items, i++, j--);
+    }
+}
+
+/*
+ * Quicksorts a range, recursing in to the smaller part so the stack stays shallow. Switches to
+ * a heapsort once depth runs out.
+ */
+static void intro_sort(void **items, size_t n, sort_cmp cmp, int depth)
+{
+    while (n > INSERTION_MAX)
+    {
+        if (depth-- == 0)
+        {
+            heap_sort(items, n, cmp);
+            return;
+        }
+
+        size_t lower = partition(items, n, cmp);
+        if (lower < n - lower)
+        {
+            intro_sort(items, lower, cmp, depth);
+            items += lower;
+            n -= lower;
+        }
+        else
+        {
+            intro_sort(items + lower, n - lower, cmp, depth);
+            n = lower;
+        }
+    }
+
+    insertion_sort(items, n, cmp);
+}
+
+/*
+ * Sorts n items in place
+ */
+void sort_items(void **items, size_t n, sort_cmp cmp)
+{
+    int depth = 0;
+    for (size_t i = n; i > 1; i >>= 1)
+    {
+        depth += 2;
+    }
+
+    intro_sort(items, n, cmp, depth);
+}
+
+/*
+ * Thread function which sorts a chunk
+ */
+static void *sort_chunk(void *arg)
+{
+    chunk_task *task = arg;
+    sort_items(task->items, task->n, task->cmp);
+    return 0;
+}
+
+/*
+ * Thread function which merges part of two runs. Ties are taken from the first run so the
+ * merge is stable.
+ */
+static void *merge_part(void *arg)
+{
+    merge_task *task = arg;
+    void **a = task->a;
+    void **b = task->b;
+    void **a_end = a + task->la;
+    void **b_end = b + task->lb;
+    void **out = task->out;
+
+    while (a < a_end && b < b_end)
+    {
+        *out++ = task->cmp(*b, *a) < 0 ? *b++ : *a++;
+    }
+
+    memcpy(out, a, (a_end - a) * sizeof(void*));
+    memcpy(out + (a_end - a), b, (b_end - b) * sizeof(void*));
+    return 0;
+}
+
+/*
+ * Runs count tasks of size bytes each, one per thread. The last task runs on the calling
+ * thread, as does any task whose thread cannot be started.
+ */
+static void run_tasks(void *(*fn)(void*), void *tasks, size_t size, int count)
+{
+    pthread_t threads[count];
+    int started[count];
+    for (int i = 0; i < count - 1; i++)
+    {
+        started[i] = !pthread_create(&threads[i], 0, fn, (char*)tasks + i * size);
+    }
+
+    fn((char*)tasks + (count - 1) * size);
+    for (int i = 0; i < count - 1; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], 0);
+        }
+        else
+        {
+            fn((char*)tasks + i * size);
+        }
+    }
+}
+
+/*
+ * Finds how many items of the first run are in the first diag items of the merge of two runs
+ */
+static size_t co_rank(void **a, size_t la, void **b, size_t lb, size_t diag, sort_cmp cmp)
+{
+    size_t lo = diag > lb ? diag - lb : 0;
+    size_t hi = diag < la ? diag : la;
+    while (lo < hi)
+    {
+        size_t i = lo + (hi - lo) / 2;
+        if (cmp(b[diag - i - 1], a[i]) < 0)
+        {
+            hi = i;
+        }
+        else
+        {
+            lo = i + 1;
+        }
+    }
+
+    return lo;
+}
+
+/*
+ * Sorts n items using up to nthreads threads. Falls back to the serial sort when there are too
+ * few items to be worth sharing out, or fewer than two threads. Uses at most PARALLEL_MAX.
+ */
+void sort_items_parallel(void **items, size_t n, sort_cmp cmp, int nthreads)
+{
+    size_t most = n / PARALLEL_MIN;
+    nthreads = nthreads < 1 ? 1 : nthreads > PARALLEL_MAX ? PARALLEL_MAX : nthreads;
+    int k = (size_t)nthreads < most ? nthreads : (int)most;
+    void **tmp = k > 1 ? malloc(n * sizeof(void*)) : 0;
+    if (!tmp)
+    {
+        sort_items(items, n, cmp);
+        return;
+    }
+
+    // Sort a chunk on each thread, bounds[i] is where chunk i starts
+    size_t bounds[k + 1];
+    chunk_task chunks[k];
+    for (int i = 0; i <= k; i++)
+    {
+        bounds[i] = n / k * i + (n % k) * i / k;
+    }
+
+    for (int i = 0; i < k; i++)
+    {
+        chunks[i] = (chunk_task){ &items[bounds[i]], bounds[i + 1] - bounds[i], cmp };
+    }
+
+    run_tasks(sort_chunk, chunks, sizeof(chunk_task), k);
+
+    // Merge pairs of runs until one is left, each merge split in to parts of equal size
+    void **src = items;
+    void **dst = tmp;
+    merge_task merges[k];
+    for (int runs = k; runs > 1; runs = (runs + 1) / 2)
+    {
+        int pairs = runs / 2;
+        int parts = k / pairs;
+        int count = 0;
+        for (int p = 0; p < pairs; p++)
+        {
+            size_t start = bounds[p * 2];
+            void **a = &src[start];
+            void **b = &src[bounds[p * 2 + 1]];
+            size_t la = b - a;
+            size_t lb = bounds[p * 2 + 2] - bounds[p * 2 + 1];
+
+            size_t prev_diag = 0;
+            size_t prev_rank = 0;
+            for (int i = 1; i <= parts; i++)
+            {
+                size_t diag = (la + lb) / parts * i + ((la + lb) % parts) * i / parts;
+                size_t rank = co_rank(a, la, b, lb, diag, cmp);
+                merges[count++] = (merge_task){ a + prev_rank, rank - prev_rank,
+                                                b + (prev_diag - prev_rank), (diag - rank) - (prev_diag - prev_rank),
+                                                &dst[start + prev_diag], cmp };
+                prev_diag = diag;
+                prev_rank = rank;
+            }
+
+            bounds[p + 1] = bounds[p * 2 + 2];
+        }
+
+        // An odd run out is copied across as it is
+        if (runs % 2)
+        {
+            size_t start = bounds[runs - 1];
+            memcpy(&dst[start], &src[start], (n - start) * sizeof(void*));
+            bounds[pairs + 1] = n;
+        }
+
+        bounds[0] = 0;
+        run_tasks(merge_part, merges, sizeof(merge_task), count);
+
+        void **swap_buf = src;
+        src = dst;
+        dst = swap_buf;
+    }
+
+    if (src != items)
+    {
+        memcpy(items, src, n * sizeof(void*));
+    }
+
+    free(tmp);
+}
+
+/*
+ * Thread function which gets the keys of part of the items and counts their digits
+ */
+static void *count_keys(void *arg)
+{
+    count_task *task = arg;
+    memset(task->counts, 0, sizeof(task->counts));
+    for (size_t i = 0; i < task->n; i++)
+    {
+        uint64_t k = task->key(task->items[i]);
+        task->out[i] = (keyed){ k, task->items[i] };
+        for (int p = 0; p < RADIX_PASSES; p++)
+        {
+            task->counts[p][(k >> (p * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Sorts n items by the keys got from them. Each pass moves the keys and items in to a second
+ * buffer in order of one digit, keeping the order of the last pass for equal digits. The items
+ * are written back in their sorted order at the end.
+ */
+void sort_items_radix(void **items, size_t n, sort_key key, int nthreads)
+{
+    size_t most = n / PARALLEL_MIN;
+    nthreads = nthreads < 1 ? 1 : nthreads;
+    int k = (size_t)nthreads < most ? nthreads : (int)most;
+    k = k < 1 ? 1 : k;
+
+    keyed *src = malloc(n * sizeof(keyed));
+    keyed *dst = malloc(n * sizeof(keyed));
+    count_task *tasks = malloc(k * sizeof(count_task));
+    for (int i = 0; i < k; i++)
+    {
+        size_t start = n / k * i + (n % k) * i / k;
+        size_t end = n / k * (i + 1) + (n % k) * (i + 1) / k;
+        tasks[i].items = &items[start];
+        tasks[i].out = &src[start];
+        tasks[i].n = end - start;
+        tasks[i].key = key;
+    }
+
+    run_tasks(count_keys, tasks, sizeof(count_task), k);
+    for (int i = 1; i < k; i++)
+    {
+        for (int p = 0; p < RADIX_PASSES; p++)
+        {
+            for (int b = 0; b < RADIX_SIZE; b++)
+            {
+                tasks[0].counts[p][b] += tasks[i].counts[p][b];
+            }
+        }
+    }
+
+    for (int p = 0; p < RADIX_PASSES; p++)
+    {
+        size_t *counts = tasks[0].counts[p];
+        int shift = p * RADIX_BITS;
+
+        // Every key has the same digit here, the pass would not move anything
+        if (n == 0 || counts[(src[0].key >> shift) & (RADIX_SIZE - 1)] == n)
+        {
+            continue;
+        }
+
+        size_t offsets[RADIX_SIZE];
+        size_t total = 0;
+        for (int b = 0; b < RADIX_SIZE; b++)
+        {
+            offsets[b] = total;
+            total += counts[b];
+        }
+
+        for (size_t i = 0; i < n; i++)
+        {
+            dst[offsets[(src[i].key >> shift) & (RADIX_SIZE - 1)]++] = src[i];
+        }
+
+        keyed *swap_buf = src;
+        src = dst;
+        dst = swap_buf;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        items[i] = src[i].item;
+    }
+
+    free(tasks);
+    free(dst);
+    free(src);
+}
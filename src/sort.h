@@ -0,0 +1,22 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compares two items, returns less than, equal to or greater than zero like strcmp
+typedef int (*sort_cmp)(const void *first, const void *second);
+
+// Sort n items in place with an introsort
+void sort_items(void **items, size_t n, sort_cmp cmp);
+
+// Sort n items with a merge sort spread over up to nthreads threads
+void sort_items_parallel(void **items, size_t n, sort_cmp cmp, int nthreads);
+
+// Gets the integer an item is sorted on
+typedef uint64_t (*sort_key)(const void *item);
+
+// Sort n items by key with a stable radix sort, counting digits on up to nthreads threads
+void sort_items_radix(void **items, size_t n, sort_key key, int nthreads);
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Unit tests for the Bloom filter
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "minunit.h"
+#include "../src/collections.h"
+
+/*
+ * Added keys are always found, and missing keys are found at about the requested rate
+ */
+char *bf_add_test()
+{
+    double rates[] = { 0.1, 0.01, 0.001 };
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    {
+        int num = 20000;
+        void *bf = bloom_filter(num, rates[r]);
+        MU_ASSERT("Empty filter should have no keys", clxns_count(bf) == 0);
+        MU_ASSERT("Empty filter should not find a key", !bloom_filter_test(bf, "key"));
+
+        char key[24];
+        for (int i = 0; i < num; i++)
+        {
+            snprintf(key, sizeof(key), "key%d", i);
+            bloom_filter_add(bf, key);
+        }
+
+        MU_ASSERT("Wrong count of keys added", clxns_count(bf) == (size_t)num);
+        for (int i = 0; i < num; i++)
+        {
+            snprintf(key, sizeof(key), "key%d", i);
+            MU_ASSERT("Added key not found", bloom_filter_test(bf, key));
+        }
+
+        int found = 0;
+        for (int i = 0; i < num; i++)
+        {
+            snprintf(key, sizeof(key), "missing%d", i);
+            found += bloom_filter_test(bf, key) != 0;
+        }
+
+        double rate = (double)found / num;
+        MU_ASSERT("Too many false positives", rate < rates[r] * 1.5);
+        MU_ASSERT("Filter much larger than needed", rate > rates[r] / 4);
+
+        void *copy = clxns_copy(bf);
+        MU_ASSERT("Key not found in copy", bloom_filter_test(copy, "key42"));
+        clxns_free(copy, 0);
+        clxns_free(bf, 0);
+    }
+
+    int zeros = 0;
+    void *bf = bloom_filter(0, 0.01);
+    bloom_filter_add_bin(bf, &zeros, sizeof(zeros));
+    MU_ASSERT("Binary key not found", bloom_filter_test_bin(bf, &zeros, sizeof(zeros)));
+
+    FILE *fp = tmpfile();
+    MU_ASSERT("Wrong status after serialize", clxns_serialize(bf, fp, 0) == C_OK);
+    rewind(fp);
+    void *restored = bloom_filter(0, 0.01);
+    bloom_filter_add(restored, "other");
+    MU_ASSERT("Wrong status after deserialize", clxns_deserialize(restored, fp, 0) == C_OK);
+    MU_ASSERT("Binary key not found after deserialize", bloom_filter_test_bin(restored, &zeros, sizeof(zeros)));
+    MU_ASSERT("Key lost after deserialize", bloom_filter_test(restored, "other"));
+    MU_ASSERT("Wrong count after deserialize", clxns_count(restored) == 2);
+
+    rewind(fp);
+    void *wrong = bloom_filter(100000, 0.01);
+    MU_ASSERT("Read in to wrong size filter", clxns_deserialize(wrong, fp, 0) == CE_IO);
+
+    fclose(fp);
+    clxns_free(wrong, 0);
+    clxns_free(restored, 0);
+    clxns_free(bf, 0);
+    return 0;
+}
+
+/*
+ * Batch add and test give the same answers as adding and testing one key at a time
+ */
+char *bf_add_test_many()
+{
+    size_t num = 1000;
+    char **keys = malloc(2 * num * sizeof(char*));
+    for (size_t i = 0; i < 2 * num; i++)
+    {
+        keys[i] = malloc(24);
+        snprintf(keys[i], 24, "key%zu", i);
+    }
+
+    void *bf = bloom_filter(num, 0.01);
+    bloom_filter_add_many(bf, keys, num);
+    MU_ASSERT("Wrong count after batch add", clxns_count(bf) == num);
+
+    unsigned char *results = malloc(2 * num);
+    bloom_filter_test_many(bf, keys, 2 * num, results);
+    for (size_t i = 0; i < 2 * num; i++)
+    {
+        MU_ASSERT("Batch result differs", !results[i] == !bloom_filter_test(bf, keys[i]));
+        MU_ASSERT("Batch added key not found", i >= num || results[i]);
+    }
+
+    free(results);
+    for (size_t i = 0; i < 2 * num; i++)
+    {
+        free(keys[i]);
+    }
+
+    free(keys);
+    clxns_free(bf, 0);
+    return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * Unit tests for the concurrent hash table
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "minunit.h"
+#include "../src/collections.h"
+
+#define THREADS 4
+#define PER_THREAD 2000
+
+// Work given to each test thread
+typedef struct
+{
+    void *table;
+    int id;
+    int errors;
+} thread_work;
+
+/*
+ * Adds keys unique to the thread, reads them back, then removes every other one. Other threads
+ * are doing the same at the same time and will force the table to grow.
+ */
+static void *worker(void *arg)
+{
+    thread_work *work = arg;
+    char key[32];
+    void *value;
+
+    for (int i = 0; i < PER_THREAD; i++)
+    {
+        char *k = malloc(32);
+        snprintf(k, 32, "t%d-key%d", work->id, i);
+        concurrent_table_add(work->table, k, strdup(k));
+    }
+
+    for (int i = 0; i < PER_THREAD; i++)
+    {
+        sprintf(key, "t%d-key%d", work->id, i);
+        if (concurrent_table_get(work->table, key, &value) != C_OK || strcmp(key, value))
+        {
+            work->errors++;
+        }
+
+        if (i % 2 && concurrent_table_remove(work->table, key, 1) != C_OK)
+        {
+            work->errors++;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Single threaded add, replace, get and remove
+ */
+char *ct_add_get_remove()
+{
+    void *ct = concurrent_table(0);
+    concurrent_table_add(ct, "AAA", "aaa");
+    concurrent_table_add(ct, "BBB", "bbb");
+    concurrent_table_add(ct, "AAA", "xxx");
+    MU_ASSERT("Wrong count after add", clxns_count(ct) == 2);
+
+    char *value;
+    C_STATUS st = concurrent_table_get(ct, "AAA", (void*)&value);
+    MU_ASSERT("Wrong value after replace", st == C_OK && !strcmp(value, "xxx"));
+    st = concurrent_table_get(ct, "CCC", (void*)&value);
+    MU_ASSERT("Wrong status for missing key", st == CE_MISSING && value == 0);
+
+    st = concurrent_table_remove(ct, "AAA", 0);
+    MU_ASSERT("Wrong status after remove", st == C_OK);
+    st = concurrent_table_remove(ct, "AAA", 0);
+    MU_ASSERT("Wrong status after second remove", st == CE_MISSING);
+    MU_ASSERT("Wrong count after remove", clxns_count(ct) == 1);
+
+    clxns_free(ct, 0);
+    return 0;
+}
+
+/*
+ * Several threads add, get and remove at once. The table must end up holding exactly the
+ * items that were not removed.
+ */
+char *ct_threads()
+{
+    void *ct = concurrent_table(0);
+    pthread_t threads[THREADS];
+    thread_work work[THREADS];
+
+    for (int i = 0; i < THREADS; i++)
+    {
+        work[i].table = ct;
+        work[i].id = i;
+        work[i].errors = 0;
+        pthread_create(&threads[i], 0, worker, &work[i]);
+    }
+
+    for (int i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i], 0);
+        MU_ASSERT("Thread saw missing or wrong items", work[i].errors == 0);
+    }
+
+    MU_ASSERT("Wrong count after threads", clxns_count(ct) == THREADS * PER_THREAD / 2);
+
+    // Iterate and copy, every key left should have an even index
+    void *copy = clxns_copy(ct);
+    size_t count = 0;
+    void *iter = clxns_iter_new(copy);
+    while (clxns_iter_move_next(iter))
+    {
+        kvp *kv = clxns_iter_get_next(iter);
+        MU_ASSERT("Removed key found by iterator", atoi(strstr(kv->key, "key") + 3) % 2 == 0);
+        count++;
+    }
+
+    clxns_iter_free(iter);
+    MU_ASSERT("Wrong iter count after threads", count == THREADS * PER_THREAD / 2);
+
+    clxns_free(copy, 0);
+    clxns_free(ct, 1);
+    return 0;
+}
+
+/*
+ * Iterate while this thread and another change the table. Items in the table for the whole
+ * iteration are returned once each, and the writers are not blocked by the iterator.
+ */
+char *ct_iterate_writes()
+{
+    const int num = 1000;
+    void *ct = concurrent_table_seeded(0, clxns_hash_sip, 0x1234567890abcdefULL);
+    for (int i = 0; i < num; i++)
+    {
+        char *k = malloc(32);
+        snprintf(k, 32, "base%d", i);
+        concurrent_table_add(ct, k, 0);
+    }
+
+    pthread_t thread;
+    thread_work work = { ct, 0, 0 };
+    pthread_create(&thread, 0, worker, &work);
+
+    char seen[1000] = { 0 };
+    int added = 0;
+    void *iter = clxns_iter_new(ct);
+    while (clxns_iter_move_next(iter))
+    {
+        kvp *kv = clxns_iter_get_next(iter);
+        if (!strncmp(kv->key, "base", 4))
+        {
+            seen[atoi(kv->key + 4)]++;
+        }
+
+        // Writing from the iterating thread must not deadlock
+        if (added < 100)
+        {
+            char *k = malloc(32);
+            snprintf(k, 32, "extra%d", added++);
+            concurrent_table_add(ct, k, 0);
+        }
+    }
+
+    clxns_iter_free(iter);
+    pthread_join(thread, 0);
+    MU_ASSERT("Writer thread saw missing or wrong items", work.errors == 0);
+
+    for (int i = 0; i < num; i++)
+    {
+        MU_ASSERT("Item not returned exactly once", seen[i] == 1);
+    }
+
+    MU_ASSERT("Wrong count after iterating", clxns_count(ct) == (size_t)num + 100 + PER_THREAD / 2);
+    clxns_free(ct, 1);
+    return 0;
+}
@@ -21,6 +21,16 @@ static char *all_tests()
     MU_RUN_TEST(ra_copy_array);
     MU_RUN_TEST(ra_insert);
     MU_RUN_TEST(ra_replace);
+    MU_RUN_TEST(ra_serialize);
+    MU_RUN_TEST(ra_serialize_corrupt);
+    MU_RUN_TEST(ra_serialize_values);
+    MU_RUN_TEST(ra_ranges);
+    MU_RUN_TEST(ra_extend);
+    MU_RUN_TEST(ra_growth_policy);
+    MU_RUN_TEST(ra_values);
+    MU_RUN_TEST(ra_values_guarded);
+    MU_RUN_TEST(ra_sort);
+    MU_RUN_TEST(ra_radix_sort);
 
     MU_RUN_TEST(pq_add_items);
     MU_RUN_TEST(pq_peek_items);
@@ -28,6 +38,7 @@ static char *all_tests()
     MU_RUN_TEST(pq_pop_items_max);
     MU_RUN_TEST(pq_iterate_items);
     MU_RUN_TEST(pq_copy_queue);
+    MU_RUN_TEST(pq_serialize);
 
     MU_RUN_TEST(ht_add_items);
     MU_RUN_TEST(ht_get_items);
@@ -38,6 +49,56 @@ static char *all_tests()
     MU_RUN_TEST(ht_iterate_empty);
     MU_RUN_TEST(ht_remove_items);
     MU_RUN_TEST(ht_copy);
+    MU_RUN_TEST(ht_churn);
+    MU_RUN_TEST(ht_collisions);
+    MU_RUN_TEST(ht_seeded);
+    MU_RUN_TEST(ht_incremental);
+    MU_RUN_TEST(ht_bitmap_words);
+    MU_RUN_TEST(ht_bitmap_incremental);
+    MU_RUN_TEST(ht_pow2);
+    MU_RUN_TEST(ht_binary_keys);
+    MU_RUN_TEST(ht_add_many);
+    MU_RUN_TEST(ht_inline_keys);
+    MU_RUN_TEST(ht_upsert);
+    MU_RUN_TEST(ht_serialize);
+    MU_RUN_TEST(ht_freeze);
+    MU_RUN_TEST(ht_freeze_large);
+    MU_RUN_TEST(ht_table_stats);
+    MU_RUN_TEST(ht_prehashed);
+    MU_RUN_TEST(ht_filter);
+    MU_RUN_TEST(ht_filter_prehashed);
+    MU_RUN_TEST(ht_reserve_floor);
+
+    MU_RUN_TEST(bf_add_test);
+    MU_RUN_TEST(bf_add_test_many);
+
+    MU_RUN_TEST(ot_add_replace);
+    MU_RUN_TEST(ot_get_items);
+    MU_RUN_TEST(ot_iterate);
+    MU_RUN_TEST(ot_remove_items);
+    MU_RUN_TEST(ot_copy);
+    MU_RUN_TEST(ot_seeded);
+
+    MU_RUN_TEST(dt_add_get_remove);
+    MU_RUN_TEST(dt_insertion_order);
+
+    MU_RUN_TEST(lc_lru_evict);
+    MU_RUN_TEST(lc_clock_sized);
+
+    MU_RUN_TEST(ct_add_get_remove);
+    MU_RUN_TEST(ct_threads);
+    MU_RUN_TEST(ct_iterate_writes);
+
+    MU_RUN_TEST(st_publish);
+    MU_RUN_TEST(st_threads);
+
+    MU_RUN_TEST(mt_write_open);
+    MU_RUN_TEST(mt_fixed_values);
+
+    MU_RUN_TEST(it_add_get);
+    MU_RUN_TEST(it_remove);
+    MU_RUN_TEST(it_iterate_copy);
+    MU_RUN_TEST(it_serialize);
 
     return 0;
 }
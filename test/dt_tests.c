@@ -0,0 +1,138 @@
+/*
+ * Unit tests for the dense hash table
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "minunit.h"
+#include "../src/collections.h"
+
+/*
+ * Populate a dense table with some test data
+ */
+static void *populate(int init, int num)
+{
+    char *k, *v;
+    void *dt = dense_table(init);
+    for (int i = 0; i < num; i++)
+    {
+        k = (char*)malloc(24);
+        snprintf(k, 24, "string%d", i);
+        v = (char*)malloc(24);
+        snprintf(v, 24, "STRING%d", i);
+        dense_table_add(dt, k, v);
+    }
+
+    return dt;
+}
+
+/*
+ * Add, replace, get and remove items in a table large enough to have been resized
+ */
+char *dt_add_get_remove()
+{
+    int num = 5000;
+    void *dt = populate(0, num);
+    MU_ASSERT("Wrong number of items after add", clxns_count(dt) == (size_t)num);
+
+    char key[24];
+    char *value;
+    for (int i = 0; i < num; i++)
+    {
+        snprintf(key, sizeof(key), "string%d", i);
+        C_STATUS st = dense_table_get(dt, key, (void*)&value);
+        MU_ASSERT("Wrong value after add", st == C_OK && !strcmp(value + 6, key + 6));
+    }
+
+    C_STATUS st = dense_table_get(dt, "missing", (void*)&value);
+    MU_ASSERT("Wrong status for missing key", st == CE_MISSING && value == 0);
+
+    dense_table_add(dt, "extra", "first");
+    dense_table_add(dt, "extra", "second");
+    MU_ASSERT("Replace should not change the count", clxns_count(dt) == (size_t)num + 1);
+    st = dense_table_get(dt, "extra", (void*)&value);
+    MU_ASSERT("Wrong value after replace", st == C_OK && !strcmp(value, "second"));
+    dense_table_remove(dt, "extra", 0);
+
+    // Remove all but every hundredth key so the table shrinks
+    for (int i = 0; i < num; i++)
+    {
+        if (i % 100)
+        {
+            snprintf(key, sizeof(key), "string%d", i);
+            st = dense_table_remove(dt, key, 1);
+            MU_ASSERT("Wrong status for remove", st == C_OK);
+        }
+    }
+
+    MU_ASSERT("Wrong number of items after remove", clxns_count(dt) == (size_t)num / 100);
+    st = dense_table_remove(dt, "string1", 1);
+    MU_ASSERT("Wrong status removing missing key", st == CE_MISSING);
+
+    for (int i = 0; i < num; i++)
+    {
+        snprintf(key, sizeof(key), "string%d", i);
+        st = dense_table_get(dt, key, (void*)&value);
+        MU_ASSERT("Wrong status after remove", i % 100 ? st == CE_MISSING : st == C_OK);
+    }
+
+    clxns_free(dt, 1);
+    return 0;
+}
+
+/*
+ * Iterate in insertion order, before and after removes, re-adds and a copy
+ */
+char *dt_insertion_order()
+{
+    int num = 1000;
+    void *dt = populate(0, num);
+
+    char key[24];
+    for (int i = 0; i < num; i += 3)
+    {
+        sprintf(key, "string%d", i);
+        dense_table_remove(dt, key, 1);
+    }
+
+    // Re-added keys go to the end
+    for (int i = 0; i < num; i += 3)
+    {
+        char *k = malloc(24);
+        snprintf(k, 24, "string%d", i);
+        dense_table_add(dt, k, strdup(k));
+    }
+
+    void *copy = clxns_copy(dt);
+    void *tables[] = { dt, copy };
+    for (int t = 0; t < 2; t++)
+    {
+        int expect = 1;
+        int pass = 0;
+        size_t count = 0;
+        void *iter = clxns_iter_new(tables[t]);
+        while (clxns_iter_move_next(iter))
+        {
+            kvp *kv = clxns_iter_get_next(iter);
+            snprintf(key, sizeof(key), "string%d", expect);
+            MU_ASSERT("Iterated out of insertion order", !strcmp(kv->key, key));
+            count++;
+
+            // Keys not divisible by three first, then those that were re-added
+            expect += pass ? 3 : (expect % 3 == 2 ? 2 : 1);
+            if (!pass && expect >= num)
+            {
+                expect = 0;
+                pass = 1;
+            }
+        }
+
+        clxns_iter_free(iter);
+        MU_ASSERT("Wrong iter count", count == (size_t)num);
+    }
+
+    clxns_free(copy, 0);
+    clxns_free(dt, 1);
+    return 0;
+}
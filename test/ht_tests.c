@@ -17,10 +17,10 @@ static void *populate(int init, int num)
     void *ht = hash_table(init);
     for (int i = 0; i < num; i++)
     {
-        k = (char*)malloc(9);
-        sprintf(k, "string%d", i);
-        v = (char*)malloc(9);
-        sprintf(v, "STRING%d", i);
+        k = (char*)malloc(24);
+        snprintf(k, 24, "string%d", i);
+        v = (char*)malloc(24);
+        snprintf(v, 24, "STRING%d", i);
         hash_table_add(ht, k, v);
     }
 
@@ -93,14 +93,14 @@ char *ht_get_items()
     MU_ASSERT("Wrong status after second get", st == CE_MISSING);
     MU_ASSERT("Wrong value after second get", value == 0);
 
-    char k[9], v[9];
+    char k[24], v[24];
     for (int i = 0; i < num; i++)
     {
-        sprintf(k, "string%d", i);
+        snprintf(k, sizeof(k), "string%d", i);
         st = hash_table_get(ht, k, (void*)&value);
         MU_ASSERT("Wrong status after loop get", st == C_OK);
 
-        sprintf(v, "STRING%d", i);
+        snprintf(v, sizeof(v), "STRING%d", i);
         MU_ASSERT("Wrong value after loop get", !strcmp(v, value));
     }
 
@@ -237,10 +237,10 @@ char *ht_remove_items()
 
     int cnt;
     char *value;
-    char k[9];
+    char k[24];
     for (int i = 0; i < num; i++)
     {
-        sprintf(k, "string%d", i);
+        snprintf(k, sizeof(k), "string%d", i);
         st = hash_table_remove(ht, k, 1);
         MU_ASSERT("Wrong status after loop remove", st == C_OK);
 
@@ -296,3 +296,989 @@ char *ht_copy()
     clxns_free(ht2, 0);
     return 0;
 }
+
+/*
+ * Repeatedly add and remove keys so that nodes are recycled through the table's pool
+ */
+char *ht_churn()
+{
+    int num = 200;
+    char keys[200][16];
+    void *ht = hash_table(0);
+    for (int i = 0; i < num; i++)
+    {
+        sprintf(keys[i], "string%d", i);
+        hash_table_add(ht, keys[i], keys[i]);
+    }
+
+    char *value;
+    C_STATUS st;
+    for (int round = 0; round < 5; round++)
+    {
+        for (int i = round % 2; i < num; i += 2)
+        {
+            st = hash_table_remove(ht, keys[i], 0);
+            MU_ASSERT("Wrong status after churn remove", st == C_OK);
+        }
+
+        MU_ASSERT("Wrong count after churn remove", clxns_count(ht) == (size_t)num / 2);
+
+        for (int i = round % 2; i < num; i += 2)
+        {
+            hash_table_add(ht, keys[i], keys[i]);
+        }
+
+        for (int i = 0; i < num; i++)
+        {
+            st = hash_table_get(ht, keys[i], (void*)&value);
+            MU_ASSERT("Wrong status after churn get", st == C_OK);
+            MU_ASSERT("Wrong value after churn get", value == keys[i]);
+        }
+    }
+
+    MU_ASSERT("Wrong count after churn", clxns_count(ht) == (size_t)num);
+    clxns_free(ht, 0);
+    return 0;
+}
+
+/*
+ * Keys whose hashes collide must be kept apart. "Ez" and "FY" have the same djb2 hash.
+ */
+char *ht_collisions()
+{
+    void *ht = hash_table(0);
+    hash_table_add(ht, "Ez", "ez");
+    hash_table_add(ht, "FY", "fy");
+    MU_ASSERT("Colliding keys should both be added", clxns_count(ht) == 2);
+
+    char *value;
+    C_STATUS st = hash_table_get(ht, "Ez", (void*)&value);
+    MU_ASSERT("Wrong value for first colliding key", st == C_OK && !strcmp(value, "ez"));
+    st = hash_table_get(ht, "FY", (void*)&value);
+    MU_ASSERT("Wrong value for second colliding key", st == C_OK && !strcmp(value, "fy"));
+
+    st = hash_table_remove(ht, "Ez", 0);
+    MU_ASSERT("Wrong status after colliding remove", st == C_OK);
+    st = hash_table_get(ht, "FY", (void*)&value);
+    MU_ASSERT("Colliding key lost after remove", st == C_OK && !strcmp(value, "fy"));
+
+    clxns_free(ht, 0);
+    return 0;
+}
+
+/*
+ * Use each of the built-in hash functions with a seed
+ */
+char *ht_seeded()
+{
+    clxns_hash hashes[] = { clxns_hash_djb2, clxns_hash_wy, clxns_hash_sip };
+    const char *key = "a key which is longer than forty eight bytes, to test every path";
+
+    for (size_t h = 0; h < sizeof(hashes) / sizeof(hashes[0]); h++)
+    {
+        // Different seeds give different hashes, same seed gives the same hash
+        size_t len = strlen(key);
+        MU_ASSERT("Seeds should change the hash", hashes[h](key, len, 1) != hashes[h](key, len, 2));
+        MU_ASSERT("Hash should be repeatable", hashes[h](key, len, 1) == hashes[h](key, len, 1));
+
+        void *ht = hash_table_seeded(0, hashes[h], 0x1234567890abcdefULL);
+        char k[32];
+        for (int i = 0; i < 100; i++)
+        {
+            sprintf(k, "string%d", i);
+            hash_table_add(ht, strdup(k), 0);
+        }
+
+        MU_ASSERT("Wrong count in seeded table", clxns_count(ht) == 100);
+
+        void *copy = clxns_copy(ht);
+        char *value;
+        for (int i = 0; i < 100; i++)
+        {
+            sprintf(k, "string%d", i);
+            MU_ASSERT("Missing item in seeded table", hash_table_get(ht, k, (void*)&value) == C_OK);
+            MU_ASSERT("Missing item in seeded copy", hash_table_get(copy, k, (void*)&value) == C_OK);
+        }
+
+        clxns_free(copy, 0);
+        clxns_free(ht, 1);
+    }
+
+    return 0;
+}
+
+/*
+ * Count the items returned by iterating over a collection
+ */
+static size_t iter_count(void *collection)
+{
+    size_t rv = 0;
+    void *iter = clxns_iter_new(collection);
+    while (clxns_iter_move_next(iter))
+    {
+        rv++;
+    }
+
+    clxns_iter_free(iter);
+    return rv;
+}
+
+/*
+ * Add and remove items with incremental resizing. Every item must be found, and iterated over
+ * exactly once, while slots are being migrated.
+ */
+char *ht_incremental()
+{
+    int num = 500;
+    char keys[500][16];
+    void *ht = hash_table(0);
+    hash_table_set_flags(ht, HT_INCREMENTAL);
+
+    char *value;
+    for (int i = 0; i < num; i++)
+    {
+        sprintf(keys[i], "string%d", i);
+        hash_table_add(ht, keys[i], keys[i]);
+
+        for (int j = 0; j <= i; j += 7)
+        {
+            C_STATUS st = hash_table_get(ht, keys[j], (void*)&value);
+            MU_ASSERT("Item missing during incremental grow", st == C_OK && value == keys[j]);
+        }
+
+        MU_ASSERT("Wrong iter count during incremental grow", iter_count(ht) == (size_t)i + 1);
+    }
+
+    void *copy = clxns_copy(ht);
+    MU_ASSERT("Wrong count in copy of incremental table", iter_count(copy) == (size_t)num);
+    clxns_free(copy, 0);
+
+    for (int i = 0; i < num; i++)
+    {
+        C_STATUS st = hash_table_remove(ht, keys[i], 0);
+        MU_ASSERT("Wrong status during incremental shrink", st == C_OK);
+
+        for (int j = i + 1; j < num; j += 7)
+        {
+            st = hash_table_get(ht, keys[j], (void*)&value);
+            MU_ASSERT("Item missing during incremental shrink", st == C_OK && value == keys[j]);
+        }
+
+        MU_ASSERT("Wrong iter count during incremental shrink", iter_count(ht) == (size_t)(num - i - 1));
+    }
+
+    clxns_free(ht, 0);
+    return 0;
+}
+
+/*
+ * Hashes a size_t key to its own value, so that a test can choose the slot each key goes in
+ */
+static uint64_t slot_hash(const void *key, size_t len, uint64_t seed)
+{
+    (void)len;
+    (void)seed;
+
+    size_t rv;
+    memcpy(&rv, key, sizeof(rv));
+    return rv;
+}
+
+/*
+ * Checks that iterating returns the keys with a 1 in want, each once and in slot order
+ */
+static int iter_slots(void *ht, const char *want, size_t capacity)
+{
+    size_t last = 0;
+    size_t count = 0;
+    int ok = 1;
+    void *iter = clxns_iter_new(ht);
+    while (clxns_iter_move_next(iter))
+    {
+        kvp *kv = clxns_iter_get_next(iter);
+        size_t slot = *(size_t*)kv->key;
+        ok = ok && slot < capacity && want[slot] && (!count || slot > last);
+        last = slot;
+        count++;
+    }
+
+    clxns_iter_free(iter);
+    for (size_t i = 0; i < capacity; i++)
+    {
+        count -= want[i];
+    }
+
+    return ok && !count;
+}
+
+/*
+ * Iterate over a table larger than one bitmap word with keys on the boundaries between words,
+ * then remove keys so that whole words are empty
+ */
+char *ht_bitmap_words()
+{
+    size_t capacity = 1000;
+    size_t slots[] = { 0, 1, 62, 63, 64, 127, 128, 191, 255, 256, 511, 512, 959, 960, 998, 999 };
+    size_t num = sizeof(slots) / sizeof(slots[0]);
+    char want[1000] = { 0 };
+
+    void *ht = hash_table_seeded(capacity, slot_hash, 0);
+    ht_stats stats;
+    hash_table_stats(ht, &stats);
+    MU_ASSERT("Wrong capacity", stats.capacity == capacity);
+
+    for (size_t i = 0; i < num; i++)
+    {
+        hash_table_add_bin(ht, &slots[i], sizeof(size_t), 0);
+        want[slots[i]] = 1;
+    }
+
+    MU_ASSERT("Wrong keys iterating word boundaries", iter_slots(ht, want, capacity));
+
+    // empty the second and third words, then the last partial word
+    size_t gone[] = { 64, 127, 128, 191, 960, 998, 999 };
+    for (size_t i = 0; i < sizeof(gone) / sizeof(gone[0]); i++)
+    {
+        MU_ASSERT("Wrong status removing", hash_table_remove_bin(ht, &gone[i], sizeof(size_t), 0) == C_OK);
+        want[gone[i]] = 0;
+        MU_ASSERT("Wrong keys iterating after removal", iter_slots(ht, want, capacity));
+    }
+
+    hash_table_stats(ht, &stats);
+    MU_ASSERT("Table should not shrink", stats.capacity == capacity);
+    MU_ASSERT("Wrong filled count", stats.filled == num - 7);
+
+    // empty every word but the first
+    for (size_t i = 8; i < num; i++)
+    {
+        if (want[slots[i]])
+        {
+            hash_table_remove_bin(ht, &slots[i], sizeof(size_t), 0);
+            want[slots[i]] = 0;
+        }
+    }
+
+    MU_ASSERT("Wrong keys iterating first word only", iter_slots(ht, want, capacity));
+    clxns_free(ht, 0);
+    return 0;
+}
+
+/*
+ * Iterate and free while an incremental resize is in flight, when the old and new slots both
+ * have bitmaps in use
+ */
+char *ht_bitmap_incremental()
+{
+    size_t num = 400;
+    size_t *keys = malloc(num * sizeof(size_t));
+    for (size_t i = 0; i < num; i++)
+    {
+        keys[i] = i * 3;
+    }
+
+    for (int freed = 0; freed < 2; freed++)
+    {
+        void *ht = hash_table_seeded(130, slot_hash, 0);
+        hash_table_set_flags(ht, HT_INCREMENTAL);
+
+        int migrating = 0;
+        for (size_t i = 0; i < num; i++)
+        {
+            size_t *key = malloc(sizeof(size_t));
+            *key = keys[i];
+            hash_table_add_bin(ht, key, sizeof(size_t), 0);
+
+            ht_stats stats;
+            hash_table_stats(ht, &stats);
+            int in_flight = stats.capacity != 130 && stats.capacity != 260 && stats.capacity != 520;
+            migrating += in_flight;
+            size_t count = 0;
+            size_t sum = 0;
+            void *iter = clxns_iter_new(ht);
+            while (clxns_iter_move_next(iter))
+            {
+                kvp *kv = clxns_iter_get_next(iter);
+                sum += *(size_t*)kv->key;
+                count++;
+            }
+
+            clxns_iter_free(iter);
+            MU_ASSERT("Wrong keys iterating while migrating", count == i + 1 && sum == 3 * i * (i + 1) / 2);
+
+            if (in_flight && freed)
+            {
+                // frees the nodes in both the old and new slots
+                break;
+            }
+        }
+
+        MU_ASSERT("Resize never in flight", migrating);
+        clxns_free(ht, 1);
+    }
+
+    free(keys);
+    return 0;
+}
+
+/*
+ * Use power of two capacities, both set on an empty table and switched on a populated one
+ */
+char *ht_pow2()
+{
+    int num = 300;
+    char keys[300][16];
+    void *ht = hash_table(0);
+    hash_table_set_flags(ht, HT_POW2);
+
+    char *value;
+    for (int i = 0; i < num; i++)
+    {
+        sprintf(keys[i], "string%d", i);
+        hash_table_add(ht, keys[i], keys[i]);
+    }
+
+    void *copy = clxns_copy(ht);
+    hash_table_set_flags(ht, HT_POW2 | HT_INCREMENTAL);
+    for (int i = 0; i < num; i++)
+    {
+        C_STATUS st = hash_table_get(ht, keys[i], (void*)&value);
+        MU_ASSERT("Item missing from power of two table", st == C_OK && value == keys[i]);
+        st = hash_table_get(copy, keys[i], (void*)&value);
+        MU_ASSERT("Item missing from power of two copy", st == C_OK && value == keys[i]);
+    }
+
+    // Switch back to modulo indexing with items in the table
+    hash_table_set_flags(copy, HT_DEFAULT);
+    for (int i = 0; i < num; i++)
+    {
+        C_STATUS st = hash_table_get(copy, keys[i], (void*)&value);
+        MU_ASSERT("Item missing after leaving power of two", st == C_OK && value == keys[i]);
+        st = hash_table_remove(ht, keys[i], 0);
+        MU_ASSERT("Wrong status after power of two remove", st == C_OK);
+    }
+
+    MU_ASSERT("Power of two table should be empty", iter_count(ht) == 0 && clxns_count(ht) == 0);
+    MU_ASSERT("Copy should be untouched", iter_count(copy) == (size_t)num);
+    clxns_free(copy, 0);
+    clxns_free(ht, 0);
+    return 0;
+}
+
+/*
+ * Binary keys may contain zeros and are matched on their length as well as their bytes
+ */
+char *ht_binary_keys()
+{
+    uint64_t ids[3] = { 0, 1, 1ULL << 40 };
+    char zeros[4] = { 0, 0, 0, 0 };
+    void *ht = hash_table(0);
+
+    for (int i = 0; i < 3; i++)
+    {
+        hash_table_add_bin(ht, &ids[i], sizeof(uint64_t), &ids[i]);
+    }
+
+    hash_table_add_bin(ht, zeros, 2, "two");
+    hash_table_add_bin(ht, zeros, 3, "three");
+    hash_table_add(ht, "abc", "string");
+    MU_ASSERT("Wrong count for binary keys", clxns_count(ht) == 6);
+
+    void *value;
+    for (int i = 0; i < 3; i++)
+    {
+        uint64_t id = ids[i];
+        C_STATUS st = hash_table_get_bin(ht, &id, sizeof(id), &value);
+        MU_ASSERT("Wrong value for integer key", st == C_OK && value == &ids[i]);
+    }
+
+    C_STATUS st = hash_table_get_bin(ht, zeros, 3, &value);
+    MU_ASSERT("Wrong value for zero key", st == C_OK && !strcmp(value, "three"));
+    st = hash_table_get_bin(ht, zeros, 4, &value);
+    MU_ASSERT("Longer zero key should be missing", st == CE_MISSING);
+    st = hash_table_get_bin(ht, "abc", 3, &value);
+    MU_ASSERT("String key should match binary key", st == C_OK && !strcmp(value, "string"));
+
+    st = hash_table_remove_bin(ht, zeros, 2, 0);
+    MU_ASSERT("Wrong status after binary remove", st == C_OK);
+    st = hash_table_get_bin(ht, zeros, 3, &value);
+    MU_ASSERT("Other zero key lost after remove", st == C_OK);
+
+    void *iter = clxns_iter_new(ht);
+    while (clxns_iter_move_next(iter))
+    {
+        kvp *kv = clxns_iter_get_next(iter);
+        MU_ASSERT("Wrong key length from iterator", kv->key_len == 8 || kv->key_len == 3);
+    }
+
+    clxns_iter_free(iter);
+    clxns_free(ht, 0);
+    return 0;
+}
+
+/*
+ * Bulk add items to a reserved table, including a key repeated within the batch
+ */
+char *ht_add_many()
+{
+    int num = 1000;
+    char *keys[1001];
+    void *values[1001];
+    for (int i = 0; i < num; i++)
+    {
+        keys[i] = malloc(24);
+        snprintf(keys[i], 24, "string%d", i);
+        values[i] = keys[i];
+    }
+
+    keys[num] = "string5";
+    values[num] = "replaced";
+
+    void *ht = hash_table(0);
+    hash_table_add(ht, "existing", "value");
+    hash_table_reserve(ht, num);
+    hash_table_add_many(ht, keys, values, num + 1);
+    MU_ASSERT("Wrong count after bulk add", clxns_count(ht) == (size_t)num + 1);
+
+    char *value;
+    for (int i = 0; i < num; i++)
+    {
+        C_STATUS st = hash_table_get(ht, keys[i], (void*)&value);
+        MU_ASSERT("Item missing after bulk add", st == C_OK);
+        MU_ASSERT("Wrong value after bulk add", i == 5 ? !strcmp(value, "replaced") : value == keys[i]);
+    }
+
+    C_STATUS st = hash_table_get(ht, "existing", (void*)&value);
+    MU_ASSERT("Existing item lost by bulk add", st == C_OK && !strcmp(value, "value"));
+
+    hash_table_add_many(ht, keys, 0, 3);
+    st = hash_table_get(ht, keys[2], (void*)&value);
+    MU_ASSERT("Bulk add without values should set null", st == C_OK && value == 0);
+
+    for (int i = 0; i < num; i++)
+    {
+        free(keys[i]);
+    }
+
+    clxns_free(ht, 0);
+    return 0;
+}
+
+/*
+ * Short keys copied in to the nodes, mixed with long keys which are still compared through the
+ * key pointer. The table is rebuilt when the inline length is set after items have been added.
+ */
+char *ht_inline_keys()
+{
+    int num = 200;
+    void *ht = hash_table(0);
+    for (int i = 0; i < num; i++)
+    {
+        char *key = malloc(40);
+        snprintf(key, 40, i % 2 ? "short%d" : "a much longer key number %d", i);
+        hash_table_add(ht, key, strdup(key));
+    }
+
+    hash_table_set_inline(ht, 12);
+    MU_ASSERT("Wrong count after setting inline", clxns_count(ht) == (size_t)num && iter_count(ht) == (size_t)num);
+
+    char key[32];
+    void *value;
+    for (int i = 0; i < num; i++)
+    {
+        sprintf(key, i % 2 ? "short%d" : "a much longer key number %d", i);
+        C_STATUS st = hash_table_get(ht, key, &value);
+        MU_ASSERT("Wrong value for inline table", st == C_OK && !strcmp(value, key));
+    }
+
+    // Binary keys with zeros are copied in full
+    char zeros[4] = { 0, 0, 0, 0 };
+    hash_table_add_bin(ht, zeros, 2, "two");
+    hash_table_add_bin(ht, zeros, 3, "three");
+    C_STATUS st = hash_table_get_bin(ht, zeros, 3, &value);
+    MU_ASSERT("Wrong value for inline zero key", st == C_OK && !strcmp(value, "three"));
+    hash_table_remove_bin(ht, zeros, 2, 0);
+    hash_table_remove_bin(ht, zeros, 3, 0);
+
+    void *copy = clxns_copy(ht);
+    for (int i = 0; i < num; i++)
+    {
+        sprintf(key, i % 2 ? "short%d" : "a much longer key number %d", i);
+        st = hash_table_get(copy, key, &value);
+        MU_ASSERT("Wrong value in copy of inline table", st == C_OK && !strcmp(value, key));
+
+        if (i % 3 == 0)
+        {
+            st = hash_table_remove(ht, key, 1);
+            MU_ASSERT("Wrong status removing from inline table", st == C_OK);
+        }
+    }
+
+    MU_ASSERT("Wrong count after remove", clxns_count(ht) == (size_t)(num - (num + 2) / 3));
+    clxns_free(copy, 0);
+    clxns_free(ht, 1);
+    return 0;
+}
+
+/*
+ * Adds one to a count held in the value pointer
+ */
+static void count_word(void **value, int inserted, void *ctx)
+{
+    (*(int*)ctx) += inserted;
+    *value = (void*)((intptr_t)*value + 1);
+}
+
+/*
+ * Counts words with get_or_insert and upsert, updating the values in place
+ */
+char *ht_upsert()
+{
+    char *words[] = { "apple", "pear", "apple", "plum", "pear", "apple" };
+    int num = sizeof(words) / sizeof(words[0]);
+    void *ht = hash_table(0);
+
+    int inserted;
+    int new_keys = 0;
+    for (int i = 0; i < num; i++)
+    {
+        void **value = hash_table_get_or_insert(ht, words[i], &inserted);
+        MU_ASSERT("New key should have a null value", !inserted || *value == 0);
+        new_keys += inserted;
+        *value = (void*)((intptr_t)*value + 1);
+    }
+
+    MU_ASSERT("Wrong number of new keys", new_keys == 3);
+    MU_ASSERT("Wrong count after get_or_insert", clxns_count(ht) == 3);
+
+    void *value;
+    hash_table_get(ht, "apple", &value);
+    MU_ASSERT("Wrong count for apple", (intptr_t)value == 3);
+
+    new_keys = 0;
+    for (int i = 0; i < num; i++)
+    {
+        hash_table_upsert(ht, words[i], count_word, &new_keys);
+    }
+
+    hash_table_upsert(ht, "fig", count_word, &new_keys);
+    MU_ASSERT("Wrong number of new keys from upsert", new_keys == 1);
+
+    hash_table_get(ht, "apple", &value);
+    MU_ASSERT("Wrong count for apple after upsert", (intptr_t)value == 6);
+    hash_table_get(ht, "fig", &value);
+    MU_ASSERT("Wrong count for fig after upsert", (intptr_t)value == 1);
+
+    // The table grows as keys are added, the value pointers stay valid
+    char keys[100][16];
+    void **first = hash_table_get_or_insert(ht, "plum", 0);
+    for (int i = 0; i < 100; i++)
+    {
+        sprintf(keys[i], "key%d", i);
+        hash_table_get_or_insert(ht, keys[i], 0);
+    }
+
+    MU_ASSERT("Value pointer moved by growth", (intptr_t)*first == 2);
+    MU_ASSERT("Wrong count after growth", clxns_count(ht) == 104);
+
+    clxns_free(ht, 0);
+    return 0;
+}
+
+/*
+ * Write a table with binary keys to a stream and read it back in to each kind of table
+ */
+char *ht_serialize()
+{
+    int num = 300;
+    void *ht = hash_table(0);
+    for (int i = 0; i < num; i++)
+    {
+        char *k = malloc(24);
+        snprintf(k, 24, "string%d", i);
+        hash_table_add(ht, k, strdup(k));
+    }
+
+    char zeros[3] = { 0, 0, 0 };
+    hash_table_add_bin(ht, zeros, 3, "zeros");
+
+    FILE *fp = tmpfile();
+    C_STATUS st = clxns_serialize(ht, fp, &clxns_string_codec);
+    MU_ASSERT("Wrong status after serialize", st == C_OK);
+
+    void *tables[] = { hash_table(0), concurrent_table(0), snapshot_table(0) };
+    for (int t = 0; t < 3; t++)
+    {
+        rewind(fp);
+        st = clxns_deserialize(tables[t], fp, &clxns_string_codec);
+        MU_ASSERT("Wrong status after deserialize", st == C_OK);
+    }
+
+    snapshot_table_publish(tables[2]);
+    void *rd = snapshot_reader(tables[2]);
+    char key[24];
+    char *value;
+    for (int i = 0; i < num; i++)
+    {
+        snprintf(key, sizeof(key), "string%d", i);
+        hash_table_get(tables[0], key, (void*)&value);
+        MU_ASSERT("Wrong value in restored hash table", value && !strcmp(value, key));
+        concurrent_table_get(tables[1], key, (void*)&value);
+        MU_ASSERT("Wrong value in restored concurrent table", value && !strcmp(value, key));
+        snapshot_table_get(rd, key, (void*)&value);
+        MU_ASSERT("Wrong value in restored snapshot table", value && !strcmp(value, key));
+    }
+
+    st = hash_table_get_bin(tables[0], zeros, 3, (void*)&value);
+    MU_ASSERT("Wrong value for restored binary key", st == C_OK && !strcmp(value, "zeros"));
+    MU_ASSERT("Wrong count after deserialize", clxns_count(tables[0]) == (size_t)num + 1);
+
+    snapshot_reader_free(rd);
+    for (int t = 0; t < 3; t++)
+    {
+        clxns_free(tables[t], 1);
+    }
+
+    fclose(fp);
+    hash_table_remove_bin(ht, zeros, 3, 0);
+    clxns_free(ht, 1);
+    return 0;
+}
+
+/*
+ * Freeze tables of several sizes in to minimal perfect hash maps and look every key up
+ */
+char *ht_freeze()
+{
+    int sizes[] = { 0, 1, 2, 5, 100, 5000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int num = sizes[s];
+        void *ht = hash_table(0);
+        for (int i = 0; i < num; i++)
+        {
+            char *k = malloc(24);
+            snprintf(k, 24, "string%d", i);
+            hash_table_add(ht, k, strdup(k));
+        }
+
+        void *ft = hash_table_freeze(ht);
+        MU_ASSERT("Wrong count for frozen table", clxns_count(ft) == (size_t)num);
+        MU_ASSERT("Wrong iter count for frozen table", iter_count(ft) == (size_t)num);
+
+        char key[24];
+        char *value;
+        for (int i = 0; i < num; i++)
+        {
+            snprintf(key, sizeof(key), "string%d", i);
+            C_STATUS st = frozen_table_get(ft, key, (void*)&value);
+            MU_ASSERT("Wrong value from frozen table", st == C_OK && !strcmp(value, key));
+        }
+
+        C_STATUS st = frozen_table_get(ft, "missing", (void*)&value);
+        MU_ASSERT("Wrong status for missing key", st == CE_MISSING && value == 0);
+
+        void *copy = clxns_copy(ft);
+        clxns_free(ft, 0);
+        st = frozen_table_get(copy, "string0", (void*)&value);
+        MU_ASSERT("Wrong value from copy of frozen table", num == 0 ? st == CE_MISSING : st == C_OK);
+
+        clxns_free(copy, 1);
+        clxns_free(ht, 0);
+    }
+
+    return 0;
+}
+
+/*
+ * Freeze a large table, where the last buckets are placed in to a nearly full table, and give
+ * up on keys which are not unique rather than trying seeds forever
+ */
+char *ht_freeze_large()
+{
+    size_t num = 300000;
+    uint64_t *keys = malloc(num * sizeof(uint64_t));
+    void *ht = hash_table_seeded(num, clxns_hash_wy, 0);
+    for (size_t i = 0; i < num; i++)
+    {
+        keys[i] = i * 7919;
+        hash_table_add_bin(ht, &keys[i], sizeof(uint64_t), &keys[i]);
+    }
+
+    void *ft = hash_table_freeze(ht);
+    MU_ASSERT("Large table not frozen", ft && clxns_count(ft) == num);
+    for (size_t i = 0; i < num; i++)
+    {
+        void *value;
+        C_STATUS st = frozen_table_get_bin(ft, &keys[i], sizeof(uint64_t), &value);
+        MU_ASSERT("Wrong value from large frozen table", st == C_OK && value == &keys[i]);
+    }
+
+    uint64_t missing = 1;
+    void *value;
+    MU_ASSERT("Missing key found", frozen_table_get_bin(ft, &missing, sizeof(uint64_t), &value) == CE_MISSING);
+    clxns_free(ft, 0);
+    clxns_free(ht, 0);
+    free(keys);
+
+    kvp same[] = { { "dup", "a", 3 }, { "dup", "b", 3 }, { "other", "c", 5 } };
+    void *array = resize_array(0);
+    for (size_t i = 0; i < sizeof(same) / sizeof(same[0]); i++)
+    {
+        resize_array_add(array, &same[i]);
+    }
+
+    MU_ASSERT("Duplicate keys frozen", hash_table_freeze(array) == 0);
+    clxns_free(array, 0);
+    return 0;
+}
+
+/*
+ * Occupancy and resize statistics, with and without an incremental resize in progress
+ */
+char *ht_table_stats()
+{
+    int flags[] = { HT_DEFAULT, HT_INCREMENTAL };
+    for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++)
+    {
+        void *ht = hash_table(0);
+        hash_table_set_flags(ht, flags[f]);
+
+        ht_stats stats;
+        hash_table_stats(ht, &stats);
+        MU_ASSERT("Empty table should have no items", stats.count == 0 && stats.filled == 0);
+        MU_ASSERT("Empty table should have empty chains", stats.chains[0] == stats.capacity);
+        MU_ASSERT("Empty table should not have resized", stats.resizes == 0);
+
+        int num = 1000;
+        for (int i = 0; i < num; i++)
+        {
+            char *k = malloc(24);
+            snprintf(k, 24, "string%d", i);
+            hash_table_add(ht, k, 0);
+        }
+
+        hash_table_stats(ht, &stats);
+        MU_ASSERT("Wrong count in stats", stats.count == (size_t)num);
+        MU_ASSERT("Table should have resized", stats.resizes > 0 && stats.resize_secs >= 0);
+        MU_ASSERT("Wrong load factor", stats.load_factor == (double)num / stats.capacity);
+        MU_ASSERT("Table should use some memory", stats.bytes > stats.capacity * sizeof(void*));
+
+        size_t slots = 0;
+        size_t items = 0;
+        for (size_t i = 0; i < HT_STATS_CHAINS; i++)
+        {
+            slots += stats.chains[i];
+            items += i * stats.chains[i];
+        }
+
+        MU_ASSERT("Chains do not add up to the capacity", slots == stats.capacity);
+        MU_ASSERT("Filled does not match the chains", stats.filled == slots - stats.chains[0]);
+        MU_ASSERT("Chains hold more items than the table", items <= (size_t)num);
+        MU_ASSERT("Longest chain too short", stats.max_chain >= 1);
+
+#ifdef CLXNS_PROBE_STATS
+        void *value;
+        uint64_t lookups = stats.lookups;
+        hash_table_get(ht, "string1", &value);
+        hash_table_get(ht, "missing", &value);
+        hash_table_stats(ht, &stats);
+        MU_ASSERT("Lookups not counted", stats.lookups >= lookups + 2);
+        MU_ASSERT("Probes not counted", stats.probes >= 1);
+#endif
+
+        clxns_free(ht, 1);
+    }
+
+    return 0;
+}
+
+/*
+ * Look up, add and remove keys with hashes computed once and shared between tables
+ */
+char *ht_prehashed()
+{
+    void *first = populate(0, 100);
+    void *second = hash_table(0);
+    void *other = hash_table_seeded(0, clxns_hash_wy, 7);
+
+    char key[24];
+    char *value;
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(key, sizeof(key), "string%d", i);
+        uint64_t hash = hash_table_hash(first, key);
+        MU_ASSERT("Same key hashed differently", hash == hash_table_hash(second, key));
+
+        C_STATUS st = hash_table_get_prehashed(first, key, hash, (void*)&value);
+        MU_ASSERT("Wrong value for prehashed get", st == C_OK && !strcmp(value + 6, key + 6));
+        hash_table_add_prehashed(second, strdup(key), hash, strdup(value));
+    }
+
+    MU_ASSERT("Wrong count after prehashed adds", clxns_count(second) == 100);
+    C_STATUS st = hash_table_get(second, "string42", (void*)&value);
+    MU_ASSERT("Prehashed key not found by get", st == C_OK && !strcmp(value, "STRING42"));
+
+    uint64_t hash = hash_table_hash(second, "string42");
+    st = hash_table_remove_prehashed(second, "string42", hash, 1);
+    MU_ASSERT("Wrong status for prehashed remove", st == C_OK && clxns_count(second) == 99);
+    st = hash_table_get_prehashed(second, "string42", hash, (void*)&value);
+    MU_ASSERT("Removed key still found", st == CE_MISSING && value == 0);
+    st = hash_table_remove_prehashed(second, "string42", hash, 1);
+    MU_ASSERT("Wrong status removing missing key", st == CE_MISSING);
+
+    hash_table_add_prehashed(other, "key", hash_table_hash(other, "key"), "value");
+    st = hash_table_get(other, "key", (void*)&value);
+    MU_ASSERT("Wrong value from seeded table", st == C_OK && !strcmp(value, "value"));
+
+    clxns_free(other, 0);
+    clxns_free(second, 1);
+    clxns_free(first, 1);
+    return 0;
+}
+
+/*
+ * A filter in front of the table rejects missing keys and learns the keys added later
+ */
+char *ht_filter()
+{
+    void *ht = populate(0, 100);
+    void *bf = bloom_filter(1000, 0.01);
+    hash_table_set_filter(ht, bf);
+    MU_ASSERT("Table keys not added to filter", clxns_count(bf) == 100);
+
+    char key[24];
+    char *value;
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(key, sizeof(key), "string%d", i);
+        C_STATUS st = hash_table_get(ht, key, (void*)&value);
+        MU_ASSERT("Wrong status with filter", i < 100 ? st == C_OK : st == CE_MISSING && value == 0);
+    }
+
+    hash_table_add(ht, "added", "later");
+    MU_ASSERT("Added key not found", bloom_filter_test(bf, "added"));
+    C_STATUS st = hash_table_get(ht, "added", (void*)&value);
+    MU_ASSERT("Wrong value for key added with filter", st == C_OK && !strcmp(value, "later"));
+    st = hash_table_remove(ht, "added", 0);
+    MU_ASSERT("Wrong status removing with filter", st == C_OK);
+    st = hash_table_remove(ht, "never", 0);
+    MU_ASSERT("Wrong status removing missing key", st == CE_MISSING);
+
+    void *copy = clxns_copy(ht);
+    st = hash_table_get(copy, "string5", (void*)&value);
+    MU_ASSERT("Wrong value from copy with filter", st == C_OK && !strcmp(value, "STRING5"));
+    clxns_free(copy, 0);
+
+    hash_table_set_filter(ht, 0);
+    clxns_free(bf, 0);
+    st = hash_table_get(ht, "string5", (void*)&value);
+    MU_ASSERT("Wrong value after detaching filter", st == C_OK);
+    clxns_free(ht, 1);
+    return 0;
+}
+
+/*
+ * A table hashed as the filter hashes gives it the caller's hash on the _prehashed paths, and
+ * the filter still agrees with keys tested on it directly
+ */
+char *ht_filter_prehashed()
+{
+    void *ht = hash_table_seeded(0, clxns_hash_wy, 0);
+    void *bf = bloom_filter(1000, 0.01);
+    hash_table_add(ht, "before", "1");
+    hash_table_set_filter(ht, bf);
+
+    char key[24];
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(key, sizeof(key), "key%d", i);
+        hash_table_add_prehashed(ht, strdup(key), hash_table_hash(ht, key), 0);
+        MU_ASSERT("Prehashed key not in filter", bloom_filter_test(bf, key));
+        MU_ASSERT("Hashes differ", bloom_filter_test_hash(bf, clxns_hash_wy(key, strlen(key), 0)));
+    }
+
+    MU_ASSERT("Existing key not in filter", bloom_filter_test(bf, "before"));
+    int rejected = 0;
+    void *value;
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(key, sizeof(key), "key%d", i);
+        uint64_t hash_val = hash_table_hash(ht, key);
+        C_STATUS st = hash_table_get_prehashed(ht, key, hash_val, &value);
+        MU_ASSERT("Wrong status with filter", i < 100 ? st == C_OK : st == CE_MISSING && value == 0);
+        rejected += i >= 100 && !bloom_filter_test_hash(bf, hash_val);
+    }
+
+    MU_ASSERT("Filter rejected too few missing keys", rejected > 850);
+    MU_ASSERT("Wrong status removing with filter",
+              hash_table_remove_prehashed(ht, "key5", hash_table_hash(ht, "key5"), 1) == C_OK);
+    MU_ASSERT("Wrong status removing missing key",
+              hash_table_remove_prehashed(ht, "never", hash_table_hash(ht, "never"), 0) == CE_MISSING);
+
+    hash_table_remove(ht, "before", 0);
+    clxns_free(ht, 1);
+    clxns_free(bf, 0);
+    return 0;
+}
+
+/*
+ * A reserved table keeps its capacity as items are removed, but still shrinks to it
+ */
+char *ht_reserve_floor()
+{
+    void *ht = hash_table(0);
+    hash_table_reserve(ht, 1000);
+
+    ht_stats stats;
+    hash_table_stats(ht, &stats);
+    size_t reserved = stats.capacity;
+    MU_ASSERT("Reserve should grow the table", reserved >= 2000);
+
+    char k[32];
+    for (int i = 0; i < 10000; i++)
+    {
+        snprintf(k, sizeof(k), "string%d", i);
+        hash_table_add(ht, strdup(k), 0);
+    }
+
+    hash_table_stats(ht, &stats);
+    MU_ASSERT("Table should grow past the reservation", stats.capacity > reserved);
+
+    for (int i = 0; i < 9990; i++)
+    {
+        snprintf(k, sizeof(k), "string%d", i);
+        hash_table_remove(ht, k, 1);
+    }
+
+    hash_table_stats(ht, &stats);
+    MU_ASSERT("Table should shrink back to the reservation", stats.capacity == reserved);
+
+    hash_table_remove(ht, "string9990", 1);
+    hash_table_stats(ht, &stats);
+    MU_ASSERT("Table shrank below the reservation", stats.capacity == reserved && stats.count == 9);
+    clxns_free(ht, 1);
+
+    // A power of two table rounds the reservation up and must not resize on every remove
+    ht = hash_table(0);
+    hash_table_set_flags(ht, HT_POW2);
+    hash_table_reserve(ht, 1000);
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(k, sizeof(k), "string%d", i);
+        hash_table_add(ht, strdup(k), 0);
+    }
+
+    hash_table_stats(ht, &stats);
+    size_t resizes = stats.resizes;
+    for (int i = 0; i < 90; i++)
+    {
+        snprintf(k, sizeof(k), "string%d", i);
+        hash_table_remove(ht, k, 1);
+    }
+
+    hash_table_stats(ht, &stats);
+    MU_ASSERT("Reserved power of two table resized", stats.resizes == resizes && stats.capacity >= 2000);
+
+    clxns_free(ht, 1);
+    return 0;
+}
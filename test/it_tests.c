@@ -0,0 +1,176 @@
+/*
+ * Unit tests for the int table
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "minunit.h"
+#include "../src/collections.h"
+
+/*
+ * Populate an int table with keys 0 to num - 1, each value points to a copy of its key
+ */
+static void *populate(int init, int num)
+{
+    void *it = int_table(init);
+    for (int i = 0; i < num; i++)
+    {
+        uint64_t *v = malloc(sizeof(uint64_t));
+        *v = i;
+        int_table_add(it, i, v);
+    }
+
+    return it;
+}
+
+/*
+ * Add, replace and look up items, including the zero key
+ */
+char *it_add_get()
+{
+    int num = 1000;
+    void *it = populate(0, num);
+    MU_ASSERT("Wrong number of items after populate", clxns_count(it) == (size_t)num);
+
+    uint64_t *value;
+    for (int i = 0; i < num; i++)
+    {
+        C_STATUS st = int_table_get(it, i, (void*)&value);
+        MU_ASSERT("Wrong status after loop get", st == C_OK);
+        MU_ASSERT("Wrong value after loop get", *value == (uint64_t)i);
+    }
+
+    C_STATUS st = int_table_get(it, num, (void*)&value);
+    MU_ASSERT("Wrong status for missing key", st == CE_MISSING && value == 0);
+
+    // Replace does not change the count
+    uint64_t big = UINT64_MAX;
+    st = int_table_get(it, 7, (void*)&value);
+    free(value);
+    int_table_add(it, 7, &big);
+    st = int_table_get(it, 7, (void*)&value);
+    MU_ASSERT("Wrong value after replace", st == C_OK && value == &big);
+    MU_ASSERT("Wrong number of items after replace", clxns_count(it) == (size_t)num);
+    int_table_remove(it, 7, 0);
+
+    clxns_free(it, 1);
+    return 0;
+}
+
+/*
+ * Remove items. Remaining keys must still be found after the backward shifts.
+ */
+char *it_remove()
+{
+    int num = 1000;
+    void *it = populate(0, num);
+
+    uint64_t *value;
+    for (int i = 0; i < num; i += 3)
+    {
+        C_STATUS st = int_table_remove(it, i, 1);
+        MU_ASSERT("Wrong status after remove", st == C_OK);
+        st = int_table_remove(it, i, 1);
+        MU_ASSERT("Wrong status after second remove", st == CE_MISSING);
+    }
+
+    for (int i = 0; i < num; i++)
+    {
+        C_STATUS st = int_table_get(it, i, (void*)&value);
+        MU_ASSERT("Wrong status after remove get", (i % 3 == 0) == (st == CE_MISSING));
+    }
+
+    MU_ASSERT("Wrong count after remove", clxns_count(it) == (size_t)(num - 334));
+
+    for (int i = 0; i < num; i++)
+    {
+        int_table_remove(it, i, 1);
+    }
+
+    MU_ASSERT("Table should be empty", clxns_count(it) == 0);
+    clxns_free(it, 1);
+    return 0;
+}
+
+/*
+ * Iterate over every item in the table and copy it
+ */
+char *it_iterate_copy()
+{
+    int num = 200;
+    void *it = populate(0, num);
+    void *copy = clxns_copy(it);
+    int_table_remove(it, 0, 0);
+
+    uint64_t total = 0;
+    int count = 0;
+    void *iter = clxns_iter_new(copy);
+    while (clxns_iter_move_next(iter))
+    {
+        ikvp *kv = clxns_iter_get_next(iter);
+        MU_ASSERT("Key and value do not match", kv->key == *(uint64_t*)kv->value);
+        total += kv->key;
+        count++;
+    }
+
+    clxns_iter_free(iter);
+    MU_ASSERT("Wrong iter count", count == num);
+    MU_ASSERT("Wrong key total", total == (uint64_t)num * (num - 1) / 2);
+    MU_ASSERT("Copy should not be changed by original", clxns_count(copy) == (size_t)num);
+
+    clxns_free(it, 0);
+    clxns_free(copy, 1);
+    return 0;
+}
+
+/*
+ * Returns the bytes of a uint64_t value
+ */
+static const void *encode_u64(const void *item, size_t *len, void *ctx)
+{
+    (void)ctx;
+    *len = sizeof(uint64_t);
+    return item;
+}
+
+/*
+ * Makes a new uint64_t value from its bytes
+ */
+static void *decode_u64(const void *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    uint64_t *rv = malloc(len);
+    memcpy(rv, data, len);
+    return rv;
+}
+
+/*
+ * Write a table to a stream, including the zero key, and read it back
+ */
+char *it_serialize()
+{
+    clxns_codec codec = { encode_u64, decode_u64, 0 };
+    void *it = populate(0, 1000);
+    FILE *fp = tmpfile();
+    C_STATUS st = clxns_serialize(it, fp, &codec);
+    MU_ASSERT("Wrong status after serialize", st == C_OK);
+
+    rewind(fp);
+    void *restored = int_table(0);
+    st = clxns_deserialize(restored, fp, &codec);
+    fclose(fp);
+    MU_ASSERT("Wrong status after deserialize", st == C_OK);
+    MU_ASSERT("Wrong count after deserialize", clxns_count(restored) == 1000);
+
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        uint64_t *value;
+        st = int_table_get(restored, i, (void*)&value);
+        MU_ASSERT("Wrong value after deserialize", st == C_OK && *value == i);
+    }
+
+    clxns_free(restored, 1);
+    clxns_free(it, 1);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * Unit tests for the LRU cache
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "minunit.h"
+#include "../src/collections.h"
+
+// Records the keys passed to the eviction callback
+typedef struct _evictions
+{
+    char keys[16][16];
+    int count;
+} evictions;
+
+/*
+ * Eviction callback which records the key
+ */
+static void record_evict(char *key, void *value, void *ctx)
+{
+    evictions *ev = ctx;
+    (void)value;
+    strcpy(ev->keys[ev->count++ % 16], key);
+}
+
+/*
+ * Least recently used entries are evicted first, gets and puts count as a use
+ */
+char *lc_lru_evict()
+{
+    evictions ev = { .count = 0 };
+    void *lc = lru_cache(3, CACHE_LRU);
+    lru_cache_set_evict(lc, record_evict, &ev);
+
+    lru_cache_put(lc, "a", "1");
+    lru_cache_put(lc, "b", "2");
+    lru_cache_put(lc, "c", "3");
+    MU_ASSERT("Nothing should be evicted yet", ev.count == 0 && clxns_count(lc) == 3);
+
+    char *value;
+    lru_cache_get(lc, "a", (void*)&value);
+    lru_cache_put(lc, "d", "4");
+    MU_ASSERT("Least recently used not evicted", ev.count == 1 && !strcmp(ev.keys[0], "b"));
+
+    lru_cache_put(lc, "c", "30");
+    lru_cache_put(lc, "e", "5");
+    MU_ASSERT("Wrong second eviction", ev.count == 2 && !strcmp(ev.keys[1], "a"));
+
+    C_STATUS st = lru_cache_get(lc, "b", (void*)&value);
+    MU_ASSERT("Evicted key still found", st == CE_MISSING && value == 0);
+    st = lru_cache_get(lc, "c", (void*)&value);
+    MU_ASSERT("Wrong replaced value", st == C_OK && !strcmp(value, "30"));
+
+    // Iterates from the next to be evicted
+    const char *order[] = { "d", "e", "c" };
+    int i = 0;
+    void *iter = clxns_iter_new(lc);
+    while (clxns_iter_move_next(iter))
+    {
+        kvp *kv = clxns_iter_get_next(iter);
+        MU_ASSERT("Wrong iteration order", i < 3 && !strcmp(kv->key, order[i]));
+        i++;
+    }
+
+    clxns_iter_free(iter);
+    MU_ASSERT("Wrong iteration count", i == 3);
+
+    void *copy = clxns_copy(lc);
+    lru_cache_put(copy, "f", "6");
+    MU_ASSERT("Copy evicted wrong key", ev.count == 3 && !strcmp(ev.keys[2], "d"));
+    clxns_free(copy, 0);
+
+    st = lru_cache_remove(lc, "e", 0);
+    MU_ASSERT("Wrong status for remove", st == C_OK && clxns_count(lc) == 2 && ev.count == 3);
+    st = lru_cache_remove(lc, "e", 0);
+    MU_ASSERT("Wrong status removing missing key", st == CE_MISSING);
+
+    clxns_free(lc, 0);
+    return 0;
+}
+
+/*
+ * CLOCK gives recently read entries a second chance, and sizes can count bytes
+ */
+char *lc_clock_sized()
+{
+    evictions ev = { .count = 0 };
+    void *lc = lru_cache(3, CACHE_CLOCK);
+    lru_cache_set_evict(lc, record_evict, &ev);
+
+    lru_cache_put(lc, "a", "1");
+    lru_cache_put(lc, "b", "2");
+    lru_cache_put(lc, "c", "3");
+
+    char *value;
+    lru_cache_get(lc, "a", (void*)&value);
+    lru_cache_put(lc, "d", "4");
+    MU_ASSERT("Referenced entry evicted", ev.count == 1 && !strcmp(ev.keys[0], "b"));
+    lru_cache_put(lc, "e", "5");
+    MU_ASSERT("Wrong second eviction", ev.count == 2 && !strcmp(ev.keys[1], "c"));
+    lru_cache_put(lc, "f", "6");
+    MU_ASSERT("Wrong third eviction", ev.count == 3 && !strcmp(ev.keys[2], "d"));
+    lru_cache_put(lc, "g", "7");
+    MU_ASSERT("Second chance should be used up", ev.count == 4 && !strcmp(ev.keys[3], "a"));
+    clxns_free(lc, 0);
+
+    // Capacity in bytes, a large entry pushes out several small ones
+    ev.count = 0;
+    lc = lru_cache(100, CACHE_LRU);
+    lru_cache_set_evict(lc, record_evict, &ev);
+    char keys[10][16];
+    for (int i = 0; i < 10; i++)
+    {
+        sprintf(keys[i], "small%d", i);
+        lru_cache_put_sized(lc, keys[i], 0, 10);
+    }
+
+    MU_ASSERT("Small entries should all fit", ev.count == 0 && clxns_count(lc) == 10);
+    lru_cache_put_sized(lc, "large", 0, 35);
+    MU_ASSERT("Wrong evictions for large entry", ev.count == 4 && clxns_count(lc) == 7);
+    MU_ASSERT("Oldest small entry not evicted first", !strcmp(ev.keys[0], "small0"));
+    lru_cache_put_sized(lc, "huge", 0, 500);
+    MU_ASSERT("Entry larger than capacity not kept", clxns_count(lc) == 1 && ev.count == 11);
+
+    clxns_free(lc, 0);
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Unit tests for the memory mapped table
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "minunit.h"
+#include "../src/collections.h"
+
+/*
+ * Creates an empty temporary file and returns its path
+ */
+static char *temp_path(char *path)
+{
+    strcpy(path, "/tmp/mt_testXXXXXX");
+    close(mkstemp(path));
+    return path;
+}
+
+/*
+ * Write a hash table of string values and binary keys, then open and query it
+ */
+char *mt_write_open()
+{
+    int num = 500;
+    void *ht = hash_table(0);
+    for (int i = 0; i < num; i++)
+    {
+        char *k = malloc(24);
+        snprintf(k, 24, "key%d", i);
+        hash_table_add(ht, k, strdup(k));
+    }
+
+    char zeros[3] = { 0, 0, 0 };
+    hash_table_add_bin(ht, zeros, 3, "zeros");
+    hash_table_add(ht, "nothing", 0);
+    hash_table_add(ht, "eight ch", "8");
+    hash_table_add(ht, "sixteen chars ok", "16");
+
+    char path[32];
+    C_STATUS st = mapped_table_write(ht, temp_path(path), 0);
+    MU_ASSERT("Wrong status writing mapped table", st == C_OK);
+
+    void *mt = mapped_table(path);
+    MU_ASSERT("Mapped table did not open", mt != 0);
+    MU_ASSERT("Wrong count for mapped table", clxns_count(mt) == (size_t)num + 4);
+
+    char key[16];
+    char *value;
+    for (int i = 0; i < num; i++)
+    {
+        sprintf(key, "key%d", i);
+        st = mapped_table_get(mt, key, (void*)&value);
+        MU_ASSERT("Wrong value from mapped table", st == C_OK && !strcmp(key, value));
+    }
+
+    st = mapped_table_get(mt, "key500", (void*)&value);
+    MU_ASSERT("Wrong status for missing key", st == CE_MISSING && value == 0);
+    st = mapped_table_get_bin(mt, zeros, 3, (void*)&value);
+    MU_ASSERT("Wrong value for binary key", st == C_OK && !strcmp(value, "zeros"));
+    st = mapped_table_get_bin(mt, zeros, 2, (void*)&value);
+    MU_ASSERT("Shorter binary key should be missing", st == CE_MISSING);
+    st = mapped_table_get(mt, "nothing", (void*)&value);
+    MU_ASSERT("Null value not kept", st == C_OK && value == 0);
+
+    size_t count = 0;
+    void *iter = clxns_iter_new(mt);
+    while (clxns_iter_move_next(iter))
+    {
+        kvp *kv = clxns_iter_get_next(iter);
+        void *orig;
+        hash_table_get_bin(ht, kv->key, kv->key_len, &orig);
+        MU_ASSERT("Iterated value does not match", orig == kv->value || !strcmp(orig, kv->value));
+        MU_ASSERT("Iterated key not terminated", kv->key[kv->key_len] == 0);
+        count++;
+    }
+
+    clxns_iter_free(iter);
+    MU_ASSERT("Wrong iter count for mapped table", count == (size_t)num + 4);
+
+    // The copy reads the file in to memory and outlives the file
+    void *copy = clxns_copy(mt);
+    clxns_free(mt, 0);
+    unlink(path);
+    st = mapped_table_get(copy, "key42", (void*)&value);
+    MU_ASSERT("Wrong value from copy", st == C_OK && !strcmp(value, "key42"));
+    clxns_free(copy, 0);
+
+    hash_table_remove_bin(ht, zeros, 3, 0);
+    hash_table_remove(ht, "nothing", 0);
+    hash_table_remove(ht, "eight ch", 0);
+    hash_table_remove(ht, "sixteen chars ok", 0);
+    clxns_free(ht, 1);
+    return 0;
+}
+
+/*
+ * Fixed size values, and files which are not mapped tables
+ */
+char *mt_fixed_values()
+{
+    int values[10];
+    char keys[10][8];
+    void *ot = open_table(0);
+    for (int i = 0; i < 10; i++)
+    {
+        values[i] = i * i;
+        sprintf(keys[i], "n%d", i);
+        open_table_add(ot, keys[i], &values[i]);
+    }
+
+    char path[32];
+    C_STATUS st = mapped_table_write(ot, temp_path(path), sizeof(int));
+    MU_ASSERT("Wrong status writing open table", st == C_OK);
+    clxns_free(ot, 0);
+
+    void *mt = mapped_table(path);
+    int *value;
+    st = mapped_table_get(mt, "n7", (void*)&value);
+    MU_ASSERT("Wrong fixed size value", st == C_OK && *value == 49);
+    clxns_free(mt, 0);
+
+    FILE *fp = fopen(path, "w");
+    fputs("not a mapped table", fp);
+    fclose(fp);
+    MU_ASSERT("Bad file should not open", mapped_table(path) == 0);
+    unlink(path);
+    MU_ASSERT("Missing file should not open", mapped_table(path) == 0);
+
+    void *empty = hash_table(0);
+    st = mapped_table_write(empty, "/no/such/dir/table", 0);
+    MU_ASSERT("Wrong status for unwritable path", st == CE_IO);
+    clxns_free(empty, 0);
+    return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Unit tests for the open addressing hash table
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "minunit.h"
+#include "../src/collections.h"
+
+/*
+ * Populate an open table with some test data
+ */
+static void *populate(int init, int num)
+{
+    char *k, *v;
+    void *ot = open_table(init);
+    for (int i = 0; i < num; i++)
+    {
+        k = (char*)malloc(24);
+        snprintf(k, 24, "string%d", i);
+        v = (char*)malloc(24);
+        snprintf(v, 24, "STRING%d", i);
+        open_table_add(ot, k, v);
+    }
+
+    return ot;
+}
+
+/*
+ * Add items and replace the value of an existing key
+ */
+char *ot_add_replace()
+{
+    void *ot = open_table(0);
+    open_table_add(ot, "AAA", "aaa");
+    open_table_add(ot, "BBB", "bbb");
+    open_table_add(ot, "AAA", "xxx");
+
+    int cnt = clxns_count(ot);
+    MU_ASSERT("Wrong number of items after add", cnt == 2);
+
+    char *value;
+    C_STATUS st = open_table_get(ot, "AAA", (void*)&value);
+    MU_ASSERT("Wrong status after replace get", st == C_OK);
+    MU_ASSERT("Wrong value after replace get", !strcmp("xxx", value));
+
+    st = open_table_get(ot, "BBB", (void*)&value);
+    MU_ASSERT("Wrong status after get", st == C_OK);
+    MU_ASSERT("Wrong value after get", !strcmp("bbb", value));
+
+    clxns_free(ot, 0);
+    return 0;
+}
+
+/*
+ * Lookup items in a table large enough to have been resized several times
+ */
+char *ot_get_items()
+{
+    int num = 1000;
+    void *ot = populate(0, num);
+
+    int cnt = clxns_count(ot);
+    MU_ASSERT("Wrong number of items after populate", cnt == num);
+
+    char *value;
+    C_STATUS st = open_table_get(ot, "string1001", (void*)&value);
+    MU_ASSERT("Wrong status for missing item", st == CE_MISSING);
+    MU_ASSERT("Wrong value for missing item", value == 0);
+
+    char k[24], v[24];
+    for (int i = 0; i < num; i++)
+    {
+        snprintf(k, sizeof(k), "string%d", i);
+        st = open_table_get(ot, k, (void*)&value);
+        MU_ASSERT("Wrong status after loop get", st == C_OK);
+
+        snprintf(v, sizeof(v), "STRING%d", i);
+        MU_ASSERT("Wrong value after loop get", !strcmp(v, value));
+    }
+
+    clxns_free(ot, 1);
+    return 0;
+}
+
+/*
+ * Iterate over every item in the table, each key must be seen exactly once
+ */
+char *ot_iterate()
+{
+    int num_entries = 100;
+    void *ot = populate(0, num_entries);
+
+    int i = 0, idx_tot = 0;
+    void *iter = clxns_iter_new(ot);
+    while (clxns_iter_move_next(iter))
+    {
+        kvp *val = clxns_iter_get_next(iter);
+        int key_idx = atoi(val->key + 6);
+        int val_idx = atoi((char*)val->value + 6);
+        MU_ASSERT("Key and value indexes do not match", key_idx == val_idx);
+
+        idx_tot += val_idx;
+        i++;
+    }
+
+    int expected_idx_tot = num_entries * (num_entries - 1) / 2;
+    MU_ASSERT("Index totals incorrect. Missing or dupe values in table?", idx_tot == expected_idx_tot);
+    MU_ASSERT("Incorrect iter count", i == num_entries);
+    clxns_iter_free(iter);
+
+    // An empty table returns nothing
+    void *empty = open_table(0);
+    iter = clxns_iter_new(empty);
+    MU_ASSERT("Empty table should not iterate", !clxns_iter_move_next(iter));
+    clxns_iter_free(iter);
+
+    clxns_free(empty, 0);
+    clxns_free(ot, 1);
+    return 0;
+}
+
+/*
+ * Remove items from a table. Remaining keys must still be found after the backward shifts.
+ */
+char *ot_remove_items()
+{
+    int num = 500;
+    void *ot = populate(0, num);
+
+    C_STATUS st = open_table_remove(ot, "string501", 0);
+    MU_ASSERT("Wrong status after missing remove", st == CE_MISSING);
+
+    char k[24];
+    char *value;
+    for (int i = 0; i < num; i += 2)
+    {
+        snprintf(k, sizeof(k), "string%d", i);
+        st = open_table_remove(ot, k, 1);
+        MU_ASSERT("Wrong status after loop remove", st == C_OK);
+
+        st = open_table_get(ot, k, (void*)&value);
+        MU_ASSERT("Wrong status after remove get", st == CE_MISSING);
+    }
+
+    int cnt = clxns_count(ot);
+    MU_ASSERT("Wrong number of items after remove", cnt == num / 2);
+
+    for (int i = 1; i < num; i += 2)
+    {
+        snprintf(k, sizeof(k), "string%d", i);
+        st = open_table_get(ot, k, (void*)&value);
+        MU_ASSERT("Remaining item missing after remove", st == C_OK);
+
+        st = open_table_remove(ot, k, 1);
+        MU_ASSERT("Wrong status after second loop remove", st == C_OK);
+    }
+
+    cnt = clxns_count(ot);
+    MU_ASSERT("Table should be empty after remove", cnt == 0);
+
+    clxns_free(ot, 1);
+    return 0;
+}
+
+/*
+ * Copy an open table. The copy must be independent of the original.
+ */
+char *ot_copy()
+{
+    void *ot = open_table(0);
+    open_table_add(ot, "AAA", "aaa");
+    open_table_add(ot, "BBB", "bbb");
+    open_table_add(ot, "XXX", "xxx");
+
+    void *ot2 = clxns_copy(ot);
+    int cnt = clxns_count(ot2);
+    MU_ASSERT("Wrong number of items after copy", cnt == 3);
+
+    open_table_add(ot2, "ZZZ", "zzz");
+    MU_ASSERT("Wrong number of items in copy", clxns_count(ot2) == 4);
+    MU_ASSERT("Wrong number of items in original", clxns_count(ot) == 3);
+
+    char *value;
+    C_STATUS st = open_table_get(ot, "ZZZ", (void*)&value);
+    MU_ASSERT("Wrong status after copy orig get", st == CE_MISSING);
+    st = open_table_get(ot2, "ZZZ", (void*)&value);
+    MU_ASSERT("Wrong status after copy new get", st == C_OK);
+    MU_ASSERT("Wrong value after copy new get", !strcmp("zzz", value));
+    st = open_table_get(ot2, "AAA", (void*)&value);
+    MU_ASSERT("Wrong value after copy get", st == C_OK && !strcmp("aaa", value));
+
+    clxns_free(ot, 0);
+    clxns_free(ot2, 0);
+    return 0;
+}
+
+/*
+ * Use each of the built-in hash functions with a seed, growing and shrinking the table
+ */
+char *ot_seeded()
+{
+    clxns_hash hashes[] = { clxns_hash_djb2, clxns_hash_wy, clxns_hash_sip };
+    for (size_t h = 0; h < sizeof(hashes) / sizeof(hashes[0]); h++)
+    {
+        void *ot = open_table_seeded(0, hashes[h], 0x1234567890abcdefULL);
+        char k[32];
+        for (int i = 0; i < 200; i++)
+        {
+            snprintf(k, sizeof(k), "string%d", i);
+            open_table_add(ot, strdup(k), 0);
+        }
+
+        MU_ASSERT("Wrong count in seeded table", clxns_count(ot) == 200);
+
+        char *value;
+        for (int i = 0; i < 190; i++)
+        {
+            snprintf(k, sizeof(k), "string%d", i);
+            MU_ASSERT("Missing item in seeded table", open_table_get(ot, k, (void*)&value) == C_OK);
+            MU_ASSERT("Wrong status for remove", open_table_remove(ot, k, 1) == C_OK);
+        }
+
+        for (int i = 190; i < 200; i++)
+        {
+            snprintf(k, sizeof(k), "string%d", i);
+            MU_ASSERT("Missing item after shrink", open_table_get(ot, k, (void*)&value) == C_OK);
+        }
+
+        clxns_free(ot, 1);
+    }
+
+    return 0;
+}
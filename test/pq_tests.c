@@ -261,3 +261,41 @@ char *pq_copy_queue()
     clxns_free(pq, 0);
     return 0;
 }
+
+/*
+ * Write a queue to a stream and read it back, the restored queue pops in the same order
+ */
+char *pq_serialize()
+{
+    char *items[] = { "DDD", "AAA", "FFF", "CCC", "EEE", "BBB" };
+    void *pq = priority_queue_max(0, compare);
+    for (int i = 0; i < 6; i++)
+    {
+        priority_queue_add(pq, items[i]);
+    }
+
+    FILE *fp = tmpfile();
+    C_STATUS st = clxns_serialize(pq, fp, &clxns_string_codec);
+    MU_ASSERT("Wrong status after serialize", st == C_OK);
+
+    rewind(fp);
+    void *restored = priority_queue_max(0, compare);
+    st = clxns_deserialize(restored, fp, &clxns_string_codec);
+    fclose(fp);
+    MU_ASSERT("Wrong status after deserialize", st == C_OK);
+    MU_ASSERT("Wrong count after deserialize", clxns_count(restored) == 6);
+
+    char *expect;
+    char *item;
+    while (priority_queue_pop(pq, (void*)&expect) == C_OK)
+    {
+        st = priority_queue_pop(restored, (void*)&item);
+        MU_ASSERT("Wrong item order after deserialize", st == C_OK && !strcmp(item, expect));
+        free(item);
+    }
+
+    MU_ASSERT("Items left after deserialize", clxns_count(restored) == 0);
+    clxns_free(restored, 0);
+    clxns_free(pq, 0);
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include "../src/collections.h"
 #include "minunit.h"
 
@@ -17,8 +18,8 @@ static void *populate(int init, int num)
     void *array = resize_array(init);
     for (int i = 0; i < num; i++)
     {
-        buf = (char*)malloc(9);
-        sprintf(buf, "string%d", i);
+        buf = (char*)malloc(24);
+        snprintf(buf, 24, "string%d", i);
         resize_array_add(array, buf);
     }
 
@@ -37,12 +38,12 @@ char *ra_add()
     MU_ASSERT("Wrong number of items in array", s == num_entries);
 
     char *res;
-    char buf[8];
+    char buf[24];
     for (int i = 0; i < num_entries; i++)
     {
         C_STATUS err = resize_array_get(array, i, (void**)&res);
         MU_ASSERT("Non-zero error code on get", err == C_OK);
-        sprintf(buf, "string%d", i);
+        snprintf(buf, sizeof(buf), "string%d", i);
         MU_ASSERT("Incorrect data", strcmp(res, buf) == 0);
     }
 
@@ -61,13 +62,13 @@ char *ra_add_adjust()
     int s = clxns_count(array);
     MU_ASSERT("Wrong number of items in array", s == num_entries);
 
-    char buf[9];
+    char buf[24];
     int i = 0;
     void *iter = clxns_iter_new(array);
     while (clxns_iter_move_next(iter))
     {
         char *res = clxns_iter_get_next(iter);
-        sprintf(buf, "string%d", i++);
+        snprintf(buf, sizeof(buf), "string%d", i++);
         MU_ASSERT("Incorrect data in iter", strcmp(res, buf) == 0);
     }
 
@@ -255,13 +256,13 @@ char *ra_insert()
     int s = clxns_count(array);
     MU_ASSERT("Wrong number of items in array after insert", s == 10);
 
-    char buf[16];
+    char buf[24];
     int i = 0;
     void *iter = clxns_iter_new(array);
     while (clxns_iter_move_next(iter))
     {
         char *res = clxns_iter_get_next(iter);
-        sprintf(buf, "string%d", i++);
+        snprintf(buf, sizeof(buf), "string%d", i++);
         MU_ASSERT("Incorrect data in iter after insert", !strcmp(res, buf));
     }
 
@@ -294,13 +295,13 @@ char *ra_replace()
     int s = clxns_count(array);
     MU_ASSERT("Wrong number of items in array after replace", s == 6);
 
-    char buf[8];
+    char buf[24];
     int i = 0;
     void *iter = clxns_iter_new(array);
     while (clxns_iter_move_next(iter))
     {
         char *res = clxns_iter_get_next(iter);
-        sprintf(buf, "string%d", i++);
+        snprintf(buf, sizeof(buf), "string%d", i++);
         MU_ASSERT("Incorrect data in iter after replace", !strcmp(res, buf));
     }
 
@@ -310,3 +311,590 @@ char *ra_replace()
     clxns_free(array, 0);
     return 0;
 }
+
+/*
+ * Write an array to a stream and read it back in to a new array
+ */
+char *ra_serialize()
+{
+    void *array = populate(0, 100);
+    resize_array_add(array, 0);
+    FILE *fp = tmpfile();
+    C_STATUS st = clxns_serialize(array, fp, &clxns_string_codec);
+    MU_ASSERT("Wrong status after serialize", st == C_OK);
+
+    rewind(fp);
+    void *restored = resize_array(0);
+    st = clxns_deserialize(restored, fp, &clxns_string_codec);
+    MU_ASSERT("Wrong status after deserialize", st == C_OK);
+    MU_ASSERT("Wrong count after deserialize", clxns_count(restored) == 101);
+
+    for (size_t i = 0; i < 100; i++)
+    {
+        char *orig;
+        char *item;
+        resize_array_get(array, i, (void*)&orig);
+        resize_array_get(restored, i, (void*)&item);
+        MU_ASSERT("Wrong item after deserialize", item != orig && !strcmp(item, orig));
+    }
+
+    void *item;
+    resize_array_get(restored, 100, &item);
+    MU_ASSERT("Null item not kept", item == 0);
+
+    fclose(fp);
+
+    // A stream which ends early or is not a collection fails
+    fp = tmpfile();
+    fputs("CLX1", fp);
+    fputc(5, fp);
+    rewind(fp);
+    void *partial = resize_array(0);
+    st = clxns_deserialize(partial, fp, &clxns_string_codec);
+    MU_ASSERT("Wrong status for truncated stream", st == CE_IO && clxns_count(partial) == 0);
+
+    rewind(fp);
+    fputs("XXXX", fp);
+    rewind(fp);
+    st = clxns_deserialize(partial, fp, &clxns_string_codec);
+    MU_ASSERT("Wrong status for bad stream", st == CE_IO);
+    fclose(fp);
+
+    clxns_free(partial, 1);
+    clxns_free(restored, 1);
+    clxns_free(array, 1);
+    return 0;
+}
+
+/*
+ * Streams with a huge count or item length fail to read, without sizing the array from them
+ */
+char *ra_serialize_corrupt()
+{
+    static const unsigned char huge_count[] =
+    {
+        'C', 'L', 'X', '1', 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f, 0x02, 'a'
+    };
+    static const unsigned char huge_len[] =
+    {
+        'C', 'L', 'X', '1', 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f, 'a'
+    };
+    const unsigned char *streams[] = { huge_count, huge_len };
+
+    for (int s = 0; s < 2; s++)
+    {
+        FILE *fp = tmpfile();
+        fwrite(streams[s], 1, sizeof(huge_count), fp);
+        rewind(fp);
+
+        void *restored = resize_array(0);
+        MU_ASSERT("Corrupt stream read", clxns_deserialize(restored, fp, &clxns_string_codec) == CE_IO);
+        clxns_free(restored, 1);
+        fclose(fp);
+    }
+
+    return 0;
+}
+
+/*
+ * A value array is written as its element bytes and read back in to another value array
+ */
+char *ra_serialize_values()
+{
+    size_t num = 10000;
+    void *array = resize_array_of(sizeof(double), 0);
+    for (size_t i = 0; i < num; i++)
+    {
+        double d = i * 0.5;
+        resize_array_add_value(array, &d);
+    }
+
+    FILE *fp = tmpfile();
+    MU_ASSERT("Wrong status after serialize", clxns_serialize(array, fp, 0) == C_OK);
+
+    rewind(fp);
+    void *restored = resize_array_of(sizeof(double), 0);
+    MU_ASSERT("Wrong status after deserialize", clxns_deserialize(restored, fp, 0) == C_OK);
+    MU_ASSERT("Wrong count after deserialize", clxns_count(restored) == num);
+    for (size_t i = 0; i < num; i++)
+    {
+        MU_ASSERT("Wrong element after deserialize", *(double*)resize_array_at(restored, i) == i * 0.5);
+    }
+
+    rewind(fp);
+    void *wrong = resize_array_of(sizeof(float), 0);
+    MU_ASSERT("Read in to wrong element size", clxns_deserialize(wrong, fp, 0) == CE_IO);
+
+    fclose(fp);
+    clxns_free(wrong, 0);
+    clxns_free(restored, 0);
+    clxns_free(array, 0);
+    return 0;
+}
+
+/*
+ * Insert and remove ranges of items, including ranges that make the array grow and shrink
+ */
+char *ra_ranges()
+{
+    void *array = resize_array(0);
+    char *items[40];
+    for (int i = 0; i < 40; i++)
+    {
+        items[i] = malloc(24);
+        snprintf(items[i], 24, "string%d", i);
+    }
+
+    // Build 0..39 from pieces inserted at the end, the start and the middle
+    resize_array_insert_range(array, 0, (void**)&items[30], 10);
+    resize_array_insert_range(array, 0, (void**)&items[0], 10);
+    resize_array_insert_range(array, 10, (void**)&items[10], 20);
+    MU_ASSERT("Wrong count after insert range", clxns_count(array) == 40);
+
+    char *res;
+    for (size_t i = 0; i < 40; i++)
+    {
+        resize_array_get(array, i, (void**)&res);
+        MU_ASSERT("Wrong item after insert range", res == items[i]);
+    }
+
+    C_STATUS st = resize_array_insert_range(array, 41, (void**)items, 1);
+    MU_ASSERT("Insert range past the end should fail", st == CE_BOUNDS);
+
+    char *removed[35];
+    st = resize_array_remove_range(array, 3, 35, (void**)removed);
+    MU_ASSERT("Wrong status for remove range", st == C_OK && clxns_count(array) == 5);
+    MU_ASSERT("Wrong items removed", removed[0] == items[3] && removed[34] == items[37]);
+    resize_array_get(array, 3, (void**)&res);
+    MU_ASSERT("Wrong item after remove range", res == items[38]);
+
+    st = resize_array_remove_range(array, 3, 3, 0);
+    MU_ASSERT("Remove range past the end should fail", st == CE_BOUNDS && clxns_count(array) == 5);
+    st = resize_array_remove_range(array, 5, 0, 0);
+    MU_ASSERT("Empty range at the end should be removed", st == C_OK);
+
+    resize_array_remove_range(array, 0, 5, 0);
+    MU_ASSERT("Array should be empty", clxns_count(array) == 0);
+
+    for (int i = 0; i < 40; i++)
+    {
+        free(items[i]);
+    }
+
+    clxns_free(array, 0);
+    return 0;
+}
+
+/*
+ * Extend an array from a C array, from another collection and from itself
+ */
+char *ra_extend()
+{
+    void *array = populate(0, 3);
+    char *more[] = { "more0", "more1" };
+    resize_array_extend(array, (void**)more, 2);
+    MU_ASSERT("Wrong count after extend", clxns_count(array) == 5);
+
+    void *pq = priority_queue_min(0, (int (*)(const void*, const void*))strcmp);
+    priority_queue_add(pq, "queued");
+    void *other = resize_array(0);
+    resize_array_extend_collection(other, array);
+    resize_array_extend_collection(other, pq);
+    resize_array_extend_collection(other, other);
+    MU_ASSERT("Wrong count after extend from collections", clxns_count(other) == 12);
+
+    char *res;
+    resize_array_get(other, 4, (void**)&res);
+    MU_ASSERT("Wrong item from C array", !strcmp(res, "more1"));
+    resize_array_get(other, 5, (void**)&res);
+    MU_ASSERT("Wrong item from queue", !strcmp(res, "queued"));
+    resize_array_get(other, 11, (void**)&res);
+    MU_ASSERT("Wrong item from self", !strcmp(res, "queued"));
+
+    resize_array_remove_range(array, 3, 2, 0);
+    clxns_free(other, 0);
+    clxns_free(pq, 0);
+    clxns_free(array, 1);
+    return 0;
+}
+
+/*
+ * Growth policy, reserve and shrink to fit
+ */
+char *ra_growth_policy()
+{
+    void *array = resize_array(4);
+    for (size_t i = 0; i < 5; i++)
+    {
+        resize_array_add(array, (void*)i);
+    }
+
+    MU_ASSERT("Default policy should double", resize_array_capacity(array) == 8);
+
+    resize_array_reserve(array, 100);
+    MU_ASSERT("Reserve should grow capacity", resize_array_capacity(array) == 100);
+    resize_array_reserve(array, 50);
+    MU_ASSERT("Reserve should not shrink", resize_array_capacity(array) == 100);
+    for (size_t i = 5; i < 100; i++)
+    {
+        resize_array_add(array, (void*)i);
+    }
+
+    MU_ASSERT("Reserved array should not grow", resize_array_capacity(array) == 100);
+
+    // A quarter full halves the capacity rather than quartering it
+    resize_array_remove_range(array, 25, 75, 0);
+    MU_ASSERT("Wrong capacity after shrink", resize_array_capacity(array) == 50);
+    resize_array_add(array, (void*)25);
+    resize_array_remove(array, 25, 0);
+    MU_ASSERT("Should not resize around the threshold", resize_array_capacity(array) == 50);
+
+    resize_array_shrink_to_fit(array);
+    MU_ASSERT("Wrong capacity after shrink to fit", resize_array_capacity(array) == 25);
+
+    ra_policy bad[] =
+    {
+        { 1.0, 0.25, 0.5, 0 }, { 2.0, -0.1, 0.5, 0 }, { 2.0, 0.25, 0.25, 0 },
+        { 2.0, 0.25, 2.0, 0 }, { 2.0, 0, 0, 0 }, { 0.0 / 0.0, 0.25, 0.5, 0 }
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        MU_ASSERT("Bad policy accepted", resize_array_set_policy(array, &bad[i]) == CE_BOUNDS);
+    }
+
+    ra_policy pol = { 1.5, 0.5, 0.75, 0 };
+    MU_ASSERT("Good policy rejected", resize_array_set_policy(array, &pol) == C_OK);
+    resize_array_add(array, (void*)25);
+    MU_ASSERT("Wrong capacity for growth factor", resize_array_capacity(array) == 37);
+
+    void *copy = clxns_copy(array);
+    pol.no_shrink = 1;
+    resize_array_set_policy(array, &pol);
+    resize_array_remove_range(array, 0, 26, 0);
+    MU_ASSERT("No shrink policy should keep capacity", resize_array_capacity(array) == 37);
+
+    resize_array_remove_range(copy, 0, 20, 0);
+    MU_ASSERT("Copy should keep the policy", resize_array_capacity(copy) == 8);
+
+    resize_array_shrink_to_fit(array);
+    MU_ASSERT("Empty array should keep one slot", resize_array_capacity(array) == 1);
+    resize_array_add(array, 0);
+    resize_array_add(array, 0);
+    MU_ASSERT("Wrong count after growing from one", clxns_count(array) == 2);
+
+    // A growth factor too large for size_t grows to just what is needed
+    ra_policy huge = { 1e300, 0.25, 0.5, 0 };
+    resize_array_set_policy(copy, &huge);
+    resize_array_reserve(copy, 8);
+    for (size_t i = 0; i < 10; i++)
+    {
+        resize_array_add(copy, 0);
+    }
+
+    MU_ASSERT("Wrong capacity for huge growth factor", resize_array_capacity(copy) == 16);
+
+    clxns_free(copy, 0);
+    clxns_free(array, 0);
+    return 0;
+}
+
+// An element held by value in a value array
+typedef struct _point
+{
+    int x;
+    double y;
+} point;
+
+/*
+ * Elements of a value array are copied in and out, and can be reached through the iterator
+ */
+char *ra_values()
+{
+    void *array = resize_array_of(sizeof(point), 0);
+    for (int i = 0; i < 20; i++)
+    {
+        point p = { i, i * 0.5 };
+        resize_array_add_value(array, &p);
+    }
+
+    MU_ASSERT("Wrong count after add", clxns_count(array) == 20);
+    point p;
+    C_STATUS st = resize_array_get_value(array, 7, &p);
+    MU_ASSERT("Wrong element from get", st == C_OK && p.x == 7 && p.y == 3.5);
+    st = resize_array_get_value(array, 20, &p);
+    MU_ASSERT("Get past the end should fail", st == CE_BOUNDS);
+
+    point *at = resize_array_at(array, 3);
+    at->x = 300;
+    MU_ASSERT("Update through pointer lost", resize_array_get_value(array, 3, &p) == C_OK && p.x == 300);
+    MU_ASSERT("Pointer past the end should be null", resize_array_at(array, 20) == 0);
+
+    point q = { -1, -1 };
+    resize_array_insert_value(array, 0, &q);
+    resize_array_put_value(array, 1, &q);
+    st = resize_array_put_value(array, 21, &q);
+    MU_ASSERT("Put past the end should fail", st == CE_BOUNDS);
+    st = resize_array_remove_value(array, 2, &p);
+    MU_ASSERT("Wrong element removed", st == C_OK && p.x == 1 && clxns_count(array) == 20);
+
+    void *copy = clxns_copy(array);
+    resize_array_remove_value(array, 0, 0);
+
+    int i = 0;
+    int sum = 0;
+    void *iter = clxns_iter_new(copy);
+    while (clxns_iter_move_next(iter))
+    {
+        point *next = clxns_iter_get_next(iter);
+        sum += next->x;
+        i++;
+    }
+
+    clxns_iter_free(iter);
+    MU_ASSERT("Wrong iteration count", i == 20);
+    MU_ASSERT("Wrong elements in copy", sum == -1 - 1 + 2 + 300 + 184);
+    MU_ASSERT("Copy changed by original", clxns_count(copy) == 20 && clxns_count(array) == 19);
+
+    MU_ASSERT("Zero element size should fail", resize_array_of(0, 0) == 0);
+    clxns_free(copy, 1);
+    clxns_free(array, 0);
+    return 0;
+}
+
+/*
+ * Functions taking item pointers refuse value arrays rather than writing pointers in to the
+ * elements, and exchange swaps whole elements
+ */
+char *ra_values_guarded()
+{
+    // larger than the chunk elements are swapped in
+    typedef struct { int id; char pad[100]; } big;
+    void *array = resize_array_of(sizeof(big), 0);
+    for (int i = 0; i < 3; i++)
+    {
+        big b = { i, { 0 } };
+        memset(b.pad, 'a' + i, sizeof(b.pad));
+        resize_array_add_value(array, &b);
+    }
+
+    void *item = 0;
+    void *items[2] = { 0, 0 };
+    MU_ASSERT("Add took a value array", resize_array_add(array, &item) == CE_BY_VALUE);
+    MU_ASSERT("Insert took a value array", resize_array_insert(array, 0, &item) == CE_BY_VALUE);
+    MU_ASSERT("Replace took a value array", resize_array_replace(array, 0, &item) == CE_BY_VALUE);
+    MU_ASSERT("Get took a value array", resize_array_get(array, 0, &item) == CE_BY_VALUE);
+    MU_ASSERT("Remove took a value array", resize_array_remove(array, 0, &item) == CE_BY_VALUE);
+    MU_ASSERT("Insert range took a value array", resize_array_insert_range(array, 0, items, 2) == CE_BY_VALUE);
+    MU_ASSERT("Remove range took a value array", resize_array_remove_range(array, 0, 2, items) == CE_BY_VALUE);
+    MU_ASSERT("Extend took a value array", resize_array_extend(array, items, 2) == CE_BY_VALUE);
+    MU_ASSERT("Extend collection took a value array", resize_array_extend_collection(array, array) == CE_BY_VALUE);
+    MU_ASSERT("Value array changed", clxns_count(array) == 3);
+
+    MU_ASSERT("Wrong status for exchange", resize_array_exchange(array, 0, 2) == C_OK);
+    big *first = resize_array_at(array, 0);
+    big *last = resize_array_at(array, 2);
+    MU_ASSERT("Element not exchanged", first->id == 2 && first->pad[99] == 'c');
+    MU_ASSERT("Element not exchanged", last->id == 0 && last->pad[99] == 'a');
+
+    clxns_free(array, 0);
+    return 0;
+}
+
+/*
+ * Compares items which are integers cast to pointers
+ */
+static int compare_ints(const void *first, const void *second)
+{
+    intptr_t a = (intptr_t)first;
+    intptr_t b = (intptr_t)second;
+    return (a > b) - (a < b);
+}
+
+/*
+ * Compares the ints pointed to by the items
+ */
+static int compare_values(const void *first, const void *second)
+{
+    return compare_ints((void*)(intptr_t)*(const int*)first, (void*)(intptr_t)*(const int*)second);
+}
+
+/*
+ * Checks that an array of integer items is in order
+ */
+static int is_sorted(const void *array)
+{
+    void *prev;
+    void *next;
+    for (size_t i = 1; i < clxns_count(array); i++)
+    {
+        resize_array_get(array, i - 1, &prev);
+        resize_array_get(array, i, &next);
+        if (compare_ints(prev, next) > 0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Sort random, ordered, reversed and repeated items on one thread and on several
+ */
+char *ra_sort()
+{
+    const size_t num = 50000;
+    void *array = resize_array(num);
+    srand(7);
+    for (size_t i = 0; i < num; i++)
+    {
+        resize_array_add(array, (void*)(intptr_t)(rand() % 100000));
+    }
+
+    void *copy = clxns_copy(array);
+    resize_array_sort(array, compare_ints);
+    MU_ASSERT("Random items not sorted", is_sorted(array) && clxns_count(array) == num);
+    resize_array_sort_parallel(copy, compare_ints, 3);
+    MU_ASSERT("Random items not sorted in parallel", is_sorted(copy) && clxns_count(copy) == num);
+
+    void *a;
+    void *b;
+    for (size_t i = 0; i < num; i++)
+    {
+        resize_array_get(array, i, &a);
+        resize_array_get(copy, i, &b);
+        MU_ASSERT("Sorts gave different items", a == b);
+    }
+
+    resize_array_sort(array, compare_ints);
+    MU_ASSERT("Sorted items not sorted", is_sorted(array));
+
+    for (size_t i = 0; i < num; i++)
+    {
+        resize_array_replace(array, i, (void*)(intptr_t)(num - i));
+        resize_array_replace(copy, i, (void*)(intptr_t)(i % 3));
+    }
+
+    resize_array_sort(array, compare_ints);
+    MU_ASSERT("Reversed items not sorted", is_sorted(array));
+    resize_array_sort_parallel(array, compare_ints, 4);
+    MU_ASSERT("Sorted items not sorted in parallel", is_sorted(array));
+    resize_array_sort(copy, compare_ints);
+    MU_ASSERT("Repeated items not sorted", is_sorted(copy));
+    resize_array_sort_parallel(copy, compare_ints, 8);
+    MU_ASSERT("Repeated items not sorted in parallel", is_sorted(copy));
+
+    // Fewer than one thread sorts on the calling thread
+    for (size_t i = 0; i < num; i++)
+    {
+        resize_array_replace(copy, i, (void*)(intptr_t)(num - i));
+    }
+
+    resize_array_sort_parallel(copy, compare_ints, -1);
+    MU_ASSERT("Items not sorted with negative threads", is_sorted(copy));
+    resize_array_sort_parallel(copy, compare_ints, 0);
+    MU_ASSERT("Items not sorted with no threads", is_sorted(copy));
+
+    void *values = resize_array_of(sizeof(int), 0);
+    for (int i = 0; i < 100; i++)
+    {
+        int v = (i * 37) % 101;
+        resize_array_add_value(values, &v);
+    }
+
+    resize_array_sort(values, compare_values);
+    int *first = resize_array_at(values, 0);
+    int *last = resize_array_at(values, 99);
+    MU_ASSERT("Value array not sorted", *first == 0 && *last == 100 && clxns_count(values) == 100);
+
+    clxns_free(values, 0);
+    clxns_free(copy, 0);
+    clxns_free(array, 0);
+    return 0;
+}
+
+// A record sorted on its id by the radix sort
+typedef struct _record
+{
+    uint64_t id;
+    int seq;
+} record;
+
+/*
+ * Gets the key of a record
+ */
+static uint64_t record_id(const void *item)
+{
+    return ((const record*)item)->id;
+}
+
+/*
+ * Radix sort orders by key, keeps equal keys in order and handles keys using all 64 bits
+ */
+char *ra_radix_sort()
+{
+    const int num = 20000;
+    record *recs = malloc(num * sizeof(record));
+    void *array = resize_array(num);
+    srand(11);
+    for (int i = 0; i < num; i++)
+    {
+        recs[i].id = (uint64_t)(rand() % 500) << (i % 2 ? 56 : 4);
+        recs[i].seq = i;
+        resize_array_add(array, &recs[i]);
+    }
+
+    void *copy = clxns_copy(array);
+    resize_array_radix_sort(array, record_id);
+    resize_array_radix_sort_parallel(copy, record_id, 3);
+
+    record *prev;
+    record *next;
+    for (int i = 1; i < num; i++)
+    {
+        resize_array_get(array, i - 1, (void**)&prev);
+        resize_array_get(array, i, (void**)&next);
+        MU_ASSERT("Records not sorted by id", prev->id <= next->id);
+        MU_ASSERT("Equal ids not kept in order", prev->id != next->id || prev->seq < next->seq);
+        resize_array_get(copy, i, (void**)&prev);
+        MU_ASSERT("Parallel sort gave a different order", prev == next);
+    }
+
+    // Fewer than one thread counts the keys on the calling thread
+    void *serial = clxns_copy(array);
+    resize_array_radix_sort_parallel(serial, record_id, -1);
+    for (int i = 0; i < num; i++)
+    {
+        resize_array_get(array, i, (void**)&prev);
+        resize_array_get(serial, i, (void**)&next);
+        MU_ASSERT("Sort with negative threads gave a different order", prev == next);
+    }
+
+    clxns_free(serial, 0);
+
+    void *values = resize_array_of(sizeof(record), 0);
+    for (int i = 0; i < 50; i++)
+    {
+        record r = { (uint64_t)(50 - i) / 2, i };
+        resize_array_add_value(values, &r);
+    }
+
+    resize_array_radix_sort(values, record_id);
+    record *first = resize_array_at(values, 0);
+    record *second = resize_array_at(values, 1);
+    record *third = resize_array_at(values, 2);
+    record *last = resize_array_at(values, 49);
+    MU_ASSERT("Value array not sorted", first->id == 0 && second->id == 1 && last->id == 25);
+    MU_ASSERT("Equal values not kept in order", second->seq == 47 && third->seq == 48);
+
+    void *empty = resize_array(0);
+    resize_array_radix_sort(empty, record_id);
+    MU_ASSERT("Empty array should stay empty", clxns_count(empty) == 0);
+
+    clxns_free(empty, 0);
+    clxns_free(values, 0);
+    clxns_free(copy, 0);
+    clxns_free(array, 0);
+    free(recs);
+    return 0;
+}
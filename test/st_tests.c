@@ -0,0 +1,179 @@
+/*
+ * Unit tests for the snapshot table
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "minunit.h"
+#include "../src/collections.h"
+
+#define READERS 3
+#define ROUNDS 200
+#define KEYS 50
+
+// Work given to each reader thread
+typedef struct
+{
+    void *table;
+    volatile int *done;
+    int errors;
+} reader_work;
+
+/*
+ * Reads keys while the writer publishes. Every key is published with the same value in each
+ * round, so a reader must either miss a key or find its value, never anything else.
+ */
+static void *reader_thread(void *arg)
+{
+    reader_work *work = arg;
+    void *rd = snapshot_reader(work->table);
+    char key[32];
+    void *value;
+
+    while (!__atomic_load_n(work->done, __ATOMIC_ACQUIRE))
+    {
+        for (int i = 0; i < KEYS; i++)
+        {
+            sprintf(key, "key%d", i);
+            C_STATUS st = snapshot_table_get(rd, key, &value);
+            if (st == C_OK ? strcmp(value, key) != 0 : value != 0)
+            {
+                work->errors++;
+            }
+        }
+    }
+
+    snapshot_reader_free(rd);
+    return 0;
+}
+
+/*
+ * Changes are only seen by readers once published
+ */
+char *st_publish()
+{
+    void *st = snapshot_table(0);
+    void *rd = snapshot_reader(st);
+
+    snapshot_table_add(st, "AAA", "aaa");
+    snapshot_table_add(st, "BBB", "bbb");
+
+    char *value;
+    C_STATUS rv = snapshot_table_get(rd, "AAA", (void*)&value);
+    MU_ASSERT("Unpublished key seen by reader", rv == CE_MISSING && value == 0);
+    MU_ASSERT("Wrong count before publish", clxns_count(st) == 0);
+
+    snapshot_table_publish(st);
+    rv = snapshot_table_get(rd, "AAA", (void*)&value);
+    MU_ASSERT("Published key not seen by reader", rv == C_OK && !strcmp(value, "aaa"));
+    MU_ASSERT("Wrong count after publish", clxns_count(st) == 2);
+
+    snapshot_table_add(st, "AAA", "xxx");
+    rv = snapshot_table_remove(st, "BBB");
+    MU_ASSERT("Wrong status after remove", rv == C_OK);
+    rv = snapshot_table_remove(st, "CCC");
+    MU_ASSERT("Wrong status for missing key", rv == CE_MISSING);
+
+    rv = snapshot_table_get(rd, "BBB", (void*)&value);
+    MU_ASSERT("Unpublished remove seen by reader", rv == C_OK && !strcmp(value, "bbb"));
+
+    // The writer iterates its own changes before they are published
+    size_t count = 0;
+    void *iter = clxns_iter_new(st);
+    while (clxns_iter_move_next(iter))
+    {
+        kvp *kv = clxns_iter_get_next(iter);
+        MU_ASSERT("Wrong item from iterator", !strcmp(kv->key, "AAA") && !strcmp(kv->value, "xxx"));
+        count++;
+    }
+
+    clxns_iter_free(iter);
+    MU_ASSERT("Wrong iter count", count == 1);
+
+    snapshot_table_publish(st);
+    rv = snapshot_table_get(rd, "AAA", (void*)&value);
+    MU_ASSERT("Replaced value not seen by reader", rv == C_OK && !strcmp(value, "xxx"));
+    rv = snapshot_table_get(rd, "BBB", (void*)&value);
+    MU_ASSERT("Removed key seen by reader", rv == CE_MISSING);
+    MU_ASSERT("Wrong count after second publish", clxns_count(st) == 1);
+
+    void *copy = clxns_copy(st);
+    void *crd = snapshot_reader(copy);
+    rv = snapshot_table_get(crd, "AAA", (void*)&value);
+    MU_ASSERT("Key missing from copy", rv == C_OK && !strcmp(value, "xxx"));
+    MU_ASSERT("Wrong count for copy", clxns_count(copy) == 1);
+
+    snapshot_reader_free(crd);
+    snapshot_reader_free(rd);
+    clxns_free(copy, 0);
+    clxns_free(st, 0);
+    return 0;
+}
+
+/*
+ * Readers look keys up while the writer keeps adding, removing and publishing. Old versions
+ * are freed under the readers, so this is best run with a thread or address sanitizer.
+ */
+char *st_threads()
+{
+    void *st = snapshot_table(0);
+    char *keys[KEYS];
+    for (int i = 0; i < KEYS; i++)
+    {
+        keys[i] = malloc(32);
+        snprintf(keys[i], 32, "key%d", i);
+    }
+
+    volatile int done = 0;
+    pthread_t threads[READERS];
+    reader_work work[READERS];
+    for (int i = 0; i < READERS; i++)
+    {
+        work[i].table = st;
+        work[i].done = &done;
+        work[i].errors = 0;
+        pthread_create(&threads[i], 0, reader_thread, &work[i]);
+    }
+
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        for (int i = 0; i < KEYS; i++)
+        {
+            if ((i + r) % 3)
+            {
+                snapshot_table_add(st, keys[i], keys[i]);
+            }
+            else
+            {
+                snapshot_table_remove(st, keys[i]);
+            }
+        }
+
+        snapshot_table_publish(st);
+    }
+
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < READERS; i++)
+    {
+        pthread_join(threads[i], 0);
+        MU_ASSERT("Reader saw a wrong value", work[i].errors == 0);
+    }
+
+    size_t expected = 0;
+    for (int i = 0; i < KEYS; i++)
+    {
+        expected += ((i + ROUNDS - 1) % 3) != 0;
+    }
+
+    MU_ASSERT("Wrong count after threads", clxns_count(st) == expected);
+
+    clxns_free(st, 0);
+    for (int i = 0; i < KEYS; i++)
+    {
+        free(keys[i]);
+    }
+
+    return 0;
+}
@@ -12,6 +12,16 @@ char *ra_exchange(void);
 char *ra_copy_array(void);
 char *ra_insert(void);
 char *ra_replace(void);
+char *ra_serialize(void);
+char *ra_serialize_corrupt(void);
+char *ra_serialize_values(void);
+char *ra_ranges(void);
+char *ra_extend(void);
+char *ra_growth_policy(void);
+char *ra_values(void);
+char *ra_values_guarded(void);
+char *ra_sort(void);
+char *ra_radix_sort(void);
 
 // == PRIORITY QUEUE ==========================================================
 
@@ -21,6 +31,7 @@ char *pq_pop_items(void);
 char *pq_pop_items_max(void);
 char *pq_iterate_items(void);
 char *pq_copy_queue(void);
+char *pq_serialize(void);
 
 // == HASH TABLE ==============================================================
 
@@ -33,5 +44,71 @@ char *ht_iterate_sparse_ish(void);
 char *ht_iterate_empty(void);
 char *ht_remove_items(void);
 char *ht_copy(void);
+char *ht_churn(void);
+char *ht_collisions(void);
+char *ht_seeded(void);
+char *ht_incremental(void);
+char *ht_bitmap_words(void);
+char *ht_bitmap_incremental(void);
+char *ht_pow2(void);
+char *ht_binary_keys(void);
+char *ht_add_many(void);
+char *ht_inline_keys(void);
+char *ht_upsert(void);
+char *ht_serialize(void);
+char *ht_freeze(void);
+char *ht_freeze_large(void);
+char *ht_table_stats(void);
+char *ht_prehashed(void);
+char *ht_filter(void);
+char *ht_filter_prehashed(void);
+char *ht_reserve_floor(void);
+
+// == BLOOM FILTER ============================================================
+
+char *bf_add_test(void);
+char *bf_add_test_many(void);
+
+// == OPEN TABLE ==============================================================
+
+char *ot_add_replace(void);
+char *ot_get_items(void);
+char *ot_iterate(void);
+char *ot_remove_items(void);
+char *ot_copy(void);
+char *ot_seeded(void);
+
+// == DENSE TABLE =============================================================
+
+char *dt_add_get_remove(void);
+char *dt_insertion_order(void);
+
+// == LRU CACHE ===============================================================
+
+char *lc_lru_evict(void);
+char *lc_clock_sized(void);
+
+// == CONCURRENT TABLE ========================================================
+
+char *ct_add_get_remove(void);
+char *ct_threads(void);
+char *ct_iterate_writes(void);
+
+// == SNAPSHOT TABLE ==========================================================
+
+char *st_publish(void);
+char *st_threads(void);
+
+// == MAPPED TABLE ============================================================
+
+char *mt_write_open(void);
+char *mt_fixed_values(void);
+
+// == INT TABLE ===============================================================
+
+char *it_add_get(void);
+char *it_remove(void);
+char *it_iterate_copy(void);
+char *it_serialize(void);
 
 #endif